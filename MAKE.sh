@@ -22,78 +22,52 @@ Link=(avr-gcc -Wall -g -mmcu=atmega1280 -o)
 IHex=(avr-objcopy -j .text -j .data -O ihex)
 
 
-echo -e ">> COMPILE: "${Compile[@]}" "$buildDir"/lcd_test.o " $testDir"/lcd_test.c"
-"${Compile[@]}" $buildDir/lcd_test.o $testDir/lcd_test.c
-status=$?
-sleep $t
-if [ $status -gt 0 ]
-then
-    echo -e "error compiling LCD_TEST.C"
-    echo -e "program exiting with code $status"
-    exit $status
-else
-    echo -e "Compiling LCD_TEST.C successful"
-fi
-
-
-echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/lcd_base.o " $lcdDir"/lcd_base.c"
-"${Compile[@]}" $buildDir/lcd_base.o $lcdDir/lcd_base.c
-status=$?
-sleep $t
-if [ $status -gt 0 ]
-then
-    echo -e "error compiling LCD_BASE.C"
-    echo -e "program exiting with code $status"
-    exit $status
-else
-    echo -e "Compiling LCD_BASE.C successful"
-fi
-
-
-echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/lcd_sf.o " $lcdDir"/lcd_sf.c"
-"${Compile[@]}" $buildDir/lcd_sf.o $lcdDir/lcd_sf.c
-status=$?
-sleep $t
-if [ $status -gt 0 ]
-then
-    echo -e "error compiling LCD_SF.C"
-    echo -e "program exiting with code $status"
-    exit $status
-else
-    echo -e "Compiling LCD_SF.C successful"
-fi
-
-
-echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/prints.o "$genDir"/prints.c"
-"${Compile[@]}" $buildDir/prints.o $genDir/prints.c
-status=$?
-sleep $t
-if [ $status -gt 0 ]
-then
-    echo -e "error compiling PRINTS.C"
-    echo -e "program exiting with code $status"
-    exit $status
-else
-    echo -e "Compiling PRINTS.C successful"
-fi
-
-
-echo -e "\n\r>> COMPILE: "${Compile[@]}" "$buildDir"/usart0.o "$genDir"/usart0.c"
-"${Compile[@]}" $buildDir/usart0.o $genDir/usart0.c
-status=$?
-sleep $t
-if [ $status -gt 0 ]
-then
-    echo -e "error compiling USART0.C"
-    echo -e "program exiting with code $status"
-    exit $status
-else
-    echo -e "Compiling USART0.C successful"
-fi
-
-
-echo -e "\n\r>> LINK: "${Link[@]}" "$buildDir"/lcd_test.elf "$buildDir"/lcd_test.o  "$buildDir"/lcd_base.o  "$buildDir"/lcd_sf.o  "$buildDir"/usart0.o "$buildDir"/prints.o "
-"${Link[@]}" $buildDir/lcd_test.elf $buildDir/lcd_test.o $buildDir/lcd_base.o $buildDir/lcd_sf.o $buildDir/usart0.o $buildDir/prints.o
+#
+# compile a single source file to an object file in the build directory.
+# $1 = source file, $2 = name used in messages.
+#
+compile()
+{
+  obj=$buildDir/$(basename $1 .c).o
+  echo -e "\n\r>> COMPILE: "${Compile[@]}" "$obj" "$1""
+  "${Compile[@]}" $obj $1
+  status=$?
+  sleep $t
+  if [ $status -gt 0 ]
+  then
+      echo -e "error compiling $2"
+      echo -e "program exiting with code $status"
+      exit $status
+  else
+      echo -e "Compiling $2 successful"
+  fi
+  Objects+=($obj)
+}
+
+Objects=()
+compile $testDir/lcd_test.c LCD_TEST.C
+compile $lcdDir/lcd_base.c LCD_BASE.C
+compile $lcdDir/lcd_par.c LCD_PAR.C
+compile $lcdDir/lcd_addr.c LCD_ADDR.C
+compile $lcdDir/lcd_sf.c LCD_SF.C
+compile $lcdDir/lcd_queue.c LCD_QUEUE.C
+compile $lcdDir/lcd_fb.c LCD_FB.C
+compile $lcdDir/lcd_move.c LCD_MOVE.C
+compile $lcdDir/lcd_glyph.c LCD_GLYPH.C
+compile $lcdDir/lcd_timer.c LCD_TIMER.C
+compile $lcdDir/lcd_trace.c LCD_TRACE.C
+compile $lcdDir/lcd_stats.c LCD_STATS.C
+compile $lcdDir/lcd_poll.c LCD_POLL.C
+compile $lcdDir/lcd_sched.c LCD_SCHED.C
+compile $lcdDir/lcd_dual.c LCD_DUAL.C
+compile $lcdDir/lcd_twi.c LCD_TWI.C
+compile $lcdDir/lcd_spi.c LCD_SPI.C
+compile $genDir/prints.c PRINTS.C
+compile $genDir/usart0.c USART0.C
+
+
+echo -e "\n\r>> LINK: "${Link[@]}" "$buildDir"/lcd_test.elf "${Objects[@]}""
+"${Link[@]}" $buildDir/lcd_test.elf ${Objects[@]}
 status=$?
 sleep $t
 if [ $status -gt 0 ]
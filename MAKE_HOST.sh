@@ -0,0 +1,104 @@
+clear
+
+#
+# Builds LCD_TEST, LCD_BENCH and LCD_CHECK for the host (Linux, gcc) against the HD44780
+# emulator.
+# Any arguments are passed to the compiler, e.g.
+#   ./MAKE_HOST.sh -DLCD_DATA_LENGTH=DATA_LENGTH_4_BITS
+# Run the result with keyboard input on stdin, e.g.
+#   printf 'Hello\nWorld' | ../untracked/build/host/lcd_test
+#   ../untracked/build/host/lcd_bench > bench.jsonl
+#   ../untracked/build/host/lcd_check
+#
+
+#directory to store build/compiled files
+buildDir=../untracked/build/host
+
+#directory for avr-lcd source files
+lcdDir=source/lcd
+
+#directory for avr-general source files
+genDir=source/gen
+
+#directory for host (emulator) source files
+hostDir=source/host
+
+#directory for test files
+testDir=test
+
+#make build directory if it doesn't exist
+mkdir -p -v $buildDir
+
+# host headers come first so they stand in for the avr-libc headers.
+Compile=(gcc -Wall -g -O2 -std=gnu99 -I "includes/host" -I "includes/gen" -I "includes/lcd" -DF_CPU=16000000UL "$@" -c -o)
+Link=(gcc -Wall -g -o)
+
+
+#
+# compile a single source file to an object file in the build directory.
+# $1 = source file, $2 = name used in messages.
+#
+compile()
+{
+  obj=$buildDir/$(basename $1 .c).o
+  echo -e "\n\r>> COMPILE: "${Compile[@]}" "$obj" "$1""
+  "${Compile[@]}" $obj $1
+  status=$?
+  if [ $status -gt 0 ]
+  then
+      echo -e "error compiling $2"
+      echo -e "program exiting with code $status"
+      exit $status
+  else
+      echo -e "Compiling $2 successful"
+  fi
+  Objects+=($obj)
+}
+
+Objects=()
+compile $lcdDir/lcd_base.c LCD_BASE.C
+compile $lcdDir/lcd_par.c LCD_PAR.C
+compile $lcdDir/lcd_addr.c LCD_ADDR.C
+compile $lcdDir/lcd_sf.c LCD_SF.C
+compile $lcdDir/lcd_queue.c LCD_QUEUE.C
+compile $lcdDir/lcd_fb.c LCD_FB.C
+compile $lcdDir/lcd_move.c LCD_MOVE.C
+compile $lcdDir/lcd_glyph.c LCD_GLYPH.C
+compile $lcdDir/lcd_timer.c LCD_TIMER.C
+compile $lcdDir/lcd_trace.c LCD_TRACE.C
+compile $lcdDir/lcd_stats.c LCD_STATS.C
+compile $lcdDir/lcd_poll.c LCD_POLL.C
+compile $lcdDir/lcd_sched.c LCD_SCHED.C
+compile $lcdDir/lcd_dual.c LCD_DUAL.C
+compile $lcdDir/lcd_twi.c LCD_TWI.C
+compile $lcdDir/lcd_spi.c LCD_SPI.C
+compile $genDir/prints.c PRINTS.C
+compile $hostDir/hd44780.c HD44780.C
+compile $hostDir/usart0_host.c USART0_HOST.C
+Library=(${Objects[@]})
+
+
+#
+# compile and link a program from the test directory with the objects above.
+# $1 = program name.
+#
+program()
+{
+  Objects=()
+  compile $testDir/$1.c $(echo $1 | tr a-z A-Z).C
+  echo -e "\n\r>> LINK: "${Link[@]}" "$buildDir"/$1 "${Objects[@]}" "${Library[@]}""
+  "${Link[@]}" $buildDir/$1 ${Objects[@]} ${Library[@]}
+  status=$?
+  if [ $status -gt 0 ]
+  then
+      echo -e "error during linking"
+      echo -e "program exiting with code $status"
+      exit $status
+  else
+      echo -e "Linking successful. Output in "$buildDir"/$1"
+  fi
+}
+
+program lcd_test
+program lcd_bench
+program lcd_check
@@ -0,0 +1,24 @@
+/*
+ * File        : AVR/INTERRUPT.H (host)
+ * Author      : Joshua Fain
+ * Host Target : Linux (gcc)
+ * LCD         : HD44780 emulator (HD44780.C)
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Stand-in for the avr-libc header when building for the host. An ISR is an
+ * ordinary function, called by the emulator when its simulated timer fires
+ * while interrupts are enabled.
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include "hd44780.h"
+
+#define ISR(vector, ...)     void vector (void); void vector (void)
+
+#define sei()                hd_setInterrupts (1)
+#define cli()                hd_setInterrupts (0)
+
+#endif // HOST_AVR_INTERRUPT_H
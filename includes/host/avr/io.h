@@ -0,0 +1,147 @@
+/*
+ * File        : AVR/IO.H (host)
+ * Author      : Joshua Fain
+ * Host Target : Linux (gcc)
+ * LCD         : HD44780 emulator (HD44780.C)
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Stand-in for the avr-libc header when building for the host. Each I/O
+ * register used by the AVR-LCD module is an lvalue returned by hd_reg(),
+ * which lets the emulator observe every register access, e.g. to detect the
+ * edges of the enable pin and to drive PINA during reads. Every access also
+ * advances the simulated clock by one CPU cycle.
+ */
+
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+#include "hd44780.h"
+
+
+/*
+ ******************************************************************************
+ *                                  REGISTERS
+ ******************************************************************************
+ */
+
+#define PINA                 (*hd_reg (HD_PINA))
+#define DDRA                 (*hd_reg (HD_DDRA))
+#define PORTA                (*hd_reg (HD_PORTA))
+#define PINB                 (*hd_reg (HD_PINB))
+#define DDRB                 (*hd_reg (HD_DDRB))
+#define PORTB                (*hd_reg (HD_PORTB))
+#define PINC                 (*hd_reg (HD_PINC))
+#define DDRC                 (*hd_reg (HD_DDRC))
+#define PORTC                (*hd_reg (HD_PORTC))
+#define PIND                 (*hd_reg (HD_PIND))
+#define DDRD                 (*hd_reg (HD_DDRD))
+#define PORTD                (*hd_reg (HD_PORTD))
+
+#define TCCR2A               (*hd_reg (HD_TCCR2A))
+#define TCCR2B               (*hd_reg (HD_TCCR2B))
+#define TCNT2                (*hd_reg (HD_TCNT2))
+#define OCR2A                (*hd_reg (HD_OCR2A))
+#define TIMSK2               (*hd_reg (HD_TIMSK2))
+#define TIFR2                (*hd_reg (HD_TIFR2))
+
+#define TCCR1A               (*hd_reg (HD_TCCR1A))
+#define TCCR1B               (*hd_reg (HD_TCCR1B))
+#define TCNT1                (*hd_reg16 (HD_TCNT1))
+
+#define TWBR                 (*hd_reg (HD_TWBR))
+#define TWSR                 (*hd_reg (HD_TWSR))
+#define TWDR                 (*hd_reg (HD_TWDR))
+#define TWCR                 (*hd_reg (HD_TWCR))
+
+#define SPCR                 (*hd_reg (HD_SPCR))
+#define SPSR                 (*hd_reg (HD_SPSR))
+#define SPDR                 (*hd_reg16 (HD_SPDR))
+
+// registers accessed through a pointer by LCD_BASE with LCD_MULTI_INSTANCE.
+#define LCD_REG(p)           (*hd_regAt (p))
+
+
+/*
+ ******************************************************************************
+ *                                    BITS
+ ******************************************************************************
+ */
+
+#define PA0 0
+#define PA1 1
+#define PA2 2
+#define PA3 3
+#define PA4 4
+#define PA5 5
+#define PA6 6
+#define PA7 7
+
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PC7 7
+
+// Timer/Counter2
+#define WGM20 0
+#define WGM21 1
+#define CS20  0
+#define CS21  1
+#define CS22  2
+#define OCIE2A 1
+#define OCF2A  1
+
+// Timer/Counter1
+#define CS10 0
+#define CS11 1
+#define CS12 2
+
+// TWI
+#define TWIE  0
+#define TWEN  2
+#define TWWC  3
+#define TWSTO 4
+#define TWSTA 5
+#define TWEA  6
+#define TWINT 7
+#define TWPS0 0
+#define TWPS1 1
+
+// SPI
+#define SPR0  0
+#define SPR1  1
+#define CPHA  2
+#define CPOL  3
+#define MSTR  4
+#define DORD  5
+#define SPE   6
+#define SPIE  7
+#define SPI2X 0
+#define WCOL  6
+#define SPIF  7
+
+
+/*
+ ******************************************************************************
+ *                                CYCLE DELAYS
+ ******************************************************************************
+ */
+
+#define __builtin_avr_delay_cycles(cycles)   hd_delayCycles (cycles)
+
+
+#endif // HOST_AVR_IO_H
@@ -0,0 +1,22 @@
+/*
+ * File        : AVR/PGMSPACE.H (host)
+ * Author      : Joshua Fain
+ * Host Target : Linux (gcc)
+ * LCD         : HD44780 emulator (HD44780.C)
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Stand-in for the avr-libc header when building for the host, where there
+ * is a single address space.
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+
+#endif // HOST_AVR_PGMSPACE_H
@@ -0,0 +1,250 @@
+/*
+ * File        : HD44780.H
+ * Author      : Joshua Fain
+ * Host Target : Linux (gcc)
+ * LCD         : HD44780 emulator
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for a software model of the HD44780 controller, used to build
+ * and run the AVR-LCD module on the host. The host versions of the avr-libc
+ * headers (AVR/IO.H, UTIL/DELAY.H, ...) route every I/O register access and
+ * delay through this model, which keeps a simulated clock and samples the
+ * control and data pins on each access, wired as in LCD_BASE.H.
+ *
+ * The model includes the DDRAM, CGRAM, address counter, entry mode, display
+ * control, display shift, the busy flag with the instruction execution
+ * times, and 8-bit and 4-bit bus transfers. Bus timing that violates the
+ * controller's minimums, and bytes sent while the controller is busy (which
+ * are ignored, as on the real controller), are counted as violations.
+ *
+ * A second controller shares the data bus, RS and RW with the first and
+ * has its ENABLE on PC3, as for several displays on one bus or the two
+ * halves of a 40x4 module. Each controller keeps its own RAM and busy flag.
+ *
+ * Timer/Counter2 in CTC mode is also modelled, so that the LCD_QUEUE
+ * interrupt runs on the host, as is Timer/Counter1 in normal mode for the
+ * LCD_TIMER time base.
+ *
+ * The TWI is modelled as a master transmitter, with its interrupt and the
+ * time taken by each start, stop and byte at the bit rate set. TWINT always
+ * reads as 0, as the model cannot tell a read of TWCR from a write, so it
+ * must be serviced by the interrupt. With LCD_TWI a PCF8574 expander at
+ * HD_TWI_ADDR drives the first controller instead of the ports, wired as in
+ * LCD_TWI.H, and its outputs change as each byte is acknowledged.
+ *
+ * The SPI is modelled as a master, MSB first, taking 8 SCK periods per byte
+ * at the rate set. SPIF is set when a byte completes and cleared by the next
+ * write of SPDR, which while a byte is shifting sets WCOL and is ignored.
+ * SPDR reads as HD_SPDR_EMPTY except in the access that writes it. With
+ * LCD_SPI a 74HC595 shift register, clocked by the SPI and latched by PB0
+ * (RCLK), drives the first controller, wired as in LCD_SPI.H. Latching a
+ * byte that has not finished shifting outputs the partly shifted register.
+ */
+
+#ifndef HD44780_H
+#define HD44780_H
+
+#include <stdint.h>
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+// number of controllers modelled. Controller 0 has its ENABLE on PC2, as
+// in LCD_BASE.H, and controller 1 on PC3.
+#define HD_CTRLS             2
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 REGISTER IDS
+ *
+ * Passed to hd_reg() by the register macros of the host AVR/IO.H.
+ * ----------------------------------------------------------------------------
+ */
+
+#define HD_PINA              0
+#define HD_DDRA              1
+#define HD_PORTA             2
+#define HD_PINB              3
+#define HD_DDRB              4
+#define HD_PORTB             5
+#define HD_PINC              6
+#define HD_DDRC              7
+#define HD_PORTC             8
+#define HD_PIND              9
+#define HD_DDRD              10
+#define HD_PORTD             11
+#define HD_TCCR2A            12
+#define HD_TCCR2B            13
+#define HD_TCNT2             14
+#define HD_OCR2A             15
+#define HD_TIMSK2            16
+#define HD_TIFR2             17
+#define HD_TCCR1A            18
+#define HD_TCCR1B            19
+#define HD_TWBR              20
+#define HD_TWSR              21
+#define HD_TWDR              22
+#define HD_TWCR              23
+#define HD_SPCR              24
+#define HD_SPSR              25
+#define HD_REG_COUNT         26
+
+// 16-bit registers, passed to hd_reg16(). SPDR is held in a 16-bit cell, so
+// that a write can be told from a read, see SPI below.
+#define HD_TCNT1             0
+#define HD_SPDR              1
+#define HD_REG16_COUNT       2
+
+// value of SPDR when it has not just been written.
+#define HD_SPDR_EMPTY        0x100
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              VIOLATION TYPES
+ *
+ * Index into hd_stats_t.violations.
+ *
+ * HD_VIOL_T_AS       : RS/RW changed less than tAS before ENABLE rose.
+ * HD_VIOL_PW_EH      : ENABLE was high for less than PWEH.
+ * HD_VIOL_T_CYC_E    : ENABLE rose less than tcycE after it last rose.
+ * HD_VIOL_T_DSW      : Data changed less than tDSW before ENABLE fell.
+ * HD_VIOL_T_DDR      : DATA_PIN was read less than tDDR after ENABLE rose.
+ * HD_VIOL_BUSY       : A byte was written, or data read, while busy.
+ * HD_VIOL_CONTENTION : The LCD and the AVR both drove the data pins.
+ * ----------------------------------------------------------------------------
+ */
+
+#define HD_VIOL_T_AS         0
+#define HD_VIOL_PW_EH        1
+#define HD_VIOL_T_CYC_E      2
+#define HD_VIOL_T_DSW        3
+#define HD_VIOL_T_DDR        4
+#define HD_VIOL_BUSY         5
+#define HD_VIOL_CONTENTION   6
+#define HD_VIOL_COUNT        7
+
+
+/*
+ ******************************************************************************
+ *                                    TYPES
+ ******************************************************************************
+ */
+
+// Counts of the bus activity seen by the model.
+typedef struct
+{
+  uint32_t enablePulses;                   // ENABLE high/low cycles
+  uint32_t instructions;                   // instructions executed
+  uint32_t dataWrites;                     // DDRAM/CGRAM bytes written
+  uint32_t dataReads;                      // DDRAM/CGRAM bytes read
+  uint32_t busyReads;                      // busy flag/address reads
+  uint32_t twiStarts;                      // TWI starts
+  uint32_t twiBytes;                       // TWI data bytes acknowledged
+  uint32_t spiBytes;                       // SPI bytes shifted out
+  uint32_t violations[HD_VIOL_COUNT];
+} hd_stats_t;
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             REGISTER ACCESS
+ *
+ * Description : Returns the location of an I/O register. Any pin changes
+ *               made by the previous access are applied to the model first,
+ *               then the clock is advanced by one CPU cycle. Reading PINA
+ *               returns the value driven by the LCD during a read, and
+ *               TCNT1 (hd_reg16()) the count of Timer/Counter1. SPDR is
+ *               also accessed through hd_reg16(). hd_regAt() does the same
+ *               for a register given by its location, as used by LCD_REG()
+ *               with LCD_MULTI_INSTANCE.
+ *
+ * Arguments   : id     register, one of the REGISTER IDS.
+ *               reg    location of a register returned by hd_reg().
+ *
+ * Returns     : Pointer to the register.
+ * ----------------------------------------------------------------------------
+ */
+
+volatile uint8_t * hd_reg (uint8_t id);
+volatile uint8_t * hd_regAt (volatile uint8_t * reg);
+volatile uint16_t * hd_reg16 (uint8_t id);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              SIMULATED TIME
+ *
+ * Description : hd_delayCycles() and hd_delayUs() advance the simulated clock.
+ *               hd_timePs() returns the simulated time since start-up, in
+ *               picoseconds.
+ *
+ * Arguments   : cycles     CPU cycles, at F_CPU.
+ *               us         microseconds.
+ * ----------------------------------------------------------------------------
+ */
+
+void hd_delayCycles (uint32_t cycles);
+void hd_delayUs (double us);
+uint64_t hd_timePs (void);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            GLOBAL INTERRUPTS
+ *
+ * Description : Enables (1) or disables (0) the simulated interrupts, as sei()
+ *               and cli() do.
+ *
+ * Arguments   : enable     1 to enable, 0 to disable.
+ *
+ * Returns     : Previous setting.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t hd_setInterrupts (uint8_t enable);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             INSPECT THE MODEL
+ *
+ * Description : hd_ddram() and hd_cgram() return a byte of the controller's
+ *               RAM. hd_displayChar() returns the character code shown at a
+ *               position of the display, of the LCD_GEOMETRY profile in
+ *               LCD_ADDR.H, taking the display shift into account.
+ *               hd_stats() returns the bus activity counts.
+ *               hd_printDisplay() prints the display contents, and
+ *               hd_printReport() the counts, to stdout. The counts are of
+ *               all the controllers, and the other functions refer to the
+ *               one chosen with hd_select(), controller 0 by default.
+ *               hd_select() returns the controller chosen before.
+ *
+ * Arguments   : ctrl     controller, 0 to HD_CTRLS - 1.
+ *               addr     RAM address.
+ *               row      display line, 0 to LCD_ROWS - 1.
+ *               col      position in the line, 0 to LCD_COLS - 1.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t hd_select (uint8_t ctrl);
+uint8_t hd_ddram (uint8_t addr);
+uint8_t hd_cgram (uint8_t addr);
+uint8_t hd_displayChar (uint8_t row, uint8_t col);
+const hd_stats_t * hd_stats (void);
+void hd_printDisplay (void);
+void hd_printReport (void);
+
+
+#endif // HD44780_H
@@ -0,0 +1,25 @@
+/*
+ * File        : UTIL/ATOMIC.H (host)
+ * Author      : Joshua Fain
+ * Host Target : Linux (gcc)
+ * LCD         : HD44780 emulator (HD44780.C)
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Stand-in for the avr-libc header when building for the host. The block
+ * disables the emulator's interrupts and restores them on exit.
+ */
+
+#ifndef HOST_UTIL_ATOMIC_H
+#define HOST_UTIL_ATOMIC_H
+
+#include "hd44780.h"
+
+#define ATOMIC_RESTORESTATE  0
+#define ATOMIC_FORCEON       1
+
+#define ATOMIC_BLOCK(type)                                                    \
+  for (uint8_t hd_saved = hd_setInterrupts (0), hd_once = 1; hd_once;         \
+       hd_setInterrupts ((type) == ATOMIC_FORCEON ? 1 : hd_saved), hd_once = 0)
+
+#endif // HOST_UTIL_ATOMIC_H
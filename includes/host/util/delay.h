@@ -0,0 +1,21 @@
+/*
+ * File        : UTIL/DELAY.H (host)
+ * Author      : Joshua Fain
+ * Host Target : Linux (gcc)
+ * LCD         : HD44780 emulator (HD44780.C)
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Stand-in for the avr-libc header when building for the host. The delays
+ * advance the emulator's simulated clock rather than waiting in real time.
+ */
+
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+
+#include "hd44780.h"
+
+#define _delay_us(us)        hd_delayUs ((double)(us))
+#define _delay_ms(ms)        hd_delayUs ((double)(ms) * 1000.0)
+
+#endif // HOST_UTIL_DELAY_H
@@ -6,29 +6,175 @@
  * License     : MIT
  * Copyright (c) 2020, 2021
  *
- * Provides some macro definitions for DDRAM addresses
+ * Provides some macro definitions for DDRAM addresses, for the display
+ * geometry selected at compile time with LCD_GEOMETRY, and the lookup tables
+ * in flash between display positions and DDRAM addresses that are generated
+ * from it.
  */
 
 
 #ifndef LCD_ADDR_H
 #define LCD_ADDR_H
 
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           GEOMETRY PROFILES
+ *
+ * Pass one of these as LCD_GEOMETRY (e.g. -DLCD_GEOMETRY=LCD_GEOM_16X2) to
+ * select the number of display lines and characters per line. The default is
+ * the 20x4 display.
+ *
+ * The first two display lines start at DDRAM addresses 0x00 and 0x40. On 4
+ * line displays, lines 3 and 4 continue lines 1 and 2, LCD_COLS further on.
+ * ----------------------------------------------------------------------------
+ */
+
+#define LCD_GEOM_16X2        1
+#define LCD_GEOM_16X4        2
+#define LCD_GEOM_20X2        3
+#define LCD_GEOM_20X4        4
+#define LCD_GEOM_40X2        5
+
+#ifndef LCD_GEOMETRY
+#define LCD_GEOMETRY         LCD_GEOM_20X4
+#endif // LCD_GEOMETRY
+
+// Display geometry: number of display lines and characters per line.
+#if   (LCD_GEOMETRY == LCD_GEOM_16X2)
+  #define LCD_ROWS           2
+  #define LCD_COLS           16
+#elif (LCD_GEOMETRY == LCD_GEOM_16X4)
+  #define LCD_ROWS           4
+  #define LCD_COLS           16
+#elif (LCD_GEOMETRY == LCD_GEOM_20X2)
+  #define LCD_ROWS           2
+  #define LCD_COLS           20
+#elif (LCD_GEOMETRY == LCD_GEOM_20X4)
+  #define LCD_ROWS           4
+  #define LCD_COLS           20
+#elif (LCD_GEOMETRY == LCD_GEOM_40X2)
+  #define LCD_ROWS           2
+  #define LCD_COLS           40
+#else
+  #error "LCD_GEOMETRY is not a known geometry profile"
+#endif
+
 // Addresses for beginning and ending display line positions.
 
 // Display Line 1
 #define LINE_1_BEG     0x00
-#define LINE_1_END     0x13
+#define LINE_1_END     (LINE_1_BEG + LCD_COLS - 1)
 
 // Display Line 2
 #define LINE_2_BEG     0x40
-#define LINE_2_END     0x53
+#define LINE_2_END     (LINE_2_BEG + LCD_COLS - 1)
 
+#if (LCD_ROWS == 4)
 // Display Line 3
-#define LINE_3_BEG     0x14
-#define LINE_3_END     0x27
+#define LINE_3_BEG     (LINE_1_BEG + LCD_COLS)
+#define LINE_3_END     (LINE_3_BEG + LCD_COLS - 1)
 
 // Display Line 4
-#define LINE_4_BEG     0x54
-#define LINE_4_END     0x67
+#define LINE_4_BEG     (LINE_2_BEG + LCD_COLS)
+#define LINE_4_END     (LINE_4_BEG + LCD_COLS - 1)
+#endif
+
+// Beginning addresses of all display lines, in display line order, and the
+// display lines in ascending order of their DDRAM addresses. For use as
+// array initializers.
+#if (LCD_ROWS == 4)
+  #define LINE_BEG_ADDRS { LINE_1_BEG, LINE_2_BEG, LINE_3_BEG, LINE_4_BEG }
+  #define LINE_ADDR_ORDER { 0, 2, 1, 3 }
+#else
+  #define LINE_BEG_ADDRS { LINE_1_BEG, LINE_2_BEG }
+  #define LINE_ADDR_ORDER { 0, 1 }
+#endif
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             POSITION LOOKUP
+ *
+ * LCD_XY_ADDR(row, col) : DDRAM address of a display position. row and col
+ *                         must be in range.
+ *
+ * LCD_ADDR_POS(addr)    : display position of a DDRAM address (0x00 to
+ *                         0x7F), packed into one byte. POS_NONE if the
+ *                         address is not a visible position, otherwise
+ *                         POS_ROW() and POS_COL() return its row and column.
+ *                         POS_AT() packs a position.
+ *
+ * Both read a table in flash, so the address map costs a single lookup.
+ * ----------------------------------------------------------------------------
+ */
+
+#define POS_NONE             0xFF
+#define POS_AT(row, col)     ((row) << 6 | (col))
+#define POS_ROW(pos)         ((pos) >> 6)
+#define POS_COL(pos)         ((pos) & 0x3F)
+
+#define LCD_XY_ADDR(row, col)  pgm_read_byte (&lcd_xyAddr[row][col])
+#define LCD_ADDR_POS(addr)     pgm_read_byte (&lcd_addrPos[(addr) & 0x7F])
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            TABLE GENERATION
+ *
+ * Initializers for the lookup tables, expanded from the geometry by the
+ * preprocessor so the tables are constants. Used by LCD_ADDR.C.
+ * ----------------------------------------------------------------------------
+ */
+
+#define ADDR_CAT_(a, b)      a ## b
+#define ADDR_CAT(a, b)       ADDR_CAT_ (a, b)
+
+// b, b + 1, ... for LCD_COLS values.
+#define ADDR_SEQ4(b)         (b), (b) + 1, (b) + 2, (b) + 3
+#define ADDR_SEQ8(b)         ADDR_SEQ4 (b), ADDR_SEQ4 ((b) + 4)
+#define ADDR_SEQ_16(b)       ADDR_SEQ8 (b), ADDR_SEQ8 ((b) + 8)
+#define ADDR_SEQ_20(b)       ADDR_SEQ_16 (b), ADDR_SEQ4 ((b) + 16)
+#define ADDR_SEQ_40(b)       ADDR_SEQ_20 (b), ADDR_SEQ_20 ((b) + 20)
+#define ADDR_ROW(b)          { ADDR_CAT (ADDR_SEQ_, LCD_COLS) (b) }
+
+#if (LCD_ROWS == 4)
+  #define XY_ADDR_TABLE      { ADDR_ROW (LINE_1_BEG), ADDR_ROW (LINE_2_BEG),  \
+                               ADDR_ROW (LINE_3_BEG), ADDR_ROW (LINE_4_BEG) }
+#else
+  #define XY_ADDR_TABLE      { ADDR_ROW (LINE_1_BEG), ADDR_ROW (LINE_2_BEG) }
+#endif
+
+// packed position of DDRAM address a. Lines 1 and 3 are in the lower half of
+// the DDRAM, lines 2 and 4 in the upper half.
+#define ADDR_POS(a)                                                           \
+  (((a) & 0x3F) < LCD_COLS                                                    \
+     ? POS_AT ((a) >> 6, (a) & 0x3F)                                          \
+     : (LCD_ROWS == 4 && ((a) & 0x3F) < 2 * LCD_COLS)                         \
+       ? POS_AT (2 + ((a) >> 6), ((a) & 0x3F) - LCD_COLS) : POS_NONE)
+
+// f(b), f(b + 1), ... for all 128 DDRAM addresses.
+#define ADDR_MAP8(f, b)      f (b), f ((b) + 1), f ((b) + 2), f ((b) + 3),    \
+                             f ((b) + 4), f ((b) + 5), f ((b) + 6), f ((b) + 7)
+#define ADDR_MAP32(f, b)     ADDR_MAP8 (f, b), ADDR_MAP8 (f, (b) + 8),        \
+                             ADDR_MAP8 (f, (b) + 16), ADDR_MAP8 (f, (b) + 24)
+#define ADDR_POS_TABLE       { ADDR_MAP32 (ADDR_POS, 0x00),                   \
+                               ADDR_MAP32 (ADDR_POS, 0x20),                   \
+                               ADDR_MAP32 (ADDR_POS, 0x40),                   \
+                               ADDR_MAP32 (ADDR_POS, 0x60) }
+
+
+/*
+ ******************************************************************************
+ *                                 LOOKUP TABLES
+ ******************************************************************************
+ */
+
+// in flash, read with LCD_XY_ADDR() and LCD_ADDR_POS().
+extern const uint8_t lcd_xyAddr[LCD_ROWS][LCD_COLS];
+extern const uint8_t lcd_addrPos[128];
 
-#endif // LCD_ADDR_H
\ No newline at end of file
+#endif // LCD_ADDR_H
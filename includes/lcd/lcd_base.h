@@ -18,6 +18,7 @@
 #ifndef LCD_BASE_H
 #define LCD_BASE_H
 
+#include <stdint.h>
 #include <avr/io.h>
 
 /*
@@ -26,68 +27,81 @@
  ******************************************************************************
  */
 
-#define DDR_INPUT            0x00           /* use to set DDRs to input */
-#define DDR_OUTPUT           0xFF           /* use to set DDRs to output */
-
-
 /*
  * ----------------------------------------------------------------------------
- *                                                                 CONTROL PORT
- * 
- * The control port contains the 3 control PINS - Register select, Read/Write,
- * and Enable.
- * 
- * RS : Determines whether to access the data or instruction register.
- *  0 - Data Register is selected
- *  1 - Instruction Register is selected
- * 
- * RW : Determines whether operating in Read or Write mode.
- *  0 = Write mode
- *  1 = Read mode
+ *                                                           MULTIPLE INSTANCES
+ * 
+ * By default the driver is built for a single LCD, on the ports and pins
+ * defined in LCD_PAR.H, which are accessed directly. Build with -DLCD_MULTI_INSTANCE
+ * to drive several LCDs, each on its own ports and pins as set in its lcd_t 
+ * by lcd_config(). The registers are then accessed through the pointers held
+ * in the lcd_t, which is slower, and the read-modify-write of a control port
+ * is no longer a single instruction, so the ports must not be shared with 
+ * anything that modifies them from an interrupt. LCD_DATA_LENGTH and 
+ * DATA_NIBBLE_SHIFT apply to all of the LCDs. Displays that share the data 
+ * port and differ only in their control pins are supported.
+ * 
+ * LCD_REG(p)  : the register pointed to by p. The host build replaces this
+ *               so the emulator sees the access.
+ * 
+ * LCD_NOINIT  : place an lcd_t in .noinit, so its state survives a reset of 
+ *               the MCU for lcd_warmInit(), e.g. lcd_t lcd LCD_NOINIT;
  * ----------------------------------------------------------------------------
  */
 
-#define CTRL_DDR             DDRC         /* Control Port Direction Register */
-#define CTRL_PORT            PORTC            
-#define RS                   PC0                           /* Reg select */
-#define RW                   PC1                           /* Read/Write */
-#define EN                   PC2                           /* Enable */
+#ifndef LCD_REG
+#define LCD_REG(p)           (*(p))
+#endif // LCD_REG
+
+#define LCD_NOINIT           __attribute__((section (".noinit")))
 
-// REGISTER SELECT
-#define DATA_REG_SELECT      CTRL_PORT &= ~(1 << RS)       /* RS = 0 */
-#define INSTR_REG_SELECT     CTRL_PORT |=  (1 << RS)       /* RS = 1 */
 
-// READ/WRITE
-#define WRITE_MODE           CTRL_PORT &= ~(1 << RW)       /* RW = 0 */
-#define READ_MODE            CTRL_PORT |=  (1 << RW)       /* RW = 1 */
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 I2C BACKPACK
+ * 
+ * Build with -DLCD_TWI for an LCD on a PCF8574 I2C backpack, driven by the
+ * TWI of the AVR. LCD_TWI.H is then the transport (see LCD_BUS.H) in place
+ * of the parallel ports. The backpack only connects DB4-DB7 and does not 
+ * drive RW high, so this implies 4-bit mode and LCD_WRITE_ONLY.
+ * ----------------------------------------------------------------------------
+ */
 
-// ENABLE
-#define ENABLE_LO            CTRL_PORT &= ~(1 << EN)       /* EN = 0 */
-#define ENABLE_HI            CTRL_PORT |=  (1 << EN)       /* EN = 1 */
+#ifdef LCD_TWI
+  #if defined (LCD_MULTI_INSTANCE) || defined (LCD_DEADLINE)
+    #error "LCD_TWI is not available with LCD_MULTI_INSTANCE or LCD_DEADLINE"
+  #endif
+  #ifndef LCD_WRITE_ONLY
+  #define LCD_WRITE_ONLY
+  #endif
+  #ifndef LCD_DATA_LENGTH
+  #define LCD_DATA_LENGTH    DATA_LENGTH_4_BITS
+  #endif
+#endif // LCD_TWI
 
 
 /*
  * ----------------------------------------------------------------------------
- *                                                                    DATA PORT
- * 
- * Macros to define the data port and pins.
+ *                                                               SHIFT REGISTER
  * 
- * Notes: To write values to PINS that are to be sent to the LCD's controller,
- *        then must write to the chosesn AVR PORT when the pins are configured
- *        for output. When reading in PIN values set by the LCD, then must read 
- *        the PIN register (not the PORT) when the chosen AVR port pins are
- *        configured for input. Therefore, from the macros below, use DATA_PORT
- *        when sending values and DATA_PIN when retrieving values. Use
- *        DATA_DDR to set whether the pins are input or output. Though the 
- *        data direction for each pin can be set individually, this should not
- *        be necessary in this implementation. To set all the port pins to 
- *        output, DATA_DDR = 0xFF and for input, DATA_DDR = 0.
+ * Build with -DLCD_SPI for an LCD on a 74HC595 shift register, driven by the
+ * SPI of the AVR. LCD_SPI.H is then the transport (see LCD_BUS.H) in place
+ * of the parallel ports. Only DB4-DB7 are connected and nothing can be read
+ * back, so this implies 4-bit mode and LCD_WRITE_ONLY.
  * ----------------------------------------------------------------------------
  */
 
-#define DATA_DDR             DDRA           /* Data Port Direction Register */
-#define DATA_PORT            PORTA          /* for sending OUT values */
-#define DATA_PIN             PINA           /* for reading IN values */
+#ifdef LCD_SPI
+  #if defined (LCD_MULTI_INSTANCE) || defined (LCD_DEADLINE)
+    #error "LCD_SPI is not available with LCD_MULTI_INSTANCE or LCD_DEADLINE"
+  #endif
+  #ifndef LCD_WRITE_ONLY
+  #define LCD_WRITE_ONLY
+  #endif
+  #ifndef LCD_DATA_LENGTH
+  #define LCD_DATA_LENGTH    DATA_LENGTH_4_BITS
+  #endif
+#endif // LCD_SPI
 
 
 /*
@@ -162,6 +176,28 @@
 #define FONT_5x8             0x00
 
 
+/*
+ * ----------------------------------------------------------------------------
+ *                                                               DATA BUS WIDTH
+ * 
+ * LCD_DATA_LENGTH selects whether the LCD's data bus is operated as an 8-bit
+ * or a 4-bit bus. It defaults to 8-bit; build with 
+ * -DLCD_DATA_LENGTH=DATA_LENGTH_4_BITS to use 4-bit mode, in which only 
+ * DB4-DB7 of the LCD are connected. For the parallel ports, see 
+ * DATA_NIBBLE_SHIFT in LCD_PAR.H.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef LCD_DATA_LENGTH
+#define LCD_DATA_LENGTH      DATA_LENGTH_8_BITS
+#endif // LCD_DATA_LENGTH
+
+#if (defined (LCD_TWI) || defined (LCD_SPI))                                 \
+    && LCD_DATA_LENGTH != DATA_LENGTH_4_BITS
+  #error "LCD_TWI and LCD_SPI require 4-bit mode"
+#endif
+
+
 /*
  * ----------------------------------------------------------------------------
  *                                                      INSTRUCTION ERROR FLAGS
@@ -199,6 +235,121 @@
 #define BUSY_RESET_SUCCESS   0x02
 #define BUSY_RESET_TIMEOUT   0x04
 
+// returned by lcd_waitBusyUs() if the busy flag did not reset.
+#define BUSY_WAIT_TIMEOUT    0xFFFF
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            QUEUE ERROR FLAGS
+ * 
+ * Errors flags returned by the queued functions in LCD_QUEUE. These are used
+ * in conjuction with the instruction error flags above.
+ * ----------------------------------------------------------------------------
+ */
+
+#define QUEUE_FULL           0x08
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                   INIT FLAGS
+ * 
+ * Returned by lcd_warmInit() to indicate whether the LCD was restarted 
+ * without the power-on sequence (WARM_INIT) or lcd_init() was run 
+ * (COLD_INIT).
+ * ----------------------------------------------------------------------------
+ */
+
+#define WARM_INIT            0x10
+#define COLD_INIT            0x20
+
+
+/*
+ ******************************************************************************
+ *                                    TYPES
+ ******************************************************************************
+ */
+
+//
+// An LCD. Every function of LCD_BASE, LCD_SF and LCD_MOVE takes a pointer to
+// the lcd_t of the LCD to operate on, which holds the controller state 
+// tracked by the driver and, with LCD_MULTI_INSTANCE, the wiring and geometry
+// of the LCD. Without LCD_MULTI_INSTANCE only one lcd_t should be used. The
+// members are not for use by the application.
+//
+typedef struct lcd
+{
+#ifdef LCD_BUS_RUNTIME
+  // transport of the LCD, set by lcd_setBus(). See LCD_BUS.H.
+  const struct lcd_bus * bus;
+#endif // LCD_BUS_RUNTIME
+
+#ifdef LCD_MULTI_INSTANCE
+  // wiring, set by lcd_config().
+  volatile uint8_t * dataPort;
+  volatile uint8_t * dataDdr;
+  volatile uint8_t * dataPin;
+  volatile uint8_t * ctrlPort;
+  volatile uint8_t * ctrlDdr;
+  uint8_t rsMask;
+  uint8_t rwMask;
+  uint8_t enMask;
+
+  // geometry, set by lcd_config().
+  uint8_t rows;
+  uint8_t cols;
+  uint8_t rowAddr[4];                    // DDRAM address of each line
+#endif // LCD_MULTI_INSTANCE
+
+  //
+  // Shadow copies of the controller state that determines the address 
+  // counter. These are updated from every instruction and data transfer 
+  // sent, so the address counter never has to be read from the LCD.
+  //
+  uint8_t ac;                            // address counter
+  uint8_t acCGRAM;                       // 1 if AC addresses CGRAM
+  uint8_t entryMode;                     // ENTRY_MODE_SET settings
+  uint8_t function;                      // FUNCTION_SET settings
+  uint8_t display;                       // DISPLAY_CTRL settings
+
+  //
+  // The mode registers above are only compared against when their bit in
+  // modesKnown is set, i.e. once the instruction has been sent since 
+  // lcd_init() or lcd_resyncModes(). Instructions that would not change a 
+  // known mode register are skipped and counted in modeSkips.
+  //
+  uint8_t  modesKnown;
+  uint16_t modeSkips[3];
+
+#if defined (LCD_DEADLINE)
+  // LCD_TIMER_NOW when the last byte was sent, and its execution time in
+  // ticks.
+  uint16_t execBegin;
+  uint16_t execTicks;
+#elif defined (LCD_WRITE_ONLY)
+  // execution time, in microseconds, remaining of the last byte sent.
+  uint16_t pendingUs;
+#endif
+
+#ifdef LCD_VERIFY_ADDR
+  uint16_t addrMismatches;               // see lcd_addrMismatches()
+#endif
+
+  // supplies the characters to rewrite for LCD_MOVE. NULL if none.
+  uint8_t (*fill)(uint8_t addr);
+
+  //
+  // Set to WARM_MAGIC when lcd_init() completes. lcd_warmInit() only trusts
+  // the mode registers above if it is set, which requires the lcd_t to be 
+  // in .noinit (LCD_NOINIT).
+  //
+  uint16_t warmMagic;
+} lcd_t;
+
+
+// the transport layer, which needs lcd_t.
+#include "lcd_bus.h"
 
 
 /*
@@ -207,22 +358,117 @@
  ******************************************************************************
  */
 
+#ifdef LCD_MULTI_INSTANCE
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                             CONFIGURE AN LCD
+ * 
+ * Description : Sets the ports, pins and geometry of an LCD in its lcd_t. 
+ *               This must be done before any other function is called with 
+ *               the lcd_t, and does not access the LCD. The direction and pin
+ *               registers of each port are those at the addresses below its
+ *               PORT register, as on the ATmega1280.
+ * 
+ * Arguments   : lcd          the LCD.
+ *               dataPort     data port, e.g. &PORTA.
+ *               ctrlPort     control port, e.g. &PORTC.
+ *               rs, rw, en   control port pins, e.g. PC0. rw is not used 
+ *                            with LCD_WRITE_ONLY.
+ *               rows         number of display lines, 1 to 4.
+ *               cols         characters per line, 1 to 40.
+ * 
+ * Returns     : LCD Error code. INVALID_ARG if rows or cols is out of range
+ *               or a pin is not 0 to 7. Otherwise LCD_INSTR_SUCCESS.
+ * 
+ * Notes       : Lines 3 and 4 are taken to continue lines 1 and 2 in DDRAM,
+ *               as on the HD44780 20x4 and 16x4 modules.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_config (lcd_t * lcd, volatile uint8_t * dataPort, 
+                    volatile uint8_t * ctrlPort, uint8_t rs, uint8_t rw, 
+                    uint8_t en, uint8_t rows, uint8_t cols);
+
+#endif // LCD_MULTI_INSTANCE
+
+
+#ifdef LCD_BUS_RUNTIME
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                           SELECT A TRANSPORT
+ * 
+ * Description : Sets the transport used for an LCD, from those built (see 
+ *               LCD_BUS.H). This must be done after every reset of the MCU,
+ *               before lcd_init() or lcd_warmInit() is called with the 
+ *               lcd_t, and does not access the LCD.
+ * 
+ * Arguments   : lcd     the LCD.
+ *               bus     operation table of the transport, e.g. &lcd_busPar,
+ *                       or LCD_BUS_DEFAULT.
+ * 
+ * Returns     : void
+ * 
+ * Notes       : Requires LCD_BUS_RUNTIME. LCD_TWI and LCD_SPI each drive a
+ *               single LCD.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_setBus (lcd_t * lcd, const lcd_bus_t * bus);
+
+#endif // LCD_BUS_RUNTIME
+
+
 /* 
  * ----------------------------------------------------------------------------
  *                                                           INITIALIZE THE LCD
  * 
- * Description : The 'Initializing by Instruction' routine - 8-bit mode
- *               version. This must be executed if the power supply conditions
- *               for operating the internal reset circuit are not met when 
- *               powering up.
+ * Description : The 'Initializing by Instruction' routine. The 8-bit or 4-bit
+ *               version is used depending on LCD_DATA_LENGTH. This must be 
+ *               executed if the power supply conditions for operating the 
+ *               internal reset circuit are not met when powering up.
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : void
  * ----------------------------------------------------------------------------
  */
 
-void lcd_init (void);
+void lcd_init (lcd_t * lcd);
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                      WARM RESTART OF THE LCD
+ * 
+ * Description : For use in place of lcd_init() after a watchdog or soft reset
+ *               of the MCU, when the LCD is likely to still be powered and
+ *               configured. If lcd_init() has completed since the MCU last 
+ *               lost power, and the controller responds with the busy flag
+ *               clear and a DDRAM address in the address counter, only the 
+ *               FUNCTION_SET, DISPLAY_CTRL and ENTRY_MODE_SET settings last
+ *               sent are sent again. The display is not cleared and the 
+ *               address counter is read back from the controller. Otherwise 
+ *               lcd_init() is called.
+ * 
+ * Arguments   : lcd     the LCD.
+ * 
+ * Returns     : WARM_INIT if the LCD was restarted without lcd_init(), else
+ *               COLD_INIT.
+ * 
+ * Notes       : In 4-bit mode the reset may have come between the nibbles of
+ *               a transfer, so the 4-bit switch sequence of lcd_init() is 
+ *               sent first, without the power-on delays. This may complete
+ *               the interrupted instruction. With LCD_WRITE_ONLY the
+ *               controller cannot be checked and is assumed to be configured,
+ *               and the address counter is set to 0. The display shift is
+ *               not restored. The lcd_t must be in .noinit (LCD_NOINIT),
+ *               otherwise lcd_init() is always called.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_warmInit (lcd_t * lcd);
 
 
 // *******************   LCD Data Port Instruction Functions   ****************
@@ -234,13 +480,13 @@ void lcd_init (void);
  * Description : Clears the display and sets DDRAM address to 0 in the address 
  *               counter.
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : void
  * ----------------------------------------------------------------------------
  */
 
-void lcd_clearDisplay (void);
+void lcd_clearDisplay (lcd_t * lcd);
 
 
 /* 
@@ -250,13 +496,13 @@ void lcd_clearDisplay (void);
  * Description : Sets DDRAM address to 0 in the address counter. Returns 
  *               dispaly to original position. DDRAM contents are not changed.
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : void
  * ----------------------------------------------------------------------------
  */
 
-void lcd_returnHome (void);
+void lcd_returnHome (lcd_t * lcd);
 
 
 /* 
@@ -267,7 +513,8 @@ void lcd_returnHome (void);
  *               the cursor moves and specifies whether the display will shift.
  *               These will be performed during data writes and reads.
  * 
- * Argument    : setting     The settings of the instruction-specific bits to 
+ * Arguments   : lcd         the LCD.
+ *               setting     The settings of the instruction-specific bits to 
  *                           send with the ENTRY_MODE_SET instruction. The 
  *                           available settings are listed below. The setting
  *                           flags should be OR'd.
@@ -283,10 +530,13 @@ void lcd_returnHome (void);
  * Returns     : LCD Error code. INVALID_ARG will be returned if the value of 
  *               settings value is >= ENTRY_MODE_SET. Otherwise 
  *               LCD_INSTR_SUCCESS is returned.
+ * 
+ * Notes       : The instruction is not sent if the setting matches the value
+ *               last sent (see lcd_resyncModes()).
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_entryModeSet (uint8_t setting);
+uint8_t lcd_entryModeSet (lcd_t * lcd, uint8_t setting);
 
 
 /* 
@@ -297,7 +547,8 @@ uint8_t lcd_entryModeSet (uint8_t setting);
  *               used to turn the display ON or OFF, to turn the cursor ON or 
  *               OFF, and to specify whether cursor blinking will be ON or OFF.
  * 
- * Argument    : setting     The settings of the instruction-specific bits to 
+ * Arguments   : lcd         the LCD.
+ *               setting     The settings of the instruction-specific bits to 
  *                           send with the DISPLAY_CTRL instruction. The 
  *                           available settings are listed below. The setting
  *                           flags should be OR'd.
@@ -314,10 +565,13 @@ uint8_t lcd_entryModeSet (uint8_t setting);
  * Returns     : LCD Error code. INVALID_ARG will be returned if the value of 
  *               settings value is >= DISPLAY_CTRL. Otherwise LCD_INSTR_SUCCESS
  *               is returned.
+ * 
+ * Notes       : The instruction is not sent if the setting matches the value
+ *               last sent (see lcd_resyncModes()).
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_displayCtrl (uint8_t setting);
+uint8_t lcd_displayCtrl (lcd_t * lcd, uint8_t setting);
 
 
 /* 
@@ -330,7 +584,8 @@ uint8_t lcd_displayCtrl (uint8_t setting);
  *               display, and it does not matter what the ENTRY_MODE_SET 
  *               settings are.
  * 
- * Argument    : setting     The settings of the instruction-specific bits to 
+ * Arguments   : lcd         the LCD.
+ *               setting     The settings of the instruction-specific bits to 
  *                           send with the CURSOR_DISPLAY_SHIFT instruction.
  *                           The available settings are listed below. The
  *                           setting flags should be OR'd.
@@ -347,7 +602,7 @@ uint8_t lcd_displayCtrl (uint8_t setting);
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_cursorDisplayShift (uint8_t setting);
+uint8_t lcd_cursorDisplayShift (lcd_t * lcd, uint8_t setting);
 
 
 /* 
@@ -358,7 +613,8 @@ uint8_t lcd_cursorDisplayShift (uint8_t setting);
  *               data length (4 or 8 bits), to set the number of display lines,
  *               and set the character font.
  * 
- * Argument    : setting     The settings of the instruction-specific bits to 
+ * Arguments   : lcd         the LCD.
+ *               setting     The settings of the instruction-specific bits to 
  *                           send with the FUNCTION_SET instruction. The 
  *                           available settings are listed below. The setting
  *                           flags should be OR'd.
@@ -373,12 +629,16 @@ uint8_t lcd_cursorDisplayShift (uint8_t setting);
  *               FONT_5x8                
  * 
  * Returns     : LCD Error code. INVALID_ARG will be returned if the value of 
- *               settings value is >= FUNCTION_SET. Otherwise LCD_INSTR_SUCCESS
- *               is returned.
+ *               settings value is >= FUNCTION_SET, or if the data length does
+ *               not match LCD_DATA_LENGTH. Otherwise LCD_INSTR_SUCCESS is 
+ *               returned.
+ * 
+ * Notes       : The instruction is not sent if the setting matches the value
+ *               last sent (see lcd_resyncModes()).
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_functionSet (uint8_t setting);
+uint8_t lcd_functionSet (lcd_t * lcd, uint8_t setting);
 
 
 /* 
@@ -389,7 +649,8 @@ uint8_t lcd_functionSet (uint8_t setting);
  *               of the Character Generator RAM. CGRAM data is sent and 
  *               received after sending this instruction.
  * 
- * Argument    : acg     byte specifying the address the CGRAM pointer will 
+ * Arguments   : lcd     the LCD.
+ *               acg     byte specifying the address the CGRAM pointer will 
  *                       point to. The lowest 6 bits in the acg argument are
  *                       the address.
  * 
@@ -399,7 +660,7 @@ uint8_t lcd_functionSet (uint8_t setting);
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_setAddrCGRAM (uint8_t acg);
+uint8_t lcd_setAddrCGRAM (lcd_t * lcd, uint8_t acg);
 
 
 /* 
@@ -410,7 +671,8 @@ uint8_t lcd_setAddrCGRAM (uint8_t acg);
  *               of the Display Data RAM. DDRAM data is sent and received after
  *               sending this instruction.
  *  
- * Argument    : add     byte specifying the address the DDRAM pointer will 
+ * Arguments   : lcd     the LCD.
+ *               add     byte specifying the address the DDRAM pointer will 
  *                       point to. The lowest 7 bits in the add argument are
  *                       the address.
  *
@@ -420,19 +682,21 @@ uint8_t lcd_setAddrCGRAM (uint8_t acg);
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_setAddrDDRAM (uint8_t add);
+uint8_t lcd_setAddrDDRAM (lcd_t * lcd, uint8_t add);
 
 
 
 // *****************   LCD Control Port Instruction Functions   ***************
 
+#ifndef LCD_WRITE_ONLY
+
 /* 
  * ----------------------------------------------------------------------------
  *                                                   READ BUSY FLAG and ADDRESS
  * 
  * Description : Reads & returns the busy flag setting and the address counter.
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : Byte
  *               [0:6] = The current value in the address counter.
@@ -440,7 +704,9 @@ uint8_t lcd_setAddrDDRAM (uint8_t add);
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_readBusyAndAddr (void);
+uint8_t lcd_readBusyAndAddr (lcd_t * lcd);
+
+#endif // LCD_WRITE_ONLY
 
 
 /* 
@@ -452,7 +718,8 @@ uint8_t lcd_readBusyAndAddr (void);
  *               determined by the most recent "set address" instruction that 
  *               was sent (i.e. SET_DDRAM_ADDR or SET_CGRAM_ADDR).
  * 
- * Arguments   : data     data byte that will be written to the DDRAM or 
+ * Arguments   : lcd      the LCD.
+ *               data     data byte that will be written to the DDRAM or 
  *                        CGRAM at the location pointed to by the address 
  *                        counter.
  * 
@@ -460,9 +727,31 @@ uint8_t lcd_readBusyAndAddr (void);
  * ----------------------------------------------------------------------------
 */
 
-void lcd_writeData (uint8_t data);
+void lcd_writeData (lcd_t * lcd, uint8_t data);
 
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                            WRITE DATA BUFFER TO DDRAM or CGRAM
+ * 
+ * Description : Writes a run of data bytes to consecutive locations of the 
+ *               DDRAM or CGRAM, starting at the location pointed to by the 
+ *               address counter. This is equivalent to calling 
+ *               lcd_writeData() for each byte.
+ * 
+ * Arguments   : lcd     the LCD.
+ *               buf     pointer to the data bytes to write.
+ *               len     number of bytes to write.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_writeDataBuf (lcd_t * lcd, const uint8_t * buf, uint8_t len);
+
+
+#ifndef LCD_WRITE_ONLY
+
 /* 
  * ----------------------------------------------------------------------------
  *                                                READ DATA FROM DDRAM or CGRAM
@@ -472,14 +761,16 @@ void lcd_writeData (uint8_t data);
  *               determined by the most recent "set address" instruction that 
  *               was sent (i.e. SET_DDRAM_ADDR or SET_CGRAM_ADDR).
  * 
- * Arguments  : void
+ * Arguments  : lcd     the LCD.
  * 
  * Returns    : byte in either CGRAM or DDRAM at the address pointed at by
  *              the address counter.
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_readData (void);
+uint8_t lcd_readData (lcd_t * lcd);
+
+#endif // LCD_WRITE_ONLY
 
 
 
@@ -490,58 +781,272 @@ uint8_t lcd_readData (void);
  *                                                  WAIT FOR BUSY FLAG TO RESET
  * 
  * Description : Use this function to poll the busy flag. This function will
- *               return once it detects the busy flag is no longer set.
- * 
- * Arguments   : void
+ *               return once it detects the busy flag is no longer set. The
+ *               flag is read immediately and then after each back-off delay
+ *               (BUSY_BACKOFF) for up to BUSY_TIMEOUT_US microseconds (see
+ *               LCD_TIMING.H). lcd_waitBusyUs() does the same, but returns
+ *               the time waited.
+ * 
+ *               If LCD_WRITE_ONLY is defined the busy flag cannot be read. In
+ *               that case this function waits out whatever remains of the 
+ *               execution time of the last instruction or data write.
+ * 
+ *               If LCD_DEADLINE is defined the busy flag is not polled 
+ *               either. Instead, each transfer sets a deadline on the 
+ *               LCD_TIMER time base, its execution time after it was sent,
+ *               and this function only waits for whatever remains of it, so
+ *               work done by the application between LCD calls overlaps the
+ *               controller's execution time.
+ * 
+ *               With LCD_WRITE_ONLY the wait is the Idle operation of the 
+ *               transport (see LCD_BUS.H). With LCD_TWI the execution time is
+ *               queued on the bus, as idle bytes ahead of the next transfer
+ *               (see LCD_TWI.H), and the CPU only waits if the queue is full.
+ *               With LCD_SPI it is waited out from when the last byte was 
+ *               latched.
+ * 
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : Busy Error Flag. BUSY_RESET_SUCCESS if the busy flag was found
  *               to be reset and the LCD's controller is ready to receive the 
  *               next command. BUSY_RESET_TIMEOUT if the flag does not reset 
  *               after a set timeout period.
+ * 
+ *               lcd_waitBusyUs() returns the time waited in microseconds, or
+ *               BUSY_WAIT_TIMEOUT.
  * ----------------------------------------------------------------------------
 */
 
-uint8_t lcd_waitClearBusy (void);
+uint8_t lcd_waitClearBusy (lcd_t * lcd);
+uint16_t lcd_waitBusyUs (lcd_t * lcd);
+
 
+#if !defined (LCD_WRITE_ONLY) || defined (LCD_DEADLINE)
 
 /* 
  * ----------------------------------------------------------------------------
- *                                                             PULSE ENABLE PIN
+ *                                                         CHECK IF LCD IS BUSY
  * 
- * Description : Pulses the enable pin.  
+ * Description : Returns whether the controller is still executing the last
+ *               byte sent, without waiting. The busy flag is read once, or
+ *               with LCD_DEADLINE the deadline is checked.
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
- * Returns     : void
+ * Returns     : 1 if busy, else 0.
  * 
- * Notes       : In order to execute an instruction the enable pin must
- *               transition from high to low. This function performs this
- *               operation by setting the enable pin high and then low. This 
- *               function should be called once all the other necessary pins 
- *               have been set according to the desired instruction and 
- *               settings.
+ * Notes       : Not available with LCD_WRITE_ONLY unless LCD_DEADLINE is
+ *               also defined, as there is then no way to tell how long ago
+ *               the last byte was sent.
  * ----------------------------------------------------------------------------
  */
 
-void lcd_pulseEnable (void);
+uint8_t lcd_isBusy (lcd_t * lcd);
 
+#endif
+
+
+#ifdef LCD_DEADLINE
 
 /* 
  * ----------------------------------------------------------------------------
- *                                                      SEND INSTRUCTION TO LCD
+ *                                                        TIME LEFT OF DEADLINE
+ * 
+ * Description : Returns the time left until the controller has executed the
+ *               last byte sent, from the deadline on LCD_TIMER. Once it has
+ *               passed the deadline is cleared, so that it is not mistaken
+ *               for a pending one after LCD_TIMER wraps (every 65536 ticks).
+ * 
+ * Arguments   : lcd     the LCD.
+ * 
+ * Returns     : Ticks of LCD_TIMER left, 0 if the controller is not busy.
+ * 
+ * Notes       : Requires LCD_DEADLINE.
+ * ----------------------------------------------------------------------------
+ */
+
+uint16_t lcd_deadlineLeft (lcd_t * lcd);
+
+#endif
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                   INSTRUCTION EXECUTION TIME
  * 
- * Description : This function sets the necessary port pins for executing the
- *               instructions and their settings. This function is called by 
- *               all of the instruction functions.
+ * Description : Returns the documented execution time of an instruction, 
+ *               i.e. how long the busy flag remains set after the instruction
+ *               has been sent. The time is taken from a table keyed on the
+ *               instruction bit, which is the highest bit set in instr.
  * 
- * Arguments   : cmd     instruction and settings that are to be executed by
+ * Arguments   : instr     instruction byte, including any settings. 
+ * 
+ * Returns     : Execution time in microseconds. For data reads and writes, 
+ *               use EXEC_DATA_US from LCD_TIMING.H instead.
+ * ----------------------------------------------------------------------------
+ */
+
+uint16_t lcd_execTime (uint8_t instr);
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                      SEND INSTRUCTION TO LCD
+ * 
+ * Description : Sends an instruction and its settings through the transport
+ *               of the LCD, which selects the instruction register for a 
+ *               write, and updates the state tracked in the lcd_t. This 
+ *               function is called by all of the instruction functions. 
+ *               Unlike them, it does not wait for the controller to be 
+ *               ready, so the caller must ensure it is not busy. In 4-bit 
+ *               mode the high nibble is sent first, followed by the low 
+ *               nibble.
+ * 
+ * Arguments   : lcd     the LCD.
+ *               cmd     instruction and settings that are to be executed by
  *                       the LCDs controller.
  * 
  * Returns     : void
  * ----------------------------------------------------------------------------
  */
 
-void lcd_sendInstruction (uint8_t cmd);
+void lcd_sendInstruction (lcd_t * lcd, uint8_t cmd);
+
+
+#ifdef LCD_MULTI_INSTANCE
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                              BROADCAST INSTRUCTION TO 2 LCDS
+ * 
+ * Description : Sends an instruction to two controllers in one bus cycle, by
+ *               raising both of their enables together, and updates the 
+ *               state tracked in both lcd_t. Both controllers are first
+ *               allowed to finish what they are executing. A mode 
+ *               instruction (ENTRY_MODE_SET, DISPLAY_CTRL or FUNCTION_SET)
+ *               is only sent to a controller it would change, so it may be
+ *               sent to one of them alone, or not at all.
+ * 
+ * Arguments   : lcd       the LCD.
+ *               other     the second LCD. It must share the data port and 
+ *                         the RS and RW pins with lcd, as the two 
+ *                         controllers of a 40x4 module do, and have its own 
+ *                         EN pin.
+ *               inst      instruction and settings. It is not validated.
+ * 
+ * Returns     : void
+ * 
+ * Notes       : Requires LCD_MULTI_INSTANCE. Nothing is read from the LCDs
+ *               while both enables are raised.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_broadcastInstruction (lcd_t * lcd, lcd_t * other, uint8_t inst);
+
+#endif // LCD_MULTI_INSTANCE
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                       SHADOW ADDRESS COUNTER
+ * 
+ * Description : Returns the value of the address counter as tracked by the
+ *               driver from the instructions and data it has sent, without
+ *               reading the LCD. lcd_addrIsCGRAM() returns whether the
+ *               address counter points to CGRAM (1) or DDRAM (0), i.e. 
+ *               which "set address" instruction was sent most recently.
+ * 
+ * Arguments   : lcd     the LCD.
+ * 
+ * Returns     : Current value of the address counter.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_addrCounter (lcd_t * lcd);
+uint8_t lcd_addrIsCGRAM (lcd_t * lcd);
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                               DISPLAY POSITION OF AN ADDRESS
+ * 
+ * Description : Returns the display position of a DDRAM address, packed as
+ *               by LCD_ADDR_POS() of LCD_ADDR.H. The position is read from
+ *               the LCD_ADDR table in flash for the LCD_GEOMETRY profile, or
+ *               found from the lines set by lcd_config() with
+ *               LCD_MULTI_INSTANCE.
+ * 
+ * Arguments   : lcd      the LCD.
+ *               addr     DDRAM address.
+ * 
+ * Returns     : Packed position, for POS_ROW() and POS_COL(), or POS_NONE if
+ *               the address is not a visible position.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_addrToPos (lcd_t * lcd, uint8_t addr);
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                            SHADOW ENTRY MODE
+ * 
+ * Description : Returns the ENTRY_MODE_SET settings most recently sent to the
+ *               LCD, as tracked by the driver, i.e. INCREMENT and/or 
+ *               DISPLAY_SHIFT_DATA.
+ * 
+ * Arguments   : lcd     the LCD.
+ * 
+ * Returns     : Current entry mode settings.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_entryMode (lcd_t * lcd);
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                        RESYNC MODE REGISTERS
+ * 
+ * Description : The driver keeps copies of the ENTRY_MODE_SET, DISPLAY_CTRL
+ *               and FUNCTION_SET settings last sent, and lcd_entryModeSet(),
+ *               lcd_displayCtrl() and lcd_functionSet() do not send an 
+ *               instruction that would not change them. lcd_resyncModes() 
+ *               sends all three again regardless, e.g. after a power glitch
+ *               may have reset the controller. lcd_modeSkips() returns the 
+ *               number of instructions that have been skipped.
+ * 
+ * Arguments   : lcd       the LCD.
+ *               instr     ENTRY_MODE_SET, DISPLAY_CTRL or FUNCTION_SET.
+ * 
+ * Returns     : Number of skipped instructions of type instr, or 0 if instr
+ *               is not one of the above.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_resyncModes (lcd_t * lcd);
+uint16_t lcd_modeSkips (lcd_t * lcd, uint8_t instr);
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                             SEND DATA TO LCD
+ * 
+ * Description : Sends the data byte to the LCD through its transport, which
+ *               selects the data register for a write. Unlike 
+ *               lcd_writeData(), this does not wait for the controller to be
+ *               ready, so the caller must ensure it is not busy.
+ * 
+ * Arguments   : lcd      the LCD.
+ *               data     data byte that will be written to the DDRAM or 
+ *                        CGRAM at the location pointed to by the address 
+ *                        counter.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_sendData (lcd_t * lcd, uint8_t data);
 
 
 /* 
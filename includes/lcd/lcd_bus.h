@@ -0,0 +1,194 @@
+/*
+ * File        : LCD_BUS.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * The transport layer between the instruction functions of LCD_BASE and the
+ * pins of the LCD. LCD_BASE validates the instructions and their settings,
+ * tracks the controller state and decides how long to wait between bytes. A
+ * transport only moves bytes, setting RS and RW for each itself, through
+ * these operations:
+ *
+ * Init          : sets up the pins or peripheral, with EN low. Called by
+ *                 lcd_init() and lcd_warmInit().
+ * WriteNibble   : sends the high nibble of an instruction on DB4-DB7, for
+ *                 the 4-bit initialization sequence. The nibble has reached
+ *                 the LCD when it returns.
+ * WriteInstr    : sends an instruction byte (RS = 0, RW = 0).
+ * WriteData     : sends a data byte (RS = 1, RW = 0).
+ * WriteDataNext : sends a data byte of a run after the first, which was
+ *                 sent by WriteData, with only a wait for the controller in
+ *                 between. RS need not be selected again if that wait does
+ *                 not change it, so a run costs one register select.
+ * ReadStatus    : reads the busy flag and address counter (RS = 0, RW = 1).
+ * ReadData      : reads a data byte (RS = 1, RW = 1).
+ * Idle          : waits out the execution time of the last byte sent, in
+ *                 microseconds, before the next transfer. Used in place of
+ *                 polling the busy flag with LCD_WRITE_ONLY.
+ *
+ * The transports are LCD_PAR (the parallel ports, by default), LCD_TWI (a
+ * PCF8574 I2C backpack) and LCD_SPI (a 74HC595 shift register). ReadStatus
+ * and ReadData are only provided by LCD_PAR, without LCD_WRITE_ONLY.
+ *
+ * By default the transport is chosen at compile time, LCD_TWI or LCD_SPI if
+ * either is defined, else LCD_PAR, and each operation is a direct call to its
+ * function, e.g. BUS_WRITE_DATA (lcd, data) is lcd_parWriteData (lcd, data).
+ * Build with -DLCD_BUS_RUNTIME to choose it at run time instead, for each
+ * lcd_t with lcd_setBus(), from the operation tables of the transports built
+ * in. LCD_PAR is then always built, as are LCD_TWI and LCD_SPI if defined,
+ * and each operation is a call through the table of the lcd_t. The build
+ * options implied by a transport (e.g. 4-bit mode and LCD_WRITE_ONLY for
+ * LCD_TWI) then apply to all of them.
+ */
+
+#ifndef LCD_BUS_H
+#define LCD_BUS_H
+
+#include <stdint.h>
+#include "lcd_base.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             TRANSPORTS BUILT
+ *
+ * LCD_PAR is defined if the parallel transport is built, i.e. with
+ * LCD_BUS_RUNTIME or if no other transport is selected.
+ * ----------------------------------------------------------------------------
+ */
+
+#if defined (LCD_TWI) && defined (LCD_SPI) && !defined (LCD_BUS_RUNTIME)
+  #error "LCD_TWI and LCD_SPI can only both be defined with LCD_BUS_RUNTIME"
+#endif
+
+#if defined (LCD_BUS_RUNTIME) || !(defined (LCD_TWI) || defined (LCD_SPI))
+  #ifndef LCD_PAR
+  #define LCD_PAR
+  #endif
+#endif
+
+#include "lcd_par.h"
+#ifdef LCD_TWI
+#include "lcd_twi.h"
+#endif
+#ifdef LCD_SPI
+#include "lcd_spi.h"
+#endif
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            DEFAULT TRANSPORT
+ *
+ * LCD_BUS_PREFIX : prefix of the function names of the transport chosen at
+ *                  compile time.
+ *
+ * LCD_BUS_DEFAULT : with LCD_BUS_RUNTIME, the operation table of the same
+ *                   transport, e.g. for lcd_setBus().
+ * ----------------------------------------------------------------------------
+ */
+
+#if defined (LCD_TWI)
+  #define LCD_BUS_PREFIX     lcd_twi
+  #define LCD_BUS_DEFAULT    (&lcd_busTwi)
+#elif defined (LCD_SPI)
+  #define LCD_BUS_PREFIX     lcd_spi
+  #define LCD_BUS_DEFAULT    (&lcd_busSpi)
+#else
+  #define LCD_BUS_PREFIX     lcd_par
+  #define LCD_BUS_DEFAULT    (&lcd_busPar)
+#endif
+
+// pastes an operation name onto LCD_BUS_PREFIX once it has been expanded.
+#define BUS_CAT2(pre, op)    pre ## op
+#define BUS_CAT(pre, op)     BUS_CAT2 (pre, op)
+#define BUS_FN(op)           BUS_CAT (LCD_BUS_PREFIX, op)
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                   OPERATIONS
+ *
+ * Used by LCD_BASE to call the operations of the transport of an LCD, a
+ * pointer named lcd. See the description above.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifdef LCD_BUS_RUNTIME
+  #define BUS_INIT(lcd)              ((lcd)->bus->init (lcd))
+  #define BUS_WRITE_NIBBLE(lcd, nib) ((lcd)->bus->writeNibble (lcd, nib))
+  #define BUS_WRITE_INSTR(lcd, inst) ((lcd)->bus->writeInstr (lcd, inst))
+  #define BUS_WRITE_DATA(lcd, data)  ((lcd)->bus->writeData (lcd, data))
+  #define BUS_WRITE_DATA_NEXT(lcd, data)                                      \
+                                     ((lcd)->bus->writeDataNext (lcd, data))
+  #define BUS_READ_STATUS(lcd)       ((lcd)->bus->readStatus (lcd))
+  #define BUS_READ_DATA(lcd)         ((lcd)->bus->readData (lcd))
+  #define BUS_IDLE(lcd, us)          ((lcd)->bus->idle (lcd, us))
+#else
+  #define BUS_INIT(lcd)              BUS_FN (Init) (lcd)
+  #define BUS_WRITE_NIBBLE(lcd, nib) BUS_FN (WriteNibble) (lcd, nib)
+  #define BUS_WRITE_INSTR(lcd, inst) BUS_FN (WriteInstr) (lcd, inst)
+  #define BUS_WRITE_DATA(lcd, data)  BUS_FN (WriteData) (lcd, data)
+  #define BUS_WRITE_DATA_NEXT(lcd, data)                                      \
+                                     BUS_FN (WriteDataNext) (lcd, data)
+  #define BUS_READ_STATUS(lcd)       BUS_FN (ReadStatus) (lcd)
+  #define BUS_READ_DATA(lcd)         BUS_FN (ReadData) (lcd)
+  #define BUS_IDLE(lcd, us)          BUS_FN (Idle) (lcd, us)
+#endif // LCD_BUS_RUNTIME
+
+
+/*
+ ******************************************************************************
+ *                                    TYPES
+ ******************************************************************************
+ */
+
+//
+// The operations of a transport, for LCD_BUS_RUNTIME. readStatus and
+// readData are NULL for a transport that cannot read from the LCD.
+//
+typedef struct lcd_bus
+{
+  void    (*init)          (lcd_t * lcd);
+  void    (*writeNibble)   (lcd_t * lcd, uint8_t nib);
+  void    (*writeInstr)    (lcd_t * lcd, uint8_t inst);
+  void    (*writeData)     (lcd_t * lcd, uint8_t data);
+  void    (*writeDataNext) (lcd_t * lcd, uint8_t data);
+  uint8_t (*readStatus)    (lcd_t * lcd);
+  uint8_t (*readData)      (lcd_t * lcd);
+  void    (*idle)          (lcd_t * lcd, uint16_t us);
+} lcd_bus_t;
+
+
+/*
+ ******************************************************************************
+ *                                   VARIABLES
+ ******************************************************************************
+ */
+
+#ifdef LCD_BUS_RUNTIME
+
+// operation tables of the transports built, for lcd_setBus() of LCD_BASE.H.
+#ifdef LCD_PAR
+extern const lcd_bus_t lcd_busPar;
+#endif
+#ifdef LCD_TWI
+extern const lcd_bus_t lcd_busTwi;
+#endif
+#ifdef LCD_SPI
+extern const lcd_bus_t lcd_busSpi;
+#endif
+
+#endif // LCD_BUS_RUNTIME
+
+
+#endif // LCD_BUS_H
@@ -0,0 +1,205 @@
+/*
+ * File        : LCD_DUAL.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for 40x4 modules, which have two HD44780 controllers that share
+ * the data bus and the RS and RW pins and have their own EN pin. The first
+ * controller shows display lines 1 and 2, and the second lines 3 and 4, each
+ * as a 2-line display. This module presents them as one 4-line surface:
+ * rows 0 and 1 are routed to the first controller and rows 2 and 3 to the
+ * second.
+ *
+ * Each controller keeps its own lcd_t, so the address counter, busy state
+ * and cached mode settings are tracked per controller. Instructions that
+ * apply to the whole surface (clear, return home, entry mode and display
+ * control) are broadcast to both controllers in one bus cycle by raising
+ * both enables together, see lcd_broadcastInstruction(). Only the controller
+ * that holds the cursor shows it, and it is moved between the controllers
+ * as the position written moves between their rows.
+ *
+ * Requires LCD_MULTI_INSTANCE. The functions of LCD_BASE, LCD_SF and
+ * LCD_MOVE can still be called for either controller, with lcd_dualCtrl(),
+ * and both can be attached to LCD_SCHED to interleave their writes.
+ */
+
+#ifndef LCD_DUAL_H
+#define LCD_DUAL_H
+
+#include <stdint.h>
+#include "lcd_base.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+// display lines of the surface, and of each controller.
+#define LCD_DUAL_ROWS        4
+#define LCD_DUAL_CTRL_ROWS   2
+
+
+/*
+ ******************************************************************************
+ *                                    TYPES
+ ******************************************************************************
+ */
+
+//
+// A 4-line surface made of two controllers. The members are not for use by
+// the application.
+//
+typedef struct
+{
+  lcd_t * ctrl[2];                       // lines 1-2 and lines 3-4
+  uint8_t cur;                           // controller holding the cursor
+  uint8_t display;                       // DISPLAY_CTRL settings
+} lcd_dual_t;
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       INITIALIZE THE SURFACE
+ *
+ * Description : Binds the two controllers to the surface and sets the
+ *               display control of both from the first, with the cursor on
+ *               the first. The controllers must each have been configured
+ *               with lcd_config() as 2-line displays of the same width and
+ *               initialized with lcd_init().
+ *
+ * Arguments   : dual       the surface.
+ *               top        controller of lines 1 and 2.
+ *               bottom     controller of lines 3 and 4.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if the controllers do not share
+ *               the data and control ports and the RS and RW pins, have the
+ *               same EN pin, or are not 2-line displays of the same width.
+ *               Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_dualInit (lcd_dual_t * dual, lcd_t * top, lcd_t * bottom);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          CONTROLLER OF A ROW
+ *
+ * Description : Returns the controller that shows a row of the surface, for
+ *               calling the LCD_BASE, LCD_SF and LCD_MOVE functions on it.
+ *               Its display lines are rows 0 and 1 of the surface, or 2 and
+ *               3.
+ *
+ * Arguments   : dual     the surface.
+ *               row      row of the surface, 0 to LCD_DUAL_ROWS - 1.
+ *
+ * Returns     : The controller, or NULL if row is out of range.
+ * ----------------------------------------------------------------------------
+ */
+
+lcd_t * lcd_dualCtrl (lcd_dual_t * dual, uint8_t row);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       BROADCAST INSTRUCTIONS
+ *
+ * Description : Carry out the instruction on the whole surface, in one bus
+ *               cycle for both controllers.
+ *
+ *               lcd_dualClear()         : clears both controllers, and moves
+ *                                         the cursor to row 0, column 0.
+ *               lcd_dualReturnHome()    : returns both controllers home, and
+ *                                         moves the cursor to row 0, column
+ *                                         0.
+ *               lcd_dualEntryModeSet()  : as lcd_entryModeSet().
+ *               lcd_dualDisplayCtrl()   : as lcd_displayCtrl(). CURSOR_ON and
+ *                                         BLINKING_ON only apply to the
+ *                                         controller holding the cursor, in
+ *                                         which case the two controllers are
+ *                                         sent different settings.
+ *
+ * Arguments   : dual        the surface.
+ *               setting     the settings of the instruction.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if the setting is not valid for
+ *               the instruction. Otherwise LCD_INSTR_SUCCESS.
+ *
+ * Notes       : As with a single controller, an entry mode or display
+ *               control setting is not sent to a controller that already
+ *               holds it.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_dualClear (lcd_dual_t * dual);
+void lcd_dualReturnHome (lcd_dual_t * dual);
+uint8_t lcd_dualEntryModeSet (lcd_dual_t * dual, uint8_t setting);
+uint8_t lcd_dualDisplayCtrl (lcd_dual_t * dual, uint8_t setting);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                               GO TO POSITION
+ *
+ * Description : Sets the address counter of the controller that shows row
+ *               to the position, as lcd_gotoXY() does, and moves the cursor
+ *               to that controller.
+ *
+ * Arguments   : dual     the surface.
+ *               row      row of the surface, 0 to LCD_DUAL_ROWS - 1.
+ *               col      position in the row, 0 to the width - 1.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if row or col is out of range, in
+ *               which case nothing is sent. Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_dualGotoXY (lcd_dual_t * dual, uint8_t row, uint8_t col);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         WRITE TO THE SURFACE
+ *
+ * Description : lcd_dualWriteData() writes a character at the address
+ *               counter of the controller holding the cursor.
+ *
+ *               lcd_dualWriteAt() and lcd_dualWriteBufAt() write a string or
+ *               buffer from a position, continuing at the start of the next
+ *               row (0 -> 1 -> 2 -> 3 -> 0) when a row is filled, on
+ *               whichever controller shows it. Each row is written as
+ *               lcd_writeBufAt() does. The cursor is left on the controller
+ *               of the last row written.
+ *
+ * Arguments   : dual     the surface.
+ *               data     the character.
+ *               row      row of the surface, 0 to LCD_DUAL_ROWS - 1.
+ *               col      position in the row, 0 to the width - 1.
+ *               str      null-terminated string, of up to 255 characters.
+ *               buf      pointer to the characters to write.
+ *               len      number of characters in buf.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if row or col is out of range, in
+ *               which case nothing is written. Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_dualWriteData (lcd_dual_t * dual, uint8_t data);
+uint8_t lcd_dualWriteAt (lcd_dual_t * dual, uint8_t row, uint8_t col,
+                         const char * str);
+uint8_t lcd_dualWriteBufAt (lcd_dual_t * dual, uint8_t row, uint8_t col,
+                            const uint8_t * buf, uint8_t len);
+
+
+#endif // LCD_DUAL_H
@@ -0,0 +1,164 @@
+/*
+ * File        : LCD_FB.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for a shadow framebuffer of the LCD's visible DDRAM. Characters
+ * are drawn into an SRAM copy of the display, with one dirty bit per cell
+ * recording which cells differ from what was last sent to the LCD. Calling
+ * lcd_flush() then sends only the changed cells, walking the display in
+ * DDRAM address order so that runs of changed cells are written back to back
+ * and the cursor is only moved, by LCD_MOVE, when the next changed cell does
+ * not directly follow the last one written.
+ *
+ * Rows and columns are numbered from 0, i.e. row 0 is display line 1. The
+ * display geometry and row addresses are taken from LCD_ADDR.H.
+ *
+ * lcd_flush() requires the ENTRY_MODE_SET to be INCREMENT without display
+ * shift, which is the mode set by lcd_init().
+ */
+
+#ifndef LCD_FB_H
+#define LCD_FB_H
+
+#include <avr/io.h>
+#include "lcd_base.h"
+#include "lcd_addr.h"
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   INITIALIZE THE FRAMEBUFFER
+ *
+ * Description : Fills the framebuffer with spaces and marks every cell clean.
+ *               This matches the display contents after lcd_init() or
+ *               lcd_clearDisplay(), so it should be called after either. The
+ *               framebuffer is also registered with lcd_moveSetFill() so
+ *               lcd_flush() can move the cursor forward by rewriting cells.
+ *
+ * Arguments   : lcd     the LCD that lcd_flush() will send the cells to. 
+ *                       With LCD_MULTI_INSTANCE it must have LCD_ROWS lines
+ *                       of LCD_COLS characters.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_fbInit (lcd_t * lcd);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   INVALIDATE THE FRAMEBUFFER
+ *
+ * Description : Marks every cell dirty so the next lcd_flush() rewrites the
+ *               whole display, e.g. if the display contents were changed
+ *               without going through the framebuffer.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_fbInvalidate (void);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    DRAW INTO THE FRAMEBUFFER
+ *
+ * Description : lcd_fbPutc() sets the character of a single cell.
+ *               lcd_fbPuts() sets consecutive cells of a row to the
+ *               characters of a string, stopping at the end of the row.
+ *               lcd_fbClear() sets every cell to a space. Only cells whose
+ *               character actually changes are marked dirty. Nothing is sent
+ *               to the LCD until lcd_flush() is called.
+ *
+ * Arguments   : row     display row, 0 to LCD_ROWS - 1.
+ *               col     display column, 0 to LCD_COLS - 1.
+ *               c       character to place in the cell.
+ *               str     null-terminated string to place in the row.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if row or col is out of range.
+ *               Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_fbPutc (uint8_t row, uint8_t col, uint8_t c);
+uint8_t lcd_fbPuts (uint8_t row, uint8_t col, const char * str);
+void lcd_fbClear (void);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    READ FROM THE FRAMEBUFFER
+ *
+ * Description : Returns the character currently held by a cell of the
+ *               framebuffer.
+ *
+ * Arguments   : row     display row, 0 to LCD_ROWS - 1.
+ *               col     display column, 0 to LCD_COLS - 1.
+ *
+ * Returns     : Character in the cell, or 0 if row or col is out of range.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_fbGetc (uint8_t row, uint8_t col);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        CGRAM SLOT REFERENCES
+ *
+ * Description : Returns the number of cells of the framebuffer that hold the
+ *               character code of a CGRAM slot, i.e. 0x00-0x07 or its mirror
+ *               0x08-0x0F, plus the number of cells that still show it on
+ *               the display. Used by LCD_GLYPH to avoid replacing a glyph
+ *               that is on the display, or will be after lcd_flush().
+ *
+ * Arguments   : slot     CGRAM slot, 0 to 7.
+ *
+ * Returns     : Number of cells referencing the slot.
+ *
+ * Notes       : Cells that have been changed but not yet flushed still show
+ *               their old character until lcd_flush() is called, so they
+ *               are counted for the old character as well as the new one.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_fbGlyphRefs (uint8_t slot);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         FLUSH TO THE DISPLAY
+ *
+ * Description : Sends every dirty cell to the LCD and marks it clean. The
+ *               display is walked in DDRAM address order and the cursor is
+ *               only moved, with lcd_moveFillTo(), when the next dirty cell
+ *               does not directly follow the last one written.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ *
+ * Notes       : On return the address counter points to the cell after the
+ *               last one written, so the cursor should be repositioned if it
+ *               is visible.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_flush (void);
+
+
+#endif // LCD_FB_H
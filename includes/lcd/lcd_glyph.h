@@ -0,0 +1,111 @@
+/*
+ * File        : LCD_GLYPH.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for managing the controller's 8 custom character (CGRAM) slots
+ * as a cache of glyphs. A glyph is identified by a pointer to its bitmap in
+ * flash: 8 bytes, one per row of the 5x8 character, top row first, with the
+ * row's pixels in the lower 5 bits. E.g.
+ *
+ *   const uint8_t bell[8] PROGMEM = { 0x04, 0x0E, 0x0E, 0x0E,
+ *                                     0x1F, 0x00, 0x04, 0x00 };
+ *
+ *   lcd_fbPutc (0, 19, lcd_glyphAcquire (bell));
+ *
+ * lcd_glyphAcquire() returns the slot holding the glyph, and only uploads the
+ * bitmap if the glyph is not already resident. When a slot must be reused,
+ * the least recently acquired glyph is evicted, skipping any slot that is
+ * referenced by a cell of the framebuffer, or still shown by a cell that
+ * has not been flushed since it changed (see lcd_fbGlyphRefs()), so that
+ * characters on screen are never changed. Glyphs should therefore be placed
+ * on the display through LCD_FB.
+ *
+ * Uploading moves the address counter to CGRAM. It is restored afterwards
+ * from the address counter tracked by LCD_BASE, without reading the LCD.
+ * The rows are written with the entry mode set to INCREMENT, and the mode
+ * in use beforehand is then restored.
+ */
+
+#ifndef LCD_GLYPH_H
+#define LCD_GLYPH_H
+
+#include <avr/io.h>
+#include "lcd_base.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+#define GLYPH_SLOTS          8              // CGRAM slots for 5x8 characters
+#define GLYPH_ROWS           8              // bytes per glyph bitmap
+
+// returned by lcd_glyphAcquire() if every slot is in use on the display.
+#define GLYPH_NO_SLOT        0xFF
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   INITIALIZE THE GLYPH CACHE
+ *
+ * Description : Marks every slot empty. Should be called after lcd_init(),
+ *               as the CGRAM contents are not known at that point.
+ *
+ * Arguments   : lcd     the LCD whose CGRAM is to be managed.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_glyphInit (lcd_t * lcd);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              ACQUIRE A GLYPH
+ *
+ * Description : Returns the CGRAM slot that holds the glyph. If the glyph is
+ *               not resident, it is uploaded to an empty slot or, if there is
+ *               none, to the least recently acquired slot not referenced by
+ *               the framebuffer or still shown on the display. The DDRAM or
+ *               CGRAM address held in the address counter and the entry
+ *               mode beforehand are restored.
+ *
+ * Arguments   : glyph     pointer to the glyph's 8-byte bitmap in flash.
+ *
+ * Returns     : Slot, 0 to GLYPH_SLOTS - 1, which is the character code to
+ *               write to display the glyph. GLYPH_NO_SLOT if every slot is
+ *               referenced by the framebuffer or the display.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_glyphAcquire (const uint8_t * glyph);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                GLYPH UPLOADS
+ *
+ * Description : Returns the number of glyphs uploaded to CGRAM since
+ *               lcd_glyphInit(), i.e. the number of cache misses.
+ *
+ * Arguments   : void
+ * ----------------------------------------------------------------------------
+ */
+
+uint16_t lcd_glyphUploads (void);
+
+
+#endif // LCD_GLYPH_H
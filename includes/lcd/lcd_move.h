@@ -0,0 +1,177 @@
+/*
+ * File        : LCD_MOVE.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for moving the cursor (address counter) to a display position at
+ * the lowest cost. Starting from the address counter tracked by LCD_BASE, the
+ * cost of each way of reaching the target is estimated and the cheapest is
+ * used. The candidates are:
+ *
+ *   - nothing, if the address counter is already at the target.
+ *   - a single SET_DDRAM_ADDR instruction.
+ *   - rewriting the characters between the address counter and the target,
+ *     within a display line, supplied by the fill function registered with
+ *     lcd_moveSetFill(). Only considered by lcd_moveFillTo().
+ *
+ * Rewriting leaves the display unchanged only if the fill function returns
+ * what each cell shows. The framebuffer's clean cells do (see LCD_FB), but
+ * not once anything has been written around it, so lcd_moveCursor() and
+ * lcd_moveToAddr(), which LCD_SF uses, never rewrite, and lcd_moveFillTo()
+ * is used by lcd_flush() alone.
+ *
+ * The cost of each is the time to transfer its bytes over the transport plus
+ * their execution time. Cursor shifts and RETURN_HOME are not considered, as
+ * they cost at least as much as a SET_DDRAM_ADDR on every transport.
+ *
+ * On the parallel ports and with LCD_SPI the execution time dominates, and
+ * a SET_DDRAM_ADDR (37us) is always cheaper than a character (43us). With
+ * LCD_TWI each byte takes 4 bytes to the expander, and an instruction
+ * between two characters takes 2 more to set RS up before it and again
+ * after it, so rewriting a single character is cheaper.
+ *
+ * The display is assumed not to be shifted, as with LCD_FB.
+ */
+
+#ifndef LCD_MOVE_H
+#define LCD_MOVE_H
+
+#include <avr/io.h>
+#include "lcd_base.h"
+#include "lcd_timing.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                   MOVE COSTS
+ *
+ * Costs are in microseconds. With LCD_BUS_RUNTIME the costs are those of
+ * the default transport (see LCD_BUS.H).
+ *
+ * LCD_MOVE_UNIT_US  : Time to transfer one unit over the transport: an
+ *                     enable cycle on the parallel ports, or a byte to the
+ *                     expander (LCD_TWI) or shift register (LCD_SPI).
+ * LCD_MOVE_MAX_FILL : Most characters that will be rewritten to move the
+ *                     cursor forward.
+ *
+ * MOVE_UNITS_DATA   : Units for a character written after another.
+ * MOVE_UNITS_INSTR  : Units for an instruction between two characters,
+ *                     including any that set up RS before it and before
+ *                     the next character.
+ *
+ * MOVE_COST_INSTR   : One SET_DDRAM_ADDR.
+ * MOVE_COST_DATA    : One character written.
+ * ----------------------------------------------------------------------------
+ */
+
+#if defined (LCD_TWI) || defined (LCD_SPI)
+  #define MOVE_UNITS_DATA    4                 /* 2 bytes per nibble */
+  #define MOVE_UNITS_INSTR   6                 /* and 2 RS setup bytes */
+#elif (LCD_DATA_LENGTH == DATA_LENGTH_4_BITS)
+  #define MOVE_UNITS_DATA    2
+  #define MOVE_UNITS_INSTR   2
+#else
+  #define MOVE_UNITS_DATA    1
+  #define MOVE_UNITS_INSTR   1
+#endif
+
+#ifndef LCD_MOVE_UNIT_US
+#if defined (LCD_TWI)
+// 9 SCL periods per byte, with the acknowledge.
+#define LCD_MOVE_UNIT_US     ((9 * 1000000UL + LCD_TWI_FREQ - 1)           \
+                              / LCD_TWI_FREQ)
+#elif defined (LCD_SPI)
+// 8 SCK periods at fosc/2.
+#define LCD_MOVE_UNIT_US     ((16 * 1000000UL + F_CPU - 1) / F_CPU)
+#else
+#define LCD_MOVE_UNIT_US     ((T_CYC_E + 999) / 1000)
+#endif
+#endif // LCD_MOVE_UNIT_US
+
+#ifndef LCD_MOVE_MAX_FILL
+#define LCD_MOVE_MAX_FILL    4
+#endif // LCD_MOVE_MAX_FILL
+
+#define MOVE_COST_INSTR      (MOVE_UNITS_INSTR * LCD_MOVE_UNIT_US + EXEC_SHORT_US)
+#define MOVE_COST_DATA       (MOVE_UNITS_DATA * LCD_MOVE_UNIT_US + EXEC_DATA_US)
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                     MOVE THE ADDRESS COUNTER
+ *
+ * Description : Moves the address counter to the given display position, or
+ *               DDRAM address, with a SET_DDRAM_ADDR. Nothing is sent if
+ *               the address counter is already there.
+ *
+ * Arguments   : lcd      the LCD.
+ *               row      display line, 0 (line 1) to LCD_ROWS - 1.
+ *               col      position in the line, 0 to LCD_COLS - 1.
+ *               addr     DDRAM address.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if row or col is out of range, or
+ *               addr is not a DDRAM address. Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_moveCursor (lcd_t * lcd, uint8_t row, uint8_t col);
+uint8_t lcd_moveToAddr (lcd_t * lcd, uint8_t addr);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                        MOVE THE ADDRESS COUNTER BY REWRITING
+ *
+ * Description : Moves the address counter to the given DDRAM address as
+ *               lcd_moveToAddr() does, but also considers rewriting the
+ *               characters in between from the registered fill function.
+ *               The caller must ensure those characters are what the
+ *               display shows, as lcd_flush() does.
+ *
+ * Arguments   : lcd      the LCD.
+ *               addr     DDRAM address.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if addr is not a DDRAM address.
+ *               Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_moveFillTo (lcd_t * lcd, uint8_t addr);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       REGISTER FILL FUNCTION
+ *
+ * Description : Registers the function that supplies the characters shown
+ *               on the display, allowing lcd_moveFillTo() to move the
+ *               cursor forward by rewriting them. lcd_fbInit() registers
+ *               the framebuffer.
+ *
+ * Arguments   : lcd      the LCD.
+ *               fill     function returning the character to write at a
+ *                        visible DDRAM address. NULL disables rewriting.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_moveSetFill (lcd_t * lcd, uint8_t (*fill)(uint8_t addr));
+
+
+#endif // LCD_MOVE_H
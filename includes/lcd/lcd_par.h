@@ -0,0 +1,305 @@
+/*
+ * File        : LCD_PAR.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for an LCD wired directly to the ports of the AVR, the default
+ * transport of LCD_BUS.H. The data bus is DB0-DB7, or DB4-DB7 in 4-bit mode,
+ * on the data port, and RS, RW and EN are on the control port. Each
+ * transfer sets RS and RW for itself, places the byte on the data port and
+ * pulses EN, with the setup, pulse width and enable cycle times of
+ * LCD_TIMING.H.
+ */
+
+#ifndef LCD_PAR_H
+#define LCD_PAR_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "lcd_base.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+#define DDR_INPUT            0x00           /* use to set DDRs to input */
+#define DDR_OUTPUT           0xFF           /* use to set DDRs to output */
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 CONTROL PORT
+ *
+ * The control port contains the 3 control PINS - Register select, Read/Write,
+ * and Enable.
+ *
+ * RS : Determines whether to access the data or instruction register.
+ *  0 - Data Register is selected
+ *  1 - Instruction Register is selected
+ *
+ * RW : Determines whether operating in Read or Write mode.
+ *  0 = Write mode
+ *  1 = Read mode
+ *
+ * Boards that tie RW to ground should be built with -DLCD_WRITE_ONLY. In this
+ * mode the RW pin is not used, READ_MODE is not defined, and the functions
+ * that read from the LCD are not available. Instead of polling the busy flag,
+ * the driver waits the execution time of the most recent instruction or data
+ * write, as given by lcd_execTime().
+ *
+ * With LCD_MULTI_INSTANCE the ports and pins are those set in the lcd_t by
+ * lcd_config(), and these macros refer to the lcd_t pointed to by a variable
+ * named lcd, which must be in scope where they are used.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifdef LCD_MULTI_INSTANCE
+  #define CTRL_DDR           LCD_REG (lcd->ctrlDdr)
+  #define CTRL_PORT          LCD_REG (lcd->ctrlPort)
+  #define RS_MASK            (lcd->rsMask)
+  #define RW_MASK            (lcd->rwMask)
+  #define EN_MASK            (lcd->enMask)
+#else
+  #define CTRL_DDR           DDRC         /* Control Port Direction Register */
+  #define CTRL_PORT          PORTC
+  #define RS                 PC0                           /* Reg select */
+  #define RW                 PC1                           /* Read/Write */
+  #define EN                 PC2                           /* Enable */
+  #define RS_MASK            (1 << RS)
+  #define RW_MASK            (1 << RW)
+  #define EN_MASK            (1 << EN)
+#endif // LCD_MULTI_INSTANCE
+
+// REGISTER SELECT
+#define DATA_REG_SELECT      CTRL_PORT &= ~RS_MASK         /* RS = 0 */
+#define INSTR_REG_SELECT     CTRL_PORT |=  RS_MASK         /* RS = 1 */
+
+// READ/WRITE
+#ifdef LCD_WRITE_ONLY
+  #define WRITE_MODE         (void)0                       /* RW tied low */
+  #define CTRL_MASK          (RS_MASK | EN_MASK)
+#else
+  #define WRITE_MODE         CTRL_PORT &= ~RW_MASK         /* RW = 0 */
+  #define READ_MODE          CTRL_PORT |=  RW_MASK         /* RW = 1 */
+  #define CTRL_MASK          (RS_MASK | RW_MASK | EN_MASK)
+#endif
+
+// ENABLE
+#define ENABLE_LO            CTRL_PORT &= ~EN_MASK         /* EN = 0 */
+#define ENABLE_HI            CTRL_PORT |=  EN_MASK         /* EN = 1 */
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    DATA PORT
+ *
+ * Macros to define the data port and pins.
+ *
+ * Notes: To write values to PINS that are to be sent to the LCD's controller,
+ *        then must write to the chosesn AVR PORT when the pins are configured
+ *        for output. When reading in PIN values set by the LCD, then must read
+ *        the PIN register (not the PORT) when the chosen AVR port pins are
+ *        configured for input. Therefore, from the macros below, use DATA_PORT
+ *        when sending values and DATA_PIN when retrieving values. Use
+ *        DATA_DDR to set whether the pins are input or output. Though the
+ *        data direction for each pin can be set individually, this should not
+ *        be necessary in this implementation. To set all the port pins to
+ *        output, DATA_DDR = 0xFF and for input, DATA_DDR = 0.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifdef LCD_MULTI_INSTANCE
+  #define DATA_DDR           LCD_REG (lcd->dataDdr)
+  #define DATA_PORT          LCD_REG (lcd->dataPort)
+  #define DATA_PIN           LCD_REG (lcd->dataPin)
+#else
+  #define DATA_DDR           DDRA           /* Data Port Direction Register */
+  #define DATA_PORT          PORTA          /* for sending OUT values */
+  #define DATA_PIN           PINA           /* for reading IN values */
+#endif // LCD_MULTI_INSTANCE
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                               4-BIT DATA BUS
+ *
+ * In 4-bit mode only DB4-DB7 of the LCD are connected. These are wired to
+ * four consecutive pins of DATA_PORT, starting at DATA_NIBBLE_SHIFT (PA4-PA7
+ * by default). The other four pins of the port are never modified by the
+ * driver, so they remain available to the application.
+ *
+ * Use DATA_BUS_INPUT and DATA_BUS_OUTPUT to set the direction of only the
+ * pins that are used by the LCD.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef DATA_NIBBLE_SHIFT
+#define DATA_NIBBLE_SHIFT    4
+#endif // DATA_NIBBLE_SHIFT
+
+#define DATA_NIBBLE_MASK     (0x0F << DATA_NIBBLE_SHIFT)
+
+#if (LCD_DATA_LENGTH == DATA_LENGTH_4_BITS)
+  #define DATA_BUS_INPUT     DATA_DDR &= ~DATA_NIBBLE_MASK
+  #define DATA_BUS_OUTPUT    DATA_DDR |=  DATA_NIBBLE_MASK
+#else
+  #define DATA_BUS_INPUT     DATA_DDR = DDR_INPUT
+  #define DATA_BUS_OUTPUT    DATA_DDR = DDR_OUTPUT
+#endif
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         INITIALIZE THE PORTS
+ *
+ * Description : Sets the data and control ports to outputs, with enable low
+ *               and the pins set for an instruction write. Called by
+ *               lcd_init() and lcd_warmInit().
+ *
+ * Arguments   : lcd     the LCD.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_parInit (lcd_t * lcd);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               WRITE AN INITIALIZATION NIBBLE
+ *
+ * Description : Places the lower 4 bits of nib on the DB4-DB7 pins and pulses
+ *               the enable pin to latch them, with the pins left as
+ *               lcd_parInit() set them. Only the pins in DATA_NIBBLE_MASK are
+ *               modified.
+ *
+ * Arguments   : lcd     the LCD.
+ *               nib     high nibble of an instruction, in the lower 4 bits.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_parWriteNibble (lcd_t * lcd, uint8_t nib);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 WRITE AN INSTRUCTION OR DATA
+ *
+ * Description : Selects the instruction (lcd_parWriteInstr()) or data
+ *               (lcd_parWriteData()) register for a write and writes the
+ *               byte over the data bus. In 4-bit mode the high nibble is
+ *               written first.
+ *
+ * Arguments   : lcd      the LCD.
+ *               inst     instruction and settings.
+ *               data     data byte.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_parWriteInstr (lcd_t * lcd, uint8_t inst);
+void lcd_parWriteData (lcd_t * lcd, uint8_t data);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 WRITE THE NEXT DATA OF A RUN
+ *
+ * Description : Writes a data byte over the data bus after another, written
+ *               by lcd_parWriteData() or this function, with only the wait
+ *               for the controller in between. With LCD_WRITE_ONLY that
+ *               wait leaves the data register selected, so only the byte is
+ *               written. Otherwise the busy flag has been read, and the
+ *               register is selected again as lcd_parWriteData() does.
+ *
+ * Arguments   : lcd      the LCD.
+ *               data     data byte.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_parWriteDataNext (lcd_t * lcd, uint8_t data);
+
+
+#ifndef LCD_WRITE_ONLY
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 READ THE STATUS OR DATA BYTE
+ *
+ * Description : Sets the data bus to input, selects the instruction
+ *               (lcd_parReadStatus()) or data (lcd_parReadData()) register
+ *               for a read and reads a byte over the data bus. The data bus
+ *               is set back to output before returning. In 4-bit mode the
+ *               high nibble is read first.
+ *
+ * Arguments   : lcd     the LCD.
+ *
+ * Returns     : The busy flag and address counter, or the data byte.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_parReadStatus (lcd_t * lcd);
+uint8_t lcd_parReadData (lcd_t * lcd);
+
+#endif // LCD_WRITE_ONLY
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              WAIT, CPU IDLE
+ *
+ * Description : Waits us microseconds in a delay loop, for the execution
+ *               time of the last byte sent to elapse.
+ *
+ * Arguments   : lcd     the LCD.
+ *               us      time in microseconds.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_parIdle (lcd_t * lcd, uint16_t us);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             PULSE ENABLE PIN
+ *
+ * Description : Pulses the enable pin.
+ *
+ * Arguments   : lcd     the LCD.
+ *
+ * Returns     : void
+ *
+ * Notes       : In order to execute an instruction the enable pin must
+ *               transition from high to low. This function performs this
+ *               operation by setting the enable pin high and then low. This
+ *               function should be called once all the other necessary pins
+ *               have been set according to the desired instruction and
+ *               settings. The setup, pulse width and enable cycle times are
+ *               taken from the timing profile in LCD_TIMING.H.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_pulseEnable (lcd_t * lcd);
+
+
+#endif // LCD_PAR_H
@@ -0,0 +1,152 @@
+/*
+ * File        : LCD_POLL.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for driving the LCD from a superloop without blocking and
+ * without interrupts. Operations (an instruction, a clear, setting the
+ * address, writing a run of bytes, uploading a glyph) are submitted to a
+ * small ring of pending operations, and lcd_poll(), called from the loop,
+ * advances them. Each call makes at most one bus transaction, and only if
+ * the controller is not busy, which is checked once and never waited on.
+ * An optional callback is made when each operation completes.
+ *
+ * While operations are pending, the functions in LCD_BASE and LCD_SF should
+ * not be called, as they would be interleaved with the operations. With
+ * LCD_WRITE_ONLY this module is only available if LCD_DEADLINE is also 
+ * defined, so that it can tell when the controller is ready without waiting.
+ */
+
+#ifndef LCD_POLL_H
+#define LCD_POLL_H
+
+#include <stdint.h>
+#include "lcd_base.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           POLL CONFIGURATION
+ *
+ * LCD_POLL_OPS : Number of operations that can be pending. Must be a power of
+ *                2 no larger than 64. One entry is always left empty.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef LCD_POLL_OPS
+#define LCD_POLL_OPS         8
+#endif // LCD_POLL_OPS
+
+
+/*
+ ******************************************************************************
+ *                                    TYPES
+ ******************************************************************************
+ */
+
+// called when an operation has completed. May submit further operations.
+typedef void (*lcd_pollDone_t) (void);
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    INITIALIZE THE OPERATIONS
+ *
+ * Description : Discards any pending operations, without calling their
+ *               callbacks. Should be called after lcd_init().
+ *
+ * Arguments   : lcd     the LCD the operations are carried out on.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_pollInit (lcd_t * lcd);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          SUBMIT AN OPERATION
+ *
+ * Description : Adds an operation to the end of the pending operations. They
+ *               are carried out in order by lcd_poll().
+ *
+ *               lcd_pollInstr()   : sends any instruction, e.g.
+ *                                   RETURN_HOME or DISPLAY_CTRL | DISPLAY_ON.
+ *               lcd_pollClear()   : clears the display.
+ *               lcd_pollSetAddr() : sets the DDRAM address.
+ *               lcd_pollWrite()   : writes len bytes from buf, starting at
+ *                                   the current address. buf is not copied,
+ *                                   so must be left unchanged until the
+ *                                   operation completes.
+ *               lcd_pollGlyph()   : writes an 8-byte glyph bitmap stored in
+ *                                   flash to a CGRAM slot (0 to 7), then
+ *                                   restores the address counter. This does
+ *                                   not update the LCD_GLYPH cache.
+ *
+ * Arguments   : done     function called once the operation has completed,
+ *                        or NULL.
+ *
+ * Returns     : LCD_INSTR_SUCCESS if the operation was added, QUEUE_FULL if
+ *               LCD_POLL_OPS - 1 operations are already pending, or
+ *               INVALID_ARG.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_pollInstr (uint8_t instr, lcd_pollDone_t done);
+uint8_t lcd_pollClear (lcd_pollDone_t done);
+uint8_t lcd_pollSetAddr (uint8_t addr, lcd_pollDone_t done);
+uint8_t lcd_pollWrite (const uint8_t * buf, uint8_t len, lcd_pollDone_t done);
+uint8_t lcd_pollGlyph (uint8_t slot, const uint8_t * glyph,
+                       lcd_pollDone_t done);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                     ADVANCE THE OPERATIONS
+ *
+ * Description : If an operation is pending and the controller is not busy,
+ *               makes the next bus transaction of the oldest operation, and
+ *               calls its callback if that completed it. Returns without
+ *               waiting otherwise. Call this from the superloop.
+ *
+ * Arguments   : void
+ *
+ * Returns     : Number of operations still pending. 0 when idle.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_poll (void);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           PENDING OPERATIONS
+ *
+ * Description : Returns the number of operations not yet completed.
+ *
+ * Arguments   : void
+ *
+ * Returns     : Number of pending operations.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_pollPending (void);
+
+
+#endif // LCD_POLL_H
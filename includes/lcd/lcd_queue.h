@@ -0,0 +1,195 @@
+/*
+ * File        : LCD_QUEUE.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for sending instructions and data to the LCD asynchronously.
+ * Instead of blocking while each byte is transferred and executed, the
+ * instructions and data bytes are placed in a ring buffer in SRAM and the
+ * buffer is drained by the Timer/Counter2 compare match interrupt, one bus
+ * cycle per interrupt, whenever the controller is not busy. The synchronous
+ * functions in LCD_BASE are used to perform the transfers.
+ *
+ * While the queue is in use, the functions in LCD_BASE and LCD_SF should not
+ * be called unless lcd_queueWaitIdle() has returned and nothing else has
+ * been queued since, as they share the LCD's ports with the interrupt.
+ *
+ * With LCD_TWI, an entry is left in the queue until the expander's ring
+ * buffer has room for all of its bytes (see LCD_TWI.H), as the TWI
+ * interrupt cannot empty that buffer while this one runs.
+ */
+
+#ifndef LCD_QUEUE_H
+#define LCD_QUEUE_H
+
+#include <avr/io.h>
+#include "lcd_base.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          QUEUE CONFIGURATION
+ *
+ * LCD_QUEUE_SIZE    : Number of entries in the ring buffer. Must be a power
+ *                     of 2 and no larger than 128. One entry is always left
+ *                     empty, so the queue holds LCD_QUEUE_SIZE - 1 bytes.
+ *
+ * LCD_QUEUE_TICK_US : Period of the Timer/Counter2 interrupt that drains the
+ *                     queue, in microseconds. At most one instruction or data
+ *                     byte is sent per interrupt.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef LCD_QUEUE_SIZE
+#define LCD_QUEUE_SIZE       32
+#endif // LCD_QUEUE_SIZE
+
+#ifndef LCD_QUEUE_TICK_US
+#define LCD_QUEUE_TICK_US    20
+#endif // LCD_QUEUE_TICK_US
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                      QUEUE OVERFLOW POLICIES
+ *
+ * Determines what happens when a byte is queued while the queue is full. Set
+ * with lcd_queueSetPolicy().
+ *
+ * QUEUE_BLOCK       : Wait until the interrupt has made room. This is the
+ *                     default. Global interrupts must be enabled.
+ * QUEUE_DROP_NEW    : Discard the new byte and return QUEUE_FULL.
+ * QUEUE_DROP_OLDEST : Discard the oldest queued byte to make room.
+ * ----------------------------------------------------------------------------
+ */
+
+#define QUEUE_BLOCK          0
+#define QUEUE_DROP_NEW       1
+#define QUEUE_DROP_OLDEST    2
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         INITIALIZE THE QUEUE
+ *
+ * Description : Empties the queue and starts Timer/Counter2 in CTC mode with
+ *               its compare match interrupt firing every LCD_QUEUE_TICK_US.
+ *               lcd_init() should be called first, and global interrupts
+ *               must be enabled by the application (i.e. sei()) for the
+ *               queue to drain.
+ *
+ * Arguments   : lcd     the LCD the queued bytes are sent to.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_queueInit (lcd_t * lcd);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 QUEUE INSTRUCTION or DATA
+ *
+ * Description : Adds an instruction or a data byte to the end of the queue.
+ *               The byte will be sent to the LCD once all bytes queued ahead
+ *               of it have been sent and the controller is no longer busy.
+ *
+ * Arguments   : instr     instruction and settings, e.g.
+ *                         SET_DDRAM_ADDR | LINE_2_BEG. These are not
+ *                         validated.
+ *
+ *               data      data byte to write to the DDRAM or CGRAM.
+ *
+ * Returns     : LCD_INSTR_SUCCESS if the byte was queued. QUEUE_FULL if the
+ *               queue was full and the policy is QUEUE_DROP_NEW.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_queueInstruction (uint8_t instr);
+uint8_t lcd_queueData (uint8_t data);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              FLUSH THE QUEUE
+ *
+ * Description : Discards all bytes that have been queued but not yet sent.
+ *               A byte that is currently being executed by the controller is
+ *               not affected.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_queueFlush (void);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              WAIT UNTIL IDLE
+ *
+ * Description : Blocks until every queued byte has been sent and the
+ *               controller has finished executing the last one. Global
+ *               interrupts must be enabled.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_queueWaitIdle (void);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    SET QUEUE OVERFLOW POLICY
+ *
+ * Description : Sets what happens when a byte is queued while the queue is
+ *               full.
+ *
+ * Arguments   : policy     QUEUE_BLOCK, QUEUE_DROP_NEW or QUEUE_DROP_OLDEST.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if policy is not one of the
+ *               above. Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_queueSetPolicy (uint8_t policy);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 QUEUE STATUS
+ *
+ * Description : lcd_queueLength() returns the number of bytes waiting to be
+ *               sent. lcd_queueDropped() returns the number of bytes that
+ *               have been discarded due to overflow since lcd_queueInit().
+ *
+ * Arguments   : void
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t  lcd_queueLength (void);
+uint16_t lcd_queueDropped (void);
+
+
+#endif // LCD_QUEUE_H
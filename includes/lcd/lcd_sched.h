@@ -0,0 +1,169 @@
+/*
+ * File        : LCD_SCHED.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for scheduling the transfers to several controllers that share
+ * the data bus and differ only in their control pins (e.g. EN), such as
+ * several displays on one bus or the two halves of a 40x4 module. Each
+ * controller has its own ring of pending instructions and data bytes, and
+ * the scheduler sends the next byte to whichever controller is ready, so
+ * that one controller is written while the others are still executing. The
+ * time taken is then close to that of the busiest controller, rather than
+ * the sum of them all as when each call waits out its own execution time.
+ *
+ * With LCD_DEADLINE the controller whose deadline expires first is served
+ * next, and lcd_schedFlush() only waits out what remains of that deadline.
+ * Otherwise the busy flag of each controller with bytes pending is read,
+ * in turn. With LCD_WRITE_ONLY this module is only available if
+ * LCD_DEADLINE is also defined.
+ *
+ * Requires LCD_MULTI_INSTANCE. The controllers must each have been
+ * initialized with lcd_init(), and while bytes are pending the functions in
+ * LCD_BASE and LCD_SF should not be called for them.
+ */
+
+#ifndef LCD_SCHED_H
+#define LCD_SCHED_H
+
+#include <stdint.h>
+#include "lcd_base.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                      SCHEDULER CONFIGURATION
+ *
+ * LCD_SCHED_LCDS : Number of controllers that can be attached.
+ *
+ * LCD_SCHED_SIZE : Number of entries in the ring of each controller. Must be
+ *                  a power of 2 no larger than 128. One entry is always left
+ *                  empty.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef LCD_SCHED_LCDS
+#define LCD_SCHED_LCDS       2
+#endif // LCD_SCHED_LCDS
+
+#ifndef LCD_SCHED_SIZE
+#define LCD_SCHED_SIZE       32
+#endif // LCD_SCHED_SIZE
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                     INITIALIZE THE SCHEDULER
+ *
+ * Description : Detaches all controllers and discards any pending bytes.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_schedInit (void);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          ATTACH A CONTROLLER
+ *
+ * Description : Adds a controller to those scheduled. lcd_init() should be
+ *               called for it first.
+ *
+ * Arguments   : lcd     the LCD.
+ *
+ * Returns     : LCD_INSTR_SUCCESS, or QUEUE_FULL if LCD_SCHED_LCDS
+ *               controllers are already attached.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_schedAttach (lcd_t * lcd);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   SCHEDULE INSTRUCTION/DATA
+ *
+ * Description : Adds bytes to the end of the ring of a controller. They are
+ *               sent in order by lcd_schedRun() or lcd_schedFlush().
+ *
+ *               lcd_schedInstr() : an instruction, e.g.
+ *                                  SET_DDRAM_ADDR | LINE_2_BEG. It is not
+ *                                  validated.
+ *               lcd_schedData()  : a data byte.
+ *               lcd_schedWrite() : len data bytes from buf, which is copied.
+ *                                  Either all of them are added or none.
+ *
+ * Arguments   : lcd      the LCD, which must be attached.
+ *               instr    instruction and settings.
+ *               data     data byte.
+ *               buf      data bytes, len of them.
+ *
+ * Returns     : LCD_INSTR_SUCCESS, QUEUE_FULL if there is not enough room,
+ *               or INVALID_ARG if lcd is not attached.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_schedInstr (lcd_t * lcd, uint8_t instr);
+uint8_t lcd_schedData (lcd_t * lcd, uint8_t data);
+uint8_t lcd_schedWrite (lcd_t * lcd, const uint8_t * buf, uint8_t len);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        RUN THE SCHEDULER
+ *
+ * Description : lcd_schedRun() sends at most one byte, the next of a
+ *               controller that has bytes pending and is not busy, and
+ *               returns without waiting otherwise. Controllers that are
+ *               ready are served in turn. Call this from the superloop.
+ *
+ *               lcd_schedFlush() blocks until every pending byte has been
+ *               sent, waiting only when no controller with bytes pending is
+ *               ready.
+ *
+ * Arguments   : void
+ *
+ * Returns     : lcd_schedRun() returns the number of bytes still pending.
+ * ----------------------------------------------------------------------------
+ */
+
+uint16_t lcd_schedRun (void);
+void lcd_schedFlush (void);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                PENDING BYTES
+ *
+ * Description : Returns the number of bytes not yet sent, of all attached
+ *               controllers.
+ *
+ * Arguments   : void
+ *
+ * Returns     : Number of pending bytes.
+ * ----------------------------------------------------------------------------
+ */
+
+uint16_t lcd_schedPending (void);
+
+
+#endif // LCD_SCHED_H
@@ -19,6 +19,7 @@
 #define LCD_SF_H
 
 #include <avr/io.h>
+#include "lcd_base.h"
 
 
 /*
@@ -31,17 +32,28 @@
  * ----------------------------------------------------------------------------
  *                                                         READ ADDRESS COUNTER
  * 
- * Description : Gets the value in the address counter. It does this by calling 
- *               lcd_readBusyAndAddr() and clearing the busy flag from its 
- *               returned value, leaving only the address counter value.
+ * Description : Gets the value in the address counter. The value tracked by
+ *               the driver (see lcd_addrCounter()) is returned, so this 
+ *               does not access the LCD.
  * 
- * Arguments   : None
+ *               If LCD_VERIFY_ADDR is defined, the address counter is instead
+ *               read from the LCD by calling lcd_readBusyAndAddr() and 
+ *               clearing the busy flag from its returned value, and compared
+ *               to the tracked value. On a mismatch, lcd_addrMismatches() is
+ *               incremented and the address is set again so that the LCD and
+ *               the driver agree. This is intended for debugging.
+ * 
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : Current value in the address counter.
  * -----------------------------------------------------------------------------
  */
 
-uint8_t lcd_readAddr(void);
+uint8_t lcd_readAddr(lcd_t * lcd);
+
+#ifdef LCD_VERIFY_ADDR
+uint16_t lcd_addrMismatches(lcd_t * lcd);
+#endif // LCD_VERIFY_ADDR
 
 
 /* 
@@ -52,14 +64,14 @@ uint8_t lcd_readAddr(void);
  *               on which function is called. These functions will call
  *               lcd_cursorDisplayShift() with the appropriate arguments. 
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : void
  * ----------------------------------------------------------------------------
  */
 
-void lcd_rightShiftCursor(void);
-void lcd_leftShiftCursor(void);
+void lcd_rightShiftCursor(lcd_t * lcd);
+void lcd_leftShiftCursor(lcd_t * lcd);
 
 
 /* 
@@ -70,14 +82,90 @@ void lcd_leftShiftCursor(void);
  *               depending on which function is called. These functions will 
  *               call lcd_cursorDisplayShift() with the appropriate arguments. 
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : void
  * ----------------------------------------------------------------------------
  */
 
-void lcd_rightShiftDisplay(void);
-void lcd_leftShiftDisplay(void);
+void lcd_rightShiftDisplay(lcd_t * lcd);
+void lcd_leftShiftDisplay(lcd_t * lcd);
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                   WRITE STRING or BUFFER
+ * 
+ * Description : Writes a string or a buffer of characters to the display, 
+ *               starting at the current address counter position. The 
+ *               characters are written in runs, one per display line, with 
+ *               lcd_writeDataBuf(). When a run reaches the end of a display 
+ *               line, the address counter is set to the beginning of the next
+ *               display line, i.e. line 1 -> 2 -> 3 -> 4 -> 1, rather than
+ *               following the DDRAM address order.
+ * 
+ * Arguments   : lcd     the LCD.
+ *               str     null-terminated string, of up to 255 characters.
+ *               buf     pointer to the characters to write.
+ *               len     number of characters in buf.
+ * 
+ * Returns     : void
+ * 
+ * Notes       : The ENTRY_MODE_SET must be INCREMENT. If the address counter
+ *               does not point to a visible DDRAM position (e.g. it points to
+ *               CGRAM) the bytes are written without any line wrapping.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_writeString(lcd_t * lcd, const char * str);
+void lcd_writeBuf(lcd_t * lcd, const uint8_t * buf, uint8_t len);
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                          WRITE STRING or BUFFER AT POSITION
+ * 
+ * Description : Moves the address counter to the given display position with
+ *               lcd_moveCursor() and then writes the string or buffer as 
+ *               lcd_writeString() and lcd_writeBuf() do.
+ * 
+ * Arguments   : lcd     the LCD.
+ *               row     display line, 0 (line 1) to LCD_ROWS - 1.
+ *               col     position in the line, 0 to LCD_COLS - 1.
+ *               str     null-terminated string, of up to 255 characters.
+ *               buf     pointer to the characters to write.
+ *               len     number of characters in buf.
+ * 
+ * Returns     : LCD Error code. INVALID_ARG if row or col is out of range, in
+ *               which case nothing is written. Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_writeAt(lcd_t * lcd, uint8_t row, uint8_t col, const char * str);
+uint8_t lcd_writeBufAt(lcd_t * lcd, uint8_t row, uint8_t col, 
+                       const uint8_t * buf, uint8_t len);
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                               GO TO POSITION
+ * 
+ * Description : Sets the address counter to the given display position with
+ *               a single SET_DDRAM_ADDR. The address is read from the 
+ *               LCD_ADDR table in flash for the LCD_GEOMETRY profile, or 
+ *               taken from the lcd_t with LCD_MULTI_INSTANCE. Unlike 
+ *               lcd_moveCursor() no cheaper way of moving is considered.
+ * 
+ * Arguments   : lcd     the LCD.
+ *               row     display line, 0 (line 1) to LCD_ROWS - 1.
+ *               col     position in the line, 0 to LCD_COLS - 1.
+ * 
+ * Returns     : LCD Error code. INVALID_ARG if row or col is out of range, in
+ *               which case nothing is sent. Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_gotoXY(lcd_t * lcd, uint8_t row, uint8_t col);
 
 
 
@@ -0,0 +1,194 @@
+/*
+ * File        : LCD_SPI.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for an LCD on a 74HC595 shift register, driven by the SPI of the
+ * AVR at fosc/2. Build every file of the module with -DLCD_SPI to use it as
+ * the transport (see LCD_BUS.H) in place of the parallel ports, under the
+ * same LCD_BASE instruction functions.
+ *
+ * MOSI and SCK feed the shift register and SS (PB0) drives its latch clock
+ * (RCLK), so SS is never used as an input. The outputs hold the control
+ * pins, the backlight and DB4-DB7, wired as on the common I2C backpacks, and
+ * change together when the latch rises. Each nibble written becomes two
+ * bytes, with EN high and then low. RS changes are sent in a byte of their
+ * own, before EN rises.
+ *
+ * A byte takes 16 CPU cycles to shift out. Rather than waiting for it, each
+ * byte is left shifting and is latched when the next is sent, so the next
+ * byte is shifted in while the outputs of the previous one, i.e. the enable
+ * pulse, are held. The last byte of a transfer is latched by lcd_spiFlush()
+ * before the transfer returns. As a byte must have been shifted before it is
+ * latched, the enable pulse width and cycle time are always met.
+ *
+ * As there is no path back from the LCD, LCD_SPI implies 4-bit mode and
+ * LCD_WRITE_ONLY. Not available with LCD_MULTI_INSTANCE or LCD_DEADLINE, or
+ * with LCD_TWI unless both are built in with LCD_BUS_RUNTIME.
+ */
+
+#ifndef LCD_SPI_H
+#define LCD_SPI_H
+
+#include <stdint.h>
+#include "lcd_base.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                     SPI PINS
+ *
+ * The SPI pins of the ATmega1280, all on port B. LCD_SPI_LATCH is the SS pin,
+ * wired to RCLK of the 74HC595, and is kept low between latches.
+ * ----------------------------------------------------------------------------
+ */
+
+#define LCD_SPI_DDR          DDRB
+#define LCD_SPI_PORT         PORTB
+#define LCD_SPI_LATCH        PB0                           /* SS -> RCLK */
+#define LCD_SPI_SCK          PB1                           /* SCK -> SRCLK */
+#define LCD_SPI_MOSI         PB2                           /* MOSI -> SER */
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             REGISTER OUTPUTS
+ *
+ * Bits of the shift register's output byte. The byte is shifted MSB first, so
+ * bit 7 ends up on QH. DB4-DB7 are on QE-QH.
+ * ----------------------------------------------------------------------------
+ */
+
+#define LCD_SPI_RS           0                             /* QA */
+#define LCD_SPI_RW           1                             /* QB */
+#define LCD_SPI_EN           2                             /* QC */
+#define LCD_SPI_BL           3                             /* QD, backlight */
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           INITIALIZE THE SPI
+ *
+ * Description : Latches any byte still shifting, sets the SPI pins to
+ *               outputs and enables the SPI as master at fosc/2, mode 0, MSB
+ *               first, then latches the pins with EN low and the backlight
+ *               on. Called by lcd_init() and lcd_warmInit().
+ *
+ * Arguments   : lcd     the LCD.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_spiInit (lcd_t * lcd);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               WRITE AN INITIALIZATION NIBBLE
+ *
+ * Description : Shifts out the lower 4 bits of nib on DB4-DB7 as an
+ *               instruction nibble, and latches the last byte.
+ *
+ * Arguments   : lcd     the LCD.
+ *               nib     high nibble of an instruction, in the lower 4 bits.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_spiWriteNibble (lcd_t * lcd, uint8_t nib);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 WRITE AN INSTRUCTION OR DATA
+ *
+ * Description : Shifts out an instruction (lcd_spiWriteInstr()) or data
+ *               (lcd_spiWriteData()) byte, as its high nibble and then its
+ *               low nibble, with RS set to select the register. Each byte is
+ *               latched as the next is shifted, and the last once it has
+ *               been shifted, so the transfer is complete on return.
+ *
+ * Arguments   : lcd      the LCD.
+ *               inst     instruction and settings.
+ *               data     data byte.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_spiWriteInstr (lcd_t * lcd, uint8_t inst);
+void lcd_spiWriteData (lcd_t * lcd, uint8_t data);
+
+// RS is only set up when it differs from the last byte shifted out, so the
+// bytes of a run after the first are written the same way (see LCD_BUS.H).
+#define lcd_spiWriteDataNext  lcd_spiWriteData
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              WAIT, CPU IDLE
+ *
+ * Description : Waits us microseconds in a delay loop, for the execution
+ *               time of the last byte latched to elapse.
+ *
+ * Arguments   : lcd     the LCD.
+ *               us      time in microseconds.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_spiIdle (lcd_t * lcd, uint16_t us);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          LATCH THE LAST BYTE
+ *
+ * Description : Waits for the byte being shifted, if any, to complete and
+ *               latches it onto the outputs. Called at the end of each
+ *               transfer.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_spiFlush (void);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    BACKLIGHT
+ *
+ * Description : Turns the backlight on or off, by shifting and latching the
+ *               pins with the new setting.
+ *
+ * Arguments   : on     1 for on, 0 for off.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_spiBacklight (uint8_t on);
+
+
+#endif // LCD_SPI_H
@@ -0,0 +1,148 @@
+/*
+ * File        : LCD_STATS.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for counting the activity of the LCD driver. When built with
+ * -DLCD_STATS, LCD_BASE counts the instructions sent by class, the data bytes
+ * written and read, the busy flag polls and timeouts of lcd_waitClearBusy(),
+ * and times each wait for the controller with LCD_TIMER. The counters can be
+ * used to size refresh rates, and a controller that has started to run slow
+ * shows up as a growing maximum busy wait.
+ *
+ * The counting is done inline by the STATS_* macros. Without LCD_STATS they
+ * expand to nothing and this module does not need to be linked.
+ */
+
+#ifndef LCD_STATS_H
+#define LCD_STATS_H
+
+#include <stdint.h>
+#include "lcd_timer.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                STATS HOOKS
+ *
+ * Used by LCD_BASE to update the counters.
+ *
+ * STATS_INSTR(inst)  : an instruction byte was sent.
+ * STATS_INC(field)   : increment one of the counters of lcd_stats_t.
+ * STATS_WAIT_BEGIN   : start timing a wait for the controller. Declares a
+ *                      local variable, so must be the first statement of a
+ *                      block.
+ * STATS_WAIT_END     : end the wait started by STATS_WAIT_BEGIN.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifdef LCD_STATS
+  #define STATS_INSTR(inst)   pvt_statsInstr (inst)
+  #define STATS_INC(field)    (pvt_stats.field++)
+  #define STATS_WAIT_BEGIN    uint16_t statsStart = LCD_TIMER_NOW
+  #define STATS_WAIT_END      pvt_statsWait (statsStart)
+#else
+  #define STATS_INSTR(inst)   ((void)0)
+  #define STATS_INC(field)    ((void)0)
+  #define STATS_WAIT_BEGIN    ((void)0)
+  #define STATS_WAIT_END      ((void)0)
+#endif // LCD_STATS
+
+
+/*
+ ******************************************************************************
+ *                                    TYPES
+ ******************************************************************************
+ */
+
+//
+// Driver activity since lcd_statsReset(). instructions[] is indexed by the
+// instruction bit, i.e. the position of the highest bit set in the
+// instruction byte, so instructions[0] counts CLEAR_DISPLAY and
+// instructions[7] SET_DDRAM_ADDR. Times are in LCD_TIMER ticks.
+//
+typedef struct
+{
+  uint32_t instructions[8];             // instructions sent, by class
+  uint32_t dataWrites;                  // DDRAM/CGRAM bytes written
+  uint32_t dataReads;                   // DDRAM/CGRAM bytes read
+  uint32_t busyPolls;                   // busy flag reads while waiting
+  uint16_t busyTimeouts;                // waits that returned BUSY_RESET_TIMEOUT
+  uint16_t maxWaitTicks;                // longest single wait
+  uint32_t waitTicks;                   // total time spent waiting
+} lcd_stats_t;
+
+#ifdef LCD_STATS
+// The counters, written by the STATS_* macros. Not for use by the application.
+extern lcd_stats_t pvt_stats;
+
+void pvt_statsInstr (uint8_t inst);
+void pvt_statsWait (uint16_t start);
+#endif // LCD_STATS
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           RESET THE COUNTERS
+ *
+ * Description : Zeros the counters and starts the LCD_TIMER time base, which
+ *               times the waits. Should be called before lcd_init() so the
+ *               initialization is counted.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_statsReset (void);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             GET THE COUNTERS
+ *
+ * Description : Copies the counters, with interrupts disabled so the copy is
+ *               consistent with any updates made by the LCD_QUEUE interrupt.
+ *
+ * Arguments   : stats     pointer to the lcd_stats_t to copy the counters to.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_stats (lcd_stats_t * stats);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           PRINT THE COUNTERS
+ *
+ * Description : Prints the counters to a terminal via PRINTS, one per line,
+ *               with the wait times converted to microseconds.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_printStats (void);
+
+
+#endif // LCD_STATS_H
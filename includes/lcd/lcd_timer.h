@@ -0,0 +1,93 @@
+/*
+ * File        : LCD_TIMER.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for a free-running time base used to timestamp and time LCD bus
+ * activity. Timer/Counter1 is run in normal mode at F_CPU/LCD_TIMER_PRESCALE,
+ * by default F_CPU/8, so it counts in half microseconds at 16MHz and wraps
+ * every 65536 ticks (32.8ms). No interrupt is
+ * used; elapsed times are found by subtracting two readings of LCD_TIMER_NOW,
+ * which is correct across a wrap as long as less than one full period has
+ * passed.
+ */
+
+#ifndef LCD_TIMER_H
+#define LCD_TIMER_H
+
+#include <avr/io.h>
+#include "lcd_timing.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                               TIMER PRESCALER
+ *
+ * LCD_TIMER_PRESCALE : Timer/Counter1 clock divider, one of 1, 8, 64, 256 or
+ *                      1024. A larger prescaler gives a longer period before
+ *                      the count wraps but a coarser tick.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef LCD_TIMER_PRESCALE
+#define LCD_TIMER_PRESCALE   8
+#endif // LCD_TIMER_PRESCALE
+
+// clock select bits of TCCR1B for the prescaler.
+#if   (LCD_TIMER_PRESCALE == 1)
+  #define TIMER_CLOCK_SELECT (1 << CS10)
+#elif (LCD_TIMER_PRESCALE == 8)
+  #define TIMER_CLOCK_SELECT (1 << CS11)
+#elif (LCD_TIMER_PRESCALE == 64)
+  #define TIMER_CLOCK_SELECT (1 << CS11 | 1 << CS10)
+#elif (LCD_TIMER_PRESCALE == 256)
+  #define TIMER_CLOCK_SELECT (1 << CS12)
+#elif (LCD_TIMER_PRESCALE == 1024)
+  #define TIMER_CLOCK_SELECT (1 << CS12 | 1 << CS10)
+#else
+  #error "LCD_TIMER_PRESCALE must be 1, 8, 64, 256 or 1024"
+#endif
+
+// conversions between microseconds and ticks. US_TO_TICKS rounds up.
+#define US_TO_TICKS(us)      (((uint32_t)(us) * (F_CPU / 1000000UL)            \
+                               + LCD_TIMER_PRESCALE - 1) / LCD_TIMER_PRESCALE)
+#define TICKS_TO_US(ticks)   ((uint32_t)(ticks) * LCD_TIMER_PRESCALE           \
+                              / (F_CPU / 1000000UL))
+
+// current value of the time base, in ticks.
+#define LCD_TIMER_NOW        TCNT1
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                      INITIALIZE THE TIME BASE
+ *
+ * Description : Starts Timer/Counter1 in normal mode with a prescaler of
+ *               LCD_TIMER_PRESCALE. Timer/Counter1 should not be used for
+ *               anything else while the time base is in use.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_timerInit (void);
+
+
+#endif // LCD_TIMER_H
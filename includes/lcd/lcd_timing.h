@@ -0,0 +1,207 @@
+/*
+ * File        : LCD_TIMING.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Bus timing profiles for the LCD controller. A profile holds the minimum
+ * setup, enable-pulse and hold times of the controller's bus interface, in
+ * nanoseconds, as well as the instruction execution times in microseconds.
+ * The profile is selected at compile time with LCD_CTRL_VARIANT and is
+ * converted here into whole CPU cycles using F_CPU, so that the bus routines
+ * in LCD_BASE can wait exactly as long as the controller requires and no
+ * longer.
+ */
+
+#ifndef LCD_TIMING_H
+#define LCD_TIMING_H
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+#ifndef F_CPU
+#define F_CPU           16000000UL             /* clock frequency of target */
+#endif // F_CPU
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          CONTROLLER VARIANTS
+ *
+ * Pass one of these as LCD_CTRL_VARIANT (e.g. -DLCD_CTRL_VARIANT=2) to select
+ * the timing profile. The default is the HD44780U operating at 5V.
+ *
+ * LCD_HD44780U_5V  : Hitachi HD44780U, VCC = 4.5V to 5.5V.
+ * LCD_HD44780U_3V  : Hitachi HD44780U, VCC = 2.7V to 4.5V.
+ * LCD_ST7066U      : Sitronix ST7066U / Samsung KS0066U compatibles. These
+ *                    have a longer enable cycle than the HD44780U.
+ * ----------------------------------------------------------------------------
+ */
+
+#define LCD_HD44780U_5V      1
+#define LCD_HD44780U_3V      2
+#define LCD_ST7066U          3
+
+#ifndef LCD_CTRL_VARIANT
+#define LCD_CTRL_VARIANT     LCD_HD44780U_5V
+#endif // LCD_CTRL_VARIANT
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              TIMING PROFILES
+ *
+ * Bus timing values are in nanoseconds and are the datasheet minimums, except
+ * for T_DDR which is the maximum time after ENABLE goes high before read data
+ * is valid on the data pins.
+ *
+ * T_CYC_E : Enable cycle time, i.e. rising edge to rising edge.
+ * T_PW_EH : Enable pulse width (high level).
+ * T_AS    : RS and RW setup time before ENABLE goes high.
+ * T_DSW   : Data setup time before ENABLE goes low.
+ * T_H     : Data and address hold time after ENABLE goes low.
+ * T_DDR   : Read data output delay after ENABLE goes high.
+ *
+ * Execution times are in microseconds for the nominal 270kHz oscillator.
+ *
+ * EXEC_SHORT_US : Most instructions.
+ * EXEC_LONG_US  : CLEAR_DISPLAY and RETURN_HOME.
+ * EXEC_DATA_US  : Data read/write, including the time for the address
+ *                 counter to update after the busy flag is reset (tADD).
+ * T_ADD_US      : Time after the busy flag resets until the address counter
+ *                 holds the updated value.
+ * ----------------------------------------------------------------------------
+ */
+
+#if   (LCD_CTRL_VARIANT == LCD_HD44780U_5V)
+  #define T_CYC_E            500
+  #define T_PW_EH            230
+  #define T_AS               40
+  #define T_DSW              80
+  #define T_H                10
+  #define T_DDR              160
+#elif (LCD_CTRL_VARIANT == LCD_HD44780U_3V)
+  #define T_CYC_E            1000
+  #define T_PW_EH            450
+  #define T_AS               60
+  #define T_DSW              195
+  #define T_H                10
+  #define T_DDR              360
+#elif (LCD_CTRL_VARIANT == LCD_ST7066U)
+  #define T_CYC_E            1200
+  #define T_PW_EH            460
+  #define T_AS               60
+  #define T_DSW              195
+  #define T_H                10
+  #define T_DDR              360
+#else
+  #error "LCD_CTRL_VARIANT is not a known controller variant"
+#endif
+
+#define EXEC_SHORT_US        37
+#define EXEC_LONG_US         1520
+#define T_ADD_US             6
+#define EXEC_DATA_US         (EXEC_SHORT_US + T_ADD_US)
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            CYCLE CONVERSIONS
+ *
+ * Converts the profile times to CPU cycles, rounding up. CYCLES_DATA_DELAY
+ * includes one extra cycle for the AVR's input pin synchronizer.
+ * ----------------------------------------------------------------------------
+ */
+
+#define CYCLES_PER_US        (F_CPU / 1000000UL)
+
+#define NS_TO_CYCLES(ns)     (((uint32_t)(ns) * (F_CPU / 1000UL) + 999999UL) \
+                              / 1000000UL)
+
+#define CYCLES_ADDR_SETUP    NS_TO_CYCLES (T_AS)
+#define CYCLES_ENABLE_PULSE  NS_TO_CYCLES (T_PW_EH > T_DSW ? T_PW_EH : T_DSW)
+#define CYCLES_ENABLE_CYCLE  NS_TO_CYCLES (T_CYC_E - T_PW_EH > T_H          \
+                                           ? T_CYC_E - T_PW_EH : T_H)
+#define CYCLES_DATA_DELAY    (NS_TO_CYCLES (T_DDR > T_PW_EH ? T_DDR : T_PW_EH)\
+                              + 1)
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    BUS WAITS
+ *
+ * Cycle-exact waits used between the control and data pin transitions.
+ *
+ * WAIT_ADDR_SETUP   : After RS/RW/data are set, before ENABLE_HI.
+ * WAIT_ENABLE_PULSE : After ENABLE_HI, before ENABLE_LO on a write.
+ * WAIT_ENABLE_CYCLE : After ENABLE_LO, before the next ENABLE_HI.
+ * WAIT_DATA_DELAY   : After ENABLE_HI, before sampling DATA_PIN on a read.
+ *
+ * These are only used by the parallel transport (LCD_PAR.H). With LCD_TWI
+ * each pin transition is a byte on the I2C bus, and with LCD_SPI a byte is
+ * shifted between transitions.
+ * ----------------------------------------------------------------------------
+ */
+
+#define WAIT_ADDR_SETUP      __builtin_avr_delay_cycles (CYCLES_ADDR_SETUP)
+#define WAIT_ENABLE_PULSE    __builtin_avr_delay_cycles (CYCLES_ENABLE_PULSE)
+#define WAIT_ENABLE_CYCLE    __builtin_avr_delay_cycles (CYCLES_ENABLE_CYCLE)
+#define WAIT_DATA_DELAY      __builtin_avr_delay_cycles (CYCLES_DATA_DELAY)
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            BUSY FLAG POLLING
+ *
+ * The busy flag is read immediately, then again after each back-off delay
+ * until it is clear or BUSY_TIMEOUT_US has elapsed. Elapsed time is counted
+ * in CPU cycles, from the delays and the cycles taken by each read.
+ *
+ * BUSY_BACKOFF          : BACKOFF_FIXED waits BUSY_POLL_INTERVAL_US between
+ *                         reads. BACKOFF_EXPONENTIAL waits BUSY_POLL_FIRST_US
+ *                         after the first read and doubles the wait after 
+ *                         each read, up to BUSY_POLL_INTERVAL_US.
+ * BUSY_POLL_FIRST_US    : First back-off delay of BACKOFF_EXPONENTIAL.
+ * BUSY_POLL_INTERVAL_US : Longest time between reads of the busy flag.
+ * BUSY_TIMEOUT_US       : Time after which lcd_waitClearBusy() gives up.
+ * ----------------------------------------------------------------------------
+ */
+
+#define BACKOFF_FIXED        0
+#define BACKOFF_EXPONENTIAL  1
+
+#ifndef BUSY_BACKOFF
+#define BUSY_BACKOFF         BACKOFF_EXPONENTIAL
+#endif // BUSY_BACKOFF
+
+#ifndef BUSY_POLL_FIRST_US
+#define BUSY_POLL_FIRST_US     1
+#endif // BUSY_POLL_FIRST_US
+
+#ifndef BUSY_POLL_INTERVAL_US
+#define BUSY_POLL_INTERVAL_US  10
+#endif // BUSY_POLL_INTERVAL_US
+
+#ifndef BUSY_TIMEOUT_US
+#define BUSY_TIMEOUT_US        10000
+#endif // BUSY_TIMEOUT_US
+
+#if BUSY_POLL_FIRST_US < 1 || BUSY_POLL_FIRST_US > BUSY_POLL_INTERVAL_US   \
+    || BUSY_POLL_INTERVAL_US > 255
+  #error "Busy poll delays must be 1 <= FIRST <= INTERVAL <= 255 us"
+#endif
+
+#if BUSY_TIMEOUT_US >= 0xFFFF
+  #error "BUSY_TIMEOUT_US must be less than 65535"
+#endif
+
+#define BUSY_TIMEOUT_CYCLES  ((uint32_t)BUSY_TIMEOUT_US * CYCLES_PER_US)
+
+
+#endif // LCD_TIMING_H
@@ -0,0 +1,155 @@
+/*
+ * File        : LCD_TRACE.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for recording the transactions on the LCD bus. When built with
+ * -DLCD_TRACE, every instruction, data write, data read and busy flag read
+ * made by LCD_BASE is recorded in a ring buffer in SRAM as the RS and RW
+ * settings, the byte transferred and a timestamp from LCD_TIMER. The most
+ * recent LCD_TRACE_SIZE transactions can then be dumped through the USART
+ * with lcd_traceDump().
+ *
+ * Recording is done by the TRACE_BUS macro, inline, so it only costs a few
+ * stores per transaction. Without LCD_TRACE the macro expands to nothing and
+ * this module does not need to be linked.
+ */
+
+#ifndef LCD_TRACE_H
+#define LCD_TRACE_H
+
+#include <avr/io.h>
+#include "lcd_timer.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          TRACE CONFIGURATION
+ *
+ * LCD_TRACE      : Define to record bus transactions.
+ * LCD_TRACE_SIZE : Number of transactions kept. Must be a power of 2 no
+ *                  larger than 256. Each takes 4 bytes of SRAM.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef LCD_TRACE_SIZE
+#define LCD_TRACE_SIZE       64
+#endif // LCD_TRACE_SIZE
+
+#define TRACE_MASK           (LCD_TRACE_SIZE - 1)
+
+// bits of lcd_trace_t.ctrl
+#define TRACE_RS             0x02
+#define TRACE_RW             0x01
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                RECORD A BYTE
+ *
+ * TRACE_BUS(ctrl, byte) records one transaction. ctrl is TRACE_RS and/or
+ * TRACE_RW for the register and direction of the transfer, i.e.
+ *
+ *   0                   : instruction written.
+ *   TRACE_RW            : busy flag and address read.
+ *   TRACE_RS            : data written.
+ *   TRACE_RS | TRACE_RW : data read.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifdef LCD_TRACE
+  #define TRACE_BUS(c, byte)                                                   \
+    do                                                                         \
+    {                                                                          \
+      lcd_trace_t * e = &pvt_trace[(uint8_t)pvt_traceCount++ & TRACE_MASK];    \
+      if (((uint8_t)pvt_traceCount & TRACE_MASK) == 0)                         \
+        pvt_traceFull = 1;                                                     \
+      e->ctrl = (c);                                                           \
+      e->data = (byte);                                                        \
+      e->time = LCD_TIMER_NOW;                                                 \
+    }                                                                          \
+    while (0)
+#else
+  #define TRACE_BUS(c, byte)  ((void)0)
+#endif // LCD_TRACE
+
+
+/*
+ ******************************************************************************
+ *                                    TYPES
+ ******************************************************************************
+ */
+
+// One recorded bus transaction.
+typedef struct
+{
+  uint8_t  ctrl;                        // TRACE_RS and TRACE_RW
+  uint8_t  data;                        // byte transferred
+  uint16_t time;                        // LCD_TIMER_NOW when recorded
+} lcd_trace_t;
+
+#ifdef LCD_TRACE
+// The ring buffer, written by TRACE_BUS. Not for use by the application.
+extern lcd_trace_t pvt_trace[LCD_TRACE_SIZE];
+extern uint16_t    pvt_traceCount;
+extern uint8_t     pvt_traceFull;
+#endif // LCD_TRACE
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         INITIALIZE THE TRACE
+ *
+ * Description : Empties the trace and starts the LCD_TIMER time base. Should
+ *               be called before lcd_init() so the initialization is traced.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_traceInit (void);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                               DUMP THE TRACE
+ *
+ * Description : Sends the recorded transactions, oldest first, through the
+ *               USART as one line of hex per transaction:
+ *
+ *                 C DD TTTT
+ *
+ *               where C is the ctrl value (0-3, see TRACE_BUS), DD the byte
+ *               and TTTT the timestamp in LCD_TIMER ticks. The first line
+ *               gives the total number of transactions recorded, in hex and
+ *               modulo 0x10000, which is more than the number dumped once
+ *               the trace has wrapped. Once it has, all LCD_TRACE_SIZE
+ *               transactions kept are dumped, however large the total.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_traceDump (void);
+
+
+#endif // LCD_TRACE_H
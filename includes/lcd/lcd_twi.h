@@ -0,0 +1,251 @@
+/*
+ * File        : LCD_TWI.H
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Interface for an LCD on a PCF8574 I2C backpack, driven by the TWI of the
+ * AVR. Build every file of the module with -DLCD_TWI to use it as the
+ * transport (see LCD_BUS.H) in place of the parallel ports, under the same
+ * LCD_BASE instruction functions.
+ *
+ * The expander's output byte holds the control pins, the backlight and
+ * DB4-DB7, so each edge of the enable pin is one byte on the bus. Each
+ * nibble written becomes two consecutive bytes, with EN high and then low.
+ * RS changes are sent in a byte of their own, before EN rises. The bytes go
+ * into a ring buffer which the TWI interrupt sends one at a time, so the CPU
+ * is free during the transfers. The first byte queued while the bus is idle
+ * starts a transaction and the bytes queued while it is in progress are
+ * added to it, so a whole string is sent in one start/stop sequence rather
+ * than one per nibble.
+ *
+ * The execution time of each instruction or data write is waited out on the
+ * bus, as idle bytes repeating the last output, rather than by the CPU (see
+ * lcd_twiIdle()). As the backpack only connects DB4-DB7 and RW is not driven
+ * high, LCD_TWI implies 4-bit mode and LCD_WRITE_ONLY.
+ *
+ * Global interrupts must be enabled by the application (i.e. sei()) before
+ * lcd_init() is called. Not available with LCD_MULTI_INSTANCE or
+ * LCD_DEADLINE.
+ *
+ * A byte is only queued once the ring has room for it, waiting for the TWI
+ * interrupt to send the oldest if it is full. That interrupt cannot run
+ * while another is being serviced, so the ring must not fill from within
+ * one. LCD_QUEUE, whose interrupt writes to the LCD, therefore leaves each
+ * entry in its own queue until the ring has room for all LCD_TWI_WRITE_BYTES
+ * of it (see LCD_QUEUE.H).
+ */
+
+#ifndef LCD_TWI_H
+#define LCD_TWI_H
+
+#include <stdint.h>
+#include "lcd_base.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            TWI CONFIGURATION
+ *
+ * LCD_TWI_ADDR : 7-bit address of the expander. 0x27 is a PCF8574 with its
+ *                address pins high, as most backpacks are shipped. The
+ *                PCF8574A is at 0x3F.
+ *
+ * LCD_TWI_FREQ : SCL frequency in Hz. The PCF8574 is specified for 100kHz,
+ *                though many backpacks run at 400kHz.
+ *
+ * LCD_TWI_SIZE : Number of bytes in the ring buffer. Must be a power of 2
+ *                and no larger than 128. One byte is always left empty.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef LCD_TWI_ADDR
+#define LCD_TWI_ADDR         0x27
+#endif // LCD_TWI_ADDR
+
+#ifndef LCD_TWI_FREQ
+#define LCD_TWI_FREQ         100000UL
+#endif // LCD_TWI_FREQ
+
+#ifndef LCD_TWI_SIZE
+#define LCD_TWI_SIZE         64
+#endif // LCD_TWI_SIZE
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                EXPANDER PINS
+ *
+ * Bits of the expander's output byte, as wired on the common backpacks.
+ * DB4-DB7 are on P4-P7.
+ * ----------------------------------------------------------------------------
+ */
+
+#define LCD_TWI_RS           0                             /* P0 */
+#define LCD_TWI_RW           1                             /* P1 */
+#define LCD_TWI_EN           2                             /* P2 */
+#define LCD_TWI_BL           3                             /* P3, backlight */
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              BYTES PER WRITE
+ *
+ * Most bytes lcd_twiWriteInstr() or lcd_twiWriteData() adds to the ring. Two
+ * per nibble, and one more for the RS change before the first.
+ * ----------------------------------------------------------------------------
+ */
+
+#define LCD_TWI_WRITE_BYTES  5
+
+
+/*
+ ******************************************************************************
+ *                              FUNCTION PROTOTYPES
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           INITIALIZE THE TWI
+ *
+ * Description : Waits for any bytes still queued to be sent, then empties
+ *               the ring buffer, sets the bit rate for LCD_TWI_FREQ and
+ *               enables the TWI, and sends the pins with EN low and the
+ *               backlight on. Returns once they have been sent. Called by
+ *               lcd_init() and lcd_warmInit().
+ *
+ * Arguments   : lcd     the LCD.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_twiInit (lcd_t * lcd);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               WRITE AN INITIALIZATION NIBBLE
+ *
+ * Description : Queues the lower 4 bits of nib on DB4-DB7 as an instruction
+ *               nibble, and waits for it to be sent.
+ *
+ * Arguments   : lcd     the LCD.
+ *               nib     high nibble of an instruction, in the lower 4 bits.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_twiWriteNibble (lcd_t * lcd, uint8_t nib);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 WRITE AN INSTRUCTION OR DATA
+ *
+ * Description : Queues an instruction (lcd_twiWriteInstr()) or data
+ *               (lcd_twiWriteData()) byte, as its high nibble and then its
+ *               low nibble, with RS set to select the register. Returns
+ *               without waiting for the bytes to be sent.
+ *
+ * Arguments   : lcd      the LCD.
+ *               inst     instruction and settings.
+ *               data     data byte.
+ *
+ * Returns     : void
+ *
+ * Notes       : Waits for room if the ring buffer is full.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_twiWriteInstr (lcd_t * lcd, uint8_t inst);
+void lcd_twiWriteData (lcd_t * lcd, uint8_t data);
+
+// RS is only set up when it differs from the last byte queued, so the
+// bytes of a run after the first are written the same way (see LCD_BUS.H).
+#define lcd_twiWriteDataNext  lcd_twiWriteData
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 IDLE THE BUS
+ *
+ * Description : Queues enough idle bytes, repeating the last output, for us
+ *               microseconds to pass on the bus before the next nibble is
+ *               latched. The EN high and low bytes of that nibble count
+ *               towards it. Used by lcd_waitClearBusy() to wait out the
+ *               execution time of the last byte sent without the CPU.
+ *
+ * Arguments   : lcd    the LCD.
+ *               us     time in microseconds.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_twiIdle (lcd_t * lcd, uint16_t us);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    WAIT FOR BYTES TO BE SENT
+ *
+ * Description : Blocks until every queued byte has been sent and the
+ *               transaction has been stopped.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_twiFlush (void);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    BACKLIGHT
+ *
+ * Description : Turns the backlight on or off, by queuing the pins with the
+ *               new setting.
+ *
+ * Arguments   : on     1 for on, 0 for off.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_twiBacklight (uint8_t on);
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         PENDING BYTES/ERRORS
+ *
+ * Description : lcd_twiPending() returns the number of bytes queued but not
+ *               yet sent. lcd_twiErrors() returns the number of transactions
+ *               that were not acknowledged by the expander, or lost the bus.
+ *               The bytes queued at the time are discarded, so the LCD
+ *               should be initialized again after an error.
+ *
+ * Arguments   : void
+ *
+ * Returns     : Number of bytes or errors.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_twiPending (void);
+uint16_t lcd_twiErrors (void);
+
+
+#endif // LCD_TWI_H
@@ -0,0 +1,1069 @@
+/*
+ * File        : HD44780.C
+ * Author      : Joshua Fain
+ * Host Target : Linux (gcc)
+ * LCD         : HD44780 emulator
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of HD44780.H
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include "lcd_base.h"
+#include "lcd_addr.h"
+#include "hd44780.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+#ifndef F_CPU
+#define F_CPU                16000000UL
+#endif // F_CPU
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            CONTROLLER TIMING
+ *
+ * Minimum bus timing (maximum for HD_T_DDR) in nanoseconds and execution
+ * times in microseconds of the modelled controller. The defaults are those
+ * of the HD44780U at 5V with a 270kHz oscillator. These are deliberately
+ * independent of LCD_TIMING.H, so the driver is checked against the model
+ * rather than against itself.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef HD_T_CYC_E
+#define HD_T_CYC_E           500
+#endif
+#ifndef HD_T_PW_EH
+#define HD_T_PW_EH           230
+#endif
+#ifndef HD_T_AS
+#define HD_T_AS              40
+#endif
+#ifndef HD_T_DSW
+#define HD_T_DSW             80
+#endif
+#ifndef HD_T_DDR
+#define HD_T_DDR             160
+#endif
+
+#ifndef HD_EXEC_US
+#define HD_EXEC_US           37
+#endif
+#ifndef HD_EXEC_LONG_US
+#define HD_EXEC_LONG_US      1520
+#endif
+#ifndef HD_T_ADD_US
+#define HD_T_ADD_US          4
+#endif
+#ifndef HD_POWER_ON_US
+#define HD_POWER_ON_US       10000
+#endif
+
+#define PS_PER_NS            1000ULL
+#define PS_PER_US            1000000ULL
+#define PS_PER_CYCLE         (1000000000000ULL / F_CPU)
+
+// CPU cycles taken by each register access.
+#define HD_ACCESS_CYCLES     1
+
+// ports the LCD is wired to, as in LCD_BASE.H. The controllers share the
+// data bus, RS and RW, and each has its own ENABLE pin.
+#define HD_DATA_PORT         HD_PORTA
+#define HD_DATA_DDR          HD_DDRA
+#define HD_DATA_PIN          HD_PINA
+#define HD_CTRL_PORT         HD_PORTC
+#define HD_CTRL_DDR          HD_DDRC
+#define HD_RS                PC0
+#define HD_RW                PC1
+#define HD_EN_PINS           { PC2, PC3 }
+
+// data port pins connected to the LCD.
+#if (LCD_DATA_LENGTH == DATA_LENGTH_4_BITS)
+  #define HD_BUS_MASK        DATA_NIBBLE_MASK
+#else
+  #define HD_BUS_MASK        0xFF
+#endif
+
+// controller register bits
+#define HD_DL                0x10                 // FUNCTION_SET 8-bit
+#define HD_N                 0x08                 // FUNCTION_SET 2 lines
+#define HD_ID                0x02                 // ENTRY_MODE_SET increment
+#define HD_S                 0x01                 // ENTRY_MODE_SET shift
+#define HD_D                 0x04                 // DISPLAY_CTRL display on
+
+#define HD_LINE_LEN          40                   // DDRAM per line, 2 lines
+
+// 7-bit address of the PCF8574, and the pins of it and of the 74HC595 as in
+// LCD_TWI.H and LCD_SPI.H. DB4-DB7 are on P4-P7, or QE-QH.
+#ifndef HD_TWI_ADDR
+#define HD_TWI_ADDR          0x27
+#endif
+#define HD_X_RS              0
+#define HD_X_RW              1
+#define HD_X_EN              2
+#define HD_X_BL              3
+
+// DB4-DB7 of those outputs, as they would be on the data port.
+#define HD_X_DATA(out)       (((out) >> 4) << DATA_NIBBLE_SHIFT)
+
+// TWI operations in progress, and the master transmitter status codes.
+#define HD_TWI_IDLE          0
+#define HD_TWI_START         1
+#define HD_TWI_BYTE          2
+#define HD_TW_START          0x08
+#define HD_TW_REP_START      0x10
+#define HD_TW_SLA_ACK        0x18
+#define HD_TW_SLA_NACK       0x20
+#define HD_TW_DATA_ACK       0x28
+#define HD_TW_DATA_NACK      0x30
+
+// latch clock (RCLK) of the 74HC595.
+#define HD_RCLK_PORT         HD_PORTB
+#define HD_RCLK_DDR          HD_DDRB
+#define HD_RCLK              PB0
+
+
+/*
+ ******************************************************************************
+ *                                    TYPES
+ ******************************************************************************
+ */
+
+// state of one controller.
+typedef struct
+{
+  uint8_t  en;                            // ENABLE as last sampled
+  uint64_t riseAt;                        // when ENABLE last rose
+  uint8_t  risen;
+  uint8_t  out;                           // byte being read
+  uint64_t outValidAt;
+  uint8_t  ddram[128];
+  uint8_t  cgram[64];
+  uint8_t  ac, acOld, acCGRAM;
+  uint8_t  entry, display, function;
+  uint8_t  shift;                         // display shift, 0 to 39
+  uint8_t  nibble, hiNibble;              // 4-bit transfer phase
+  uint64_t busyUntil, acValidAt;
+} pvt_hdCtrl_t;
+
+
+/*
+ ******************************************************************************
+ *                                 "PRIVATE" DATA
+ ******************************************************************************
+ */
+
+volatile uint8_t  pvt_hdRegs[HD_REG_COUNT];
+volatile uint16_t pvt_hdRegs16[HD_REG16_COUNT];
+
+// simulated clock, in picoseconds
+uint64_t pvt_hdNow;
+uint64_t pvt_hdLastAccess;                // time of the most recent access
+uint8_t  pvt_hdPowered;
+
+// interrupts and Timer/Counter2
+uint8_t  pvt_hdIntOn;
+uint8_t  pvt_hdInIsr;
+uint64_t pvt_hdT2Ps;                      // time since last compare match
+uint64_t pvt_hdT1Base;                    // time TCNT1 was last set
+uint16_t pvt_hdT1Start;                   // TCNT1 at pvt_hdT1Base
+uint16_t pvt_hdT1Last;                    // TCNT1 as last computed
+uint8_t  pvt_hdT1Clock;                   // TCCR1B clock select
+
+// TWI and the expander
+uint8_t  pvt_hdTwiOp;                     // operation in progress
+uint64_t pvt_hdTwiAt;                     // when it completes
+uint64_t pvt_hdTwiFreeAt;                 // when the last stop completes
+uint8_t  pvt_hdTwiByte;                   // byte being sent
+uint8_t  pvt_hdTwiFlag;                   // TWINT
+uint8_t  pvt_hdTwiStarted, pvt_hdTwiSla, pvt_hdTwiAcked;
+uint8_t  pvt_hdExpander = 0xFF;           // PCF8574 outputs
+
+// SPI and the shift register
+uint8_t  pvt_hdSpiBusy;                   // a byte is shifting
+uint8_t  pvt_hdSpiByte;                   // byte being shifted
+uint64_t pvt_hdSpiFrom, pvt_hdSpiAt;      // when it started and completes
+uint64_t pvt_hdSpiPeriodPs;               // its SCK period
+uint8_t  pvt_hdShiftReg;                  // 74HC595 shift register
+uint8_t  pvt_hdShiftOut;                  // 74HC595 outputs
+uint8_t  pvt_hdRclk;                      // RCLK as last sampled
+
+// pins as last sampled, and when they changed
+uint8_t  pvt_hdRs, pvt_hdRw, pvt_hdData;
+uint64_t pvt_hdCtrlAt, pvt_hdDataAt;
+uint8_t  pvt_hdStalePins;
+
+// the controllers, and the one inspected by hd_ddram() etc.
+pvt_hdCtrl_t pvt_hdCtrls[HD_CTRLS];
+const uint8_t pvt_hdEnPins[HD_CTRLS] = HD_EN_PINS;
+pvt_hdCtrl_t * pvt_hdSel = &pvt_hdCtrls[0];
+
+hd_stats_t pvt_hdStats;
+
+const char * const pvt_hdViolNames[HD_VIOL_COUNT] =
+{
+  "tAS", "PWEH", "tcycE", "tDSW", "tDDR", "busy", "contention"
+};
+
+// LCD_QUEUE and LCD_TWI interrupts, if they are linked in.
+void TIMER2_COMPA_vect (void) __attribute__((weak));
+void TWI_vect (void) __attribute__((weak));
+
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTIONS
+ ******************************************************************************
+ */
+
+//
+// Controller state after its internal reset at power on.
+//
+void pvt_hdPowerOn (void)
+{
+  for (pvt_hdCtrl_t * c = pvt_hdCtrls; c < pvt_hdCtrls + HD_CTRLS; c++)
+  {
+    memset (c->ddram, ' ', sizeof c->ddram);
+    c->function  = HD_DL;
+    c->entry     = HD_ID;
+    c->display   = 0;
+    c->busyUntil = HD_POWER_ON_US * PS_PER_US;
+  }
+  pvt_hdRegs16[HD_SPDR] = HD_SPDR_EMPTY;
+  pvt_hdPowered = 1;
+}
+
+//
+// Steps the address counter in the direction given, wrapping as the
+// controller does in the current line mode.
+//
+void pvt_hdStepAC (pvt_hdCtrl_t * c, uint8_t increment)
+{
+  if (c->acCGRAM)
+    c->ac = (increment ? c->ac + 1 : c->ac - 1) & 0x3F;
+  else if (c->function & HD_N)
+  {
+    if (increment)
+      c->ac = (c->ac == 0x27) ? 0x40
+               : (c->ac == 0x67) ? 0x00 : c->ac + 1;
+    else
+      c->ac = (c->ac == 0x40) ? 0x27
+               : (c->ac == 0x00) ? 0x67 : c->ac - 1;
+  }
+  else
+  {
+    if (increment)
+      c->ac = (c->ac == 0x4F) ? 0x00 : c->ac + 1;
+    else
+      c->ac = (c->ac == 0x00) ? 0x4F : c->ac - 1;
+  }
+}
+
+//
+// Shifts the display one position. Shifting left moves the characters left,
+// i.e. the window moves right over the DDRAM.
+//
+void pvt_hdShiftDisplay (pvt_hdCtrl_t * c, uint8_t right)
+{
+  c->shift = right ? (c->shift + HD_LINE_LEN - 1) % HD_LINE_LEN
+                   : (c->shift + 1) % HD_LINE_LEN;
+}
+
+//
+// Executes a byte written to the controller at time t.
+//
+void pvt_hdExecute (pvt_hdCtrl_t * c, uint8_t byte, uint8_t rs, uint64_t t)
+{
+  uint32_t execUs = HD_EXEC_US;
+
+  // the real controller ignores bytes sent while it is busy.
+  if (t < c->busyUntil)
+  {
+    pvt_hdStats.violations[HD_VIOL_BUSY]++;
+    return;
+  }
+
+  c->acOld = c->ac;
+
+  if (rs)
+  {
+    if (c->acCGRAM)
+      c->cgram[c->ac & 0x3F] = byte;
+    else
+      c->ddram[c->ac & 0x7F] = byte;
+
+    pvt_hdStepAC (c, c->entry & HD_ID);
+    if ((c->entry & HD_S) && !c->acCGRAM)
+      pvt_hdShiftDisplay (c, !(c->entry & HD_ID));
+
+    pvt_hdStats.dataWrites++;
+    c->busyUntil = t + execUs * PS_PER_US;
+    c->acValidAt = c->busyUntil + HD_T_ADD_US * PS_PER_US;
+    return;
+  }
+
+  if (byte & 0x80)                                  // SET_DDRAM_ADDR
+  {
+    c->ac = byte & 0x7F;
+    c->acCGRAM = 0;
+  }
+  else if (byte & 0x40)                             // SET_CGRAM_ADDR
+  {
+    c->ac = byte & 0x3F;
+    c->acCGRAM = 1;
+  }
+  else if (byte & 0x20)                             // FUNCTION_SET
+  {
+    c->function = byte & 0x1C;
+    c->nibble = 0;
+  }
+  else if (byte & 0x10)                             // CURSOR_DISPLAY_SHIFT
+  {
+    if (byte & 0x08)
+      pvt_hdShiftDisplay (c, byte & 0x04);
+    else
+      pvt_hdStepAC (c, byte & 0x04);
+  }
+  else if (byte & 0x08)                             // DISPLAY_CTRL
+    c->display = byte & 0x07;
+  else if (byte & 0x04)                             // ENTRY_MODE_SET
+    c->entry = byte & 0x03;
+  else if (byte & 0x03)                             // RETURN_HOME, CLEAR
+  {
+    if (byte & 0x01)
+    {
+      memset (c->ddram, ' ', sizeof c->ddram);
+      c->entry |= HD_ID;
+    }
+    c->ac = 0;
+    c->acCGRAM = 0;
+    c->shift = 0;
+    execUs = HD_EXEC_LONG_US;
+  }
+
+  pvt_hdStats.instructions++;
+  c->busyUntil = t + execUs * PS_PER_US;
+  c->acValidAt = c->busyUntil;
+}
+
+//
+// ENABLE rose at time t.
+//
+void pvt_hdRise (pvt_hdCtrl_t * c, uint64_t t)
+{
+  if (c->risen && t - c->riseAt < HD_T_CYC_E * PS_PER_NS)
+    pvt_hdStats.violations[HD_VIOL_T_CYC_E]++;
+  if (t - pvt_hdCtrlAt < HD_T_AS * PS_PER_NS)
+    pvt_hdStats.violations[HD_VIOL_T_AS]++;
+
+  c->riseAt = t;
+  c->risen = 1;
+
+  if (!pvt_hdRw)
+    return;
+
+  if (pvt_hdRegs[HD_DATA_DDR] & HD_BUS_MASK)
+    pvt_hdStats.violations[HD_VIOL_CONTENTION]++;
+
+  // the byte is latched at the start of a transfer.
+  if (c->nibble == 0 || (c->function & HD_DL))
+  {
+    if (pvt_hdRs)
+    {
+      if (t < c->busyUntil)
+        pvt_hdStats.violations[HD_VIOL_BUSY]++;
+      c->out = c->acCGRAM ? c->cgram[c->ac & 0x3F]
+                                : c->ddram[c->ac & 0x7F];
+    }
+    else
+    {
+      c->out  = (t < c->busyUntil) ? BUSY_MASK : 0;
+      c->out |= (t < c->acValidAt) ? c->acOld : c->ac;
+    }
+  }
+
+  c->outValidAt = t + HD_T_DDR * PS_PER_NS;
+}
+
+//
+// ENABLE fell at time t.
+//
+void pvt_hdFall (pvt_hdCtrl_t * c, uint64_t t)
+{
+  uint8_t done = 1;
+
+  pvt_hdStats.enablePulses++;
+  if (t - c->riseAt < HD_T_PW_EH * PS_PER_NS)
+    pvt_hdStats.violations[HD_VIOL_PW_EH]++;
+
+  if (!pvt_hdRw)
+  {
+    if (t - pvt_hdDataAt < HD_T_DSW * PS_PER_NS)
+      pvt_hdStats.violations[HD_VIOL_T_DSW]++;
+
+    // DB0-DB7 as seen by the controller. DB0-DB3 read 0 if not wired.
+    uint8_t db = pvt_hdData & HD_BUS_MASK;
+#if (LCD_DATA_LENGTH == DATA_LENGTH_4_BITS)
+    db = (db >> DATA_NIBBLE_SHIFT) << 4;
+#endif
+
+    if (c->function & HD_DL)
+      pvt_hdExecute (c, db, pvt_hdRs, t);
+    else if (c->nibble == 0)
+    {
+      c->hiNibble = db & 0xF0;
+      c->nibble = 1;
+    }
+    else
+    {
+      c->nibble = 0;
+      pvt_hdExecute (c, c->hiNibble | db >> 4, pvt_hdRs, t);
+    }
+    return;
+  }
+
+  if (!(c->function & HD_DL))
+  {
+    c->nibble ^= 1;
+    done = !c->nibble;
+  }
+
+  if (!done)
+    return;
+
+  if (pvt_hdRs)
+  {
+    c->acOld = c->ac;
+    pvt_hdStepAC (c, c->entry & HD_ID);
+    c->busyUntil = t + HD_EXEC_US * PS_PER_US;
+    c->acValidAt = c->busyUntil + HD_T_ADD_US * PS_PER_US;
+    pvt_hdStats.dataReads++;
+  }
+  else
+    pvt_hdStats.busyReads++;
+}
+
+//
+// Applies the levels of the pins at time t. Bit i of ens is the ENABLE of
+// controller i.
+//
+void pvt_hdPins (uint8_t rs, uint8_t rw, uint8_t data, uint8_t ens, 
+                 uint64_t t)
+{
+  if (rs != pvt_hdRs || rw != pvt_hdRw)
+    pvt_hdCtrlAt = t;
+  if (data != pvt_hdData)
+    pvt_hdDataAt = t;
+
+  pvt_hdRs = rs;
+  pvt_hdRw = rw;
+  pvt_hdData = data;
+
+  for (uint8_t i = 0; i < HD_CTRLS; i++)
+  {
+    pvt_hdCtrl_t * c = &pvt_hdCtrls[i];
+    uint8_t en = (ens >> i) & 1;
+
+    if (en && !c->en)
+    {
+      c->en = 1;
+      pvt_hdRise (c, t);
+    }
+    else if (!en && c->en)
+    {
+      c->en = 0;
+      pvt_hdFall (c, t);
+    }
+  }
+}
+
+//
+// Returns the SCL period of the TWI in picoseconds.
+//
+uint64_t pvt_hdTwiPeriod (void)
+{
+  uint8_t prescale = 1 << 2 * (pvt_hdRegs[HD_TWSR] & 0x03);
+
+  return (16 + 2ULL * pvt_hdRegs[HD_TWBR] * prescale) * PS_PER_CYCLE;
+}
+
+//
+// Starts the TWI operation requested by the most recent write of TWCR with
+// TWINT set, and ends a stop once it has been sent. A start waits for the
+// bus to be free.
+//
+void pvt_hdTwiSync (void)
+{
+  uint8_t  twcr = pvt_hdRegs[HD_TWCR];
+  uint64_t period = pvt_hdTwiPeriod();
+
+  if (twcr & (1 << TWINT))
+  {
+    twcr &= ~(1 << TWINT);
+    pvt_hdTwiFlag = 0;
+    pvt_hdTwiOp = HD_TWI_IDLE;
+
+    if (!(twcr & (1 << TWEN)))
+      pvt_hdTwiStarted = 0;
+    else if (twcr & (1 << TWSTO))
+    {
+      pvt_hdTwiStarted = 0;
+      pvt_hdTwiAcked = 0;
+      pvt_hdTwiFreeAt = pvt_hdLastAccess + period;
+    }
+    else if (twcr & (1 << TWSTA))
+    {
+      pvt_hdTwiOp = HD_TWI_START;
+      pvt_hdTwiAt = (pvt_hdLastAccess > pvt_hdTwiFreeAt ? pvt_hdLastAccess
+                                                        : pvt_hdTwiFreeAt)
+                    + period;
+    }
+    else
+    {
+      pvt_hdTwiOp = HD_TWI_BYTE;
+      pvt_hdTwiByte = pvt_hdRegs[HD_TWDR];
+      pvt_hdTwiAt = pvt_hdLastAccess + 9 * period;
+    }
+  }
+
+  if ((twcr & (1 << TWSTO)) && pvt_hdNow >= pvt_hdTwiFreeAt)
+    twcr &= ~(1 << TWSTO);
+  pvt_hdRegs[HD_TWCR] = twcr;
+}
+
+//
+// Completes the TWI operation in progress, setting TWSR and TWINT. A data
+// byte acknowledged by the expander sets its outputs, which with LCD_TWI
+// drive the first controller.
+//
+void pvt_hdTwiEvent (void)
+{
+  uint8_t status;
+
+  if (pvt_hdTwiOp == HD_TWI_START)
+  {
+    status = pvt_hdTwiStarted ? HD_TW_REP_START : HD_TW_START;
+    pvt_hdTwiStarted = 1;
+    pvt_hdTwiSla = 1;
+    pvt_hdStats.twiStarts++;
+  }
+  else if (pvt_hdTwiSla)
+  {
+    pvt_hdTwiSla = 0;
+    pvt_hdTwiAcked = (pvt_hdTwiByte == HD_TWI_ADDR << 1);
+    status = pvt_hdTwiAcked ? HD_TW_SLA_ACK : HD_TW_SLA_NACK;
+  }
+  else if (pvt_hdTwiAcked)
+  {
+    uint8_t out = pvt_hdTwiByte;
+
+    pvt_hdExpander = out;
+    pvt_hdStats.twiBytes++;
+#ifdef LCD_TWI
+    pvt_hdPins ((out >> HD_X_RS) & 1, (out >> HD_X_RW) & 1,
+                HD_X_DATA (out), (out >> HD_X_EN) & 1, pvt_hdTwiAt);
+#endif
+    status = HD_TW_DATA_ACK;
+  }
+  else
+    status = HD_TW_DATA_NACK;
+
+  pvt_hdTwiOp = HD_TWI_IDLE;
+  pvt_hdTwiFlag = 1;
+  pvt_hdRegs[HD_TWSR] = status | (pvt_hdRegs[HD_TWSR] & 0x03);
+}
+
+//
+// Returns the SCK period of the SPI in picoseconds.
+//
+uint64_t pvt_hdSpiPeriod (void)
+{
+  static const uint8_t divisor[4] = { 4, 16, 64, 128 };
+  uint8_t spr = pvt_hdRegs[HD_SPCR] & ((1 << SPR1) | (1 << SPR0));
+
+  return divisor[spr] * PS_PER_CYCLE >> (pvt_hdRegs[HD_SPSR] & (1 << SPI2X));
+}
+
+//
+// Starts shifting a byte written to SPDR by the most recent access, and
+// copies the shift register to its outputs on a rising edge of RCLK. With
+// LCD_SPI the outputs drive the first controller.
+//
+void pvt_hdSpiSync (void)
+{
+  uint16_t spdr = pvt_hdRegs16[HD_SPDR];
+  uint8_t  rclk = (pvt_hdRegs[HD_RCLK_PORT] & pvt_hdRegs[HD_RCLK_DDR]) 
+                  >> HD_RCLK & 1;
+
+  if (spdr != HD_SPDR_EMPTY)
+  {
+    pvt_hdRegs16[HD_SPDR] = HD_SPDR_EMPTY;
+
+    if (pvt_hdSpiBusy)
+      pvt_hdRegs[HD_SPSR] |= 1 << WCOL;
+    else if (pvt_hdRegs[HD_SPCR] & (1 << SPE))
+    {
+      pvt_hdSpiBusy = 1;
+      pvt_hdSpiByte = spdr;
+      pvt_hdSpiPeriodPs = pvt_hdSpiPeriod();
+      pvt_hdSpiFrom = pvt_hdLastAccess;
+      pvt_hdSpiAt = pvt_hdLastAccess + 8 * pvt_hdSpiPeriodPs;
+      pvt_hdRegs[HD_SPSR] &= ~((1 << SPIF) | (1 << WCOL));
+    }
+  }
+
+  if (rclk && !pvt_hdRclk)
+  {
+    uint8_t out = pvt_hdShiftReg;
+
+    // the bits shifted in so far, MSB first.
+    if (pvt_hdSpiBusy)
+    {
+      uint8_t bits = (pvt_hdLastAccess - pvt_hdSpiFrom) / pvt_hdSpiPeriodPs;
+
+      out = (uint8_t)(out << bits | pvt_hdSpiByte >> (8 - bits));
+    }
+    pvt_hdShiftOut = out;
+#ifdef LCD_SPI
+    pvt_hdPins ((out >> HD_X_RS) & 1, (out >> HD_X_RW) & 1,
+                HD_X_DATA (out), (out >> HD_X_EN) & 1, pvt_hdLastAccess);
+#endif
+  }
+  pvt_hdRclk = rclk;
+}
+
+//
+// Completes the byte being shifted, setting SPIF.
+//
+void pvt_hdSpiEvent (void)
+{
+  pvt_hdShiftReg = pvt_hdSpiByte;
+  pvt_hdSpiBusy = 0;
+  pvt_hdStats.spiBytes++;
+  pvt_hdRegs[HD_SPSR] |= 1 << SPIF;
+}
+
+//
+// Applies the pin changes and TWI and SPI requests made by the most recent
+// register access. With LCD_TWI or LCD_SPI the controllers are driven by the
+// expander or the shift register instead.
+//
+void pvt_hdSync (void)
+{
+  pvt_hdTwiSync();
+  pvt_hdSpiSync();
+
+#if !defined (LCD_TWI) && !defined (LCD_SPI)
+  uint8_t ctrl = pvt_hdRegs[HD_CTRL_PORT] & pvt_hdRegs[HD_CTRL_DDR];
+  uint8_t data = pvt_hdRegs[HD_DATA_PORT] & pvt_hdRegs[HD_DATA_DDR];
+  uint8_t ens  = 0;
+#ifdef LCD_WRITE_ONLY
+  uint8_t rw   = 0;                                  // tied to ground
+#else
+  uint8_t rw   = (ctrl >> HD_RW) & 1;
+#endif
+
+  for (uint8_t i = 0; i < HD_CTRLS; i++)
+    ens |= ((ctrl >> pvt_hdEnPins[i]) & 1) << i;
+
+  pvt_hdPins ((ctrl >> HD_RS) & 1, rw, data, ens, pvt_hdLastAccess);
+#endif
+}
+
+//
+// Sets the value of DATA_PIN. While ENABLE is high in read mode, the
+// controller drives the connected pins. Two controllers doing so at once
+// contend for them.
+//
+void pvt_hdDrivePins (void)
+{
+  uint8_t ddr  = pvt_hdRegs[HD_DATA_DDR];
+  uint8_t port = pvt_hdRegs[HD_DATA_PORT];
+  uint8_t pins = port;                       // outputs, and pull-ups
+  uint8_t driving = 0;
+
+  for (pvt_hdCtrl_t * c = pvt_hdCtrls; c < pvt_hdCtrls + HD_CTRLS; c++)
+  {
+    if (!c->en || !pvt_hdRw)
+      continue;
+    if (driving++)
+      pvt_hdStats.violations[HD_VIOL_CONTENTION]++;
+
+    uint8_t out = c->out;
+
+#if (LCD_DATA_LENGTH == DATA_LENGTH_4_BITS)
+    out = (c->nibble == 0 || (c->function & HD_DL)) ? out >> 4 : out;
+    out = (out & 0x0F) << DATA_NIBBLE_SHIFT;
+#endif
+
+    // the pins still hold their previous value until tDDR has passed.
+    if (pvt_hdNow < c->outValidAt)
+    {
+      pvt_hdStats.violations[HD_VIOL_T_DDR]++;
+      out = pvt_hdStalePins;
+    }
+    pins = (pins & ~(HD_BUS_MASK & ~ddr)) | (out & HD_BUS_MASK & ~ddr);
+  }
+
+  pvt_hdStalePins = pins;
+  pvt_hdRegs[HD_DATA_PIN] = pins;
+}
+
+//
+// Runs an interrupt service routine, and applies the changes made by its
+// last register access.
+//
+void pvt_hdIsr (void (* vect) (void))
+{
+  pvt_hdInIsr = 1;
+  pvt_hdIntOn = 0;
+  vect();
+  pvt_hdSync();
+  pvt_hdIntOn = 1;
+  pvt_hdInIsr = 0;
+}
+
+//
+// Runs the Timer/Counter2 compare match and TWI interrupts if they are
+// pending and enabled.
+//
+void pvt_hdService (void)
+{
+  if (!pvt_hdIntOn || pvt_hdInIsr)
+    return;
+
+  if (TIMER2_COMPA_vect != NULL
+      && (pvt_hdRegs[HD_TIFR2] & pvt_hdRegs[HD_TIMSK2] & (1 << OCF2A)))
+  {
+    pvt_hdRegs[HD_TIFR2] &= ~(1 << OCF2A);
+    pvt_hdIsr (TIMER2_COMPA_vect);
+  }
+
+  if (TWI_vect != NULL && pvt_hdTwiFlag
+      && (pvt_hdRegs[HD_TWCR] & (1 << TWIE)))
+    pvt_hdIsr (TWI_vect);
+}
+
+//
+// Prints the top or bottom border of the display, LCD_COLS wide.
+//
+void pvt_hdPrintBorder (void)
+{
+  putchar ('+');
+  for (uint8_t col = 0; col < LCD_COLS; col++)
+    putchar ('-');
+  putchar ('+');
+}
+
+//
+// Returns the Timer/Counter2 compare match period in picoseconds, or 0 if
+// the timer is stopped or not in CTC mode.
+//
+uint64_t pvt_hdT2Period (void)
+{
+  static const uint16_t prescale[8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+  uint8_t cs = pvt_hdRegs[HD_TCCR2B] & 0x07;
+
+  if (cs == 0 || !(pvt_hdRegs[HD_TCCR2A] & (1 << WGM21)))
+    return 0;
+
+  return (uint64_t)(pvt_hdRegs[HD_OCR2A] + 1) * prescale[cs] * PS_PER_CYCLE;
+}
+
+//
+// Advances the simulated clock, running the timer, the TWI, the SPI and
+// their interrupts.
+//
+void pvt_hdAdvance (uint64_t ps)
+{
+  while (ps > 0)
+  {
+    uint64_t period = pvt_hdT2Period();
+    uint64_t step = ps;
+
+    if (period && period - pvt_hdT2Ps < step)
+      step = period - pvt_hdT2Ps;
+    if (pvt_hdTwiOp != HD_TWI_IDLE && pvt_hdTwiAt > pvt_hdNow
+        && pvt_hdTwiAt - pvt_hdNow < step)
+      step = pvt_hdTwiAt - pvt_hdNow;
+    if (pvt_hdSpiBusy && pvt_hdSpiAt > pvt_hdNow
+        && pvt_hdSpiAt - pvt_hdNow < step)
+      step = pvt_hdSpiAt - pvt_hdNow;
+
+    pvt_hdNow += step;
+    ps -= step;
+
+    if (period)
+    {
+      pvt_hdT2Ps += step;
+      if (pvt_hdT2Ps >= period)
+      {
+        pvt_hdT2Ps = 0;
+        pvt_hdRegs[HD_TIFR2] |= 1 << OCF2A;
+      }
+    }
+    if (pvt_hdTwiOp != HD_TWI_IDLE && pvt_hdNow >= pvt_hdTwiAt)
+      pvt_hdTwiEvent();
+    if (pvt_hdSpiBusy && pvt_hdNow >= pvt_hdSpiAt)
+      pvt_hdSpiEvent();
+    pvt_hdService();
+  }
+}
+
+
+//
+// Brings TCNT1 up to date with the simulated clock. A value written by the
+// program since the last update, or a change of the clock select, restarts
+// the count from that point.
+//
+void pvt_hdTimer1 (void)
+{
+  static const uint16_t prescale[6] = { 0, 1, 8, 64, 256, 1024 };
+  uint8_t  cs = pvt_hdRegs[HD_TCCR1B] & 0x07;
+  uint16_t count;
+
+  if (pvt_hdRegs16[HD_TCNT1] != pvt_hdT1Last || cs != pvt_hdT1Clock)
+  {
+    pvt_hdT1Start = pvt_hdRegs16[HD_TCNT1];
+    pvt_hdT1Base  = pvt_hdNow;
+    pvt_hdT1Clock = cs;
+  }
+
+  count = pvt_hdT1Start;
+  if (cs > 0 && cs < 6)
+    count += (pvt_hdNow - pvt_hdT1Base) / (prescale[cs] * PS_PER_CYCLE);
+
+  pvt_hdRegs16[HD_TCNT1] = count;
+  pvt_hdT1Last = count;
+}
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             REGISTER ACCESS
+ *
+ * Description : Returns the location of an I/O register. Any pin changes
+ *               made by the previous access are applied to the model first,
+ *               then the clock is advanced by one CPU cycle. Reading PINA
+ *               returns the value driven by the LCD during a read, and
+ *               TCNT1 (hd_reg16()) the count of Timer/Counter1. SPDR is
+ *               also accessed through hd_reg16(). hd_regAt() does the same
+ *               for a register given by its location, as used by LCD_REG()
+ *               with LCD_MULTI_INSTANCE.
+ *
+ * Arguments   : id     register, one of the REGISTER IDS.
+ *               reg    location of a register returned by hd_reg().
+ *
+ * Returns     : Pointer to the register.
+ * ----------------------------------------------------------------------------
+ */
+
+volatile uint8_t * hd_reg (uint8_t id)
+{
+  if (!pvt_hdPowered)
+    pvt_hdPowerOn();
+
+  pvt_hdSync();
+  pvt_hdAdvance (HD_ACCESS_CYCLES * PS_PER_CYCLE);
+  pvt_hdLastAccess = pvt_hdNow;
+
+  if (id == HD_DATA_PIN)
+    pvt_hdDrivePins();
+
+  return &pvt_hdRegs[id];
+}
+
+volatile uint8_t * hd_regAt (volatile uint8_t * reg)
+{
+  return hd_reg (reg - pvt_hdRegs);
+}
+
+volatile uint16_t * hd_reg16 (uint8_t id)
+{
+  if (!pvt_hdPowered)
+    pvt_hdPowerOn();
+
+  pvt_hdSync();
+  pvt_hdTimer1();
+  pvt_hdAdvance (HD_ACCESS_CYCLES * PS_PER_CYCLE);
+  pvt_hdLastAccess = pvt_hdNow;
+
+  return &pvt_hdRegs16[id];
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              SIMULATED TIME
+ *
+ * Description : hd_delayCycles() and hd_delayUs() advance the simulated clock.
+ *               hd_timePs() returns the simulated time since start-up, in
+ *               picoseconds.
+ *
+ * Arguments   : cycles     CPU cycles, at F_CPU.
+ *               us         microseconds.
+ * ----------------------------------------------------------------------------
+ */
+
+void hd_delayCycles (uint32_t cycles)
+{
+  pvt_hdSync();
+  pvt_hdAdvance (cycles * PS_PER_CYCLE);
+}
+
+void hd_delayUs (double us)
+{
+  pvt_hdSync();
+  pvt_hdAdvance ((uint64_t)(us * PS_PER_US));
+}
+
+uint64_t hd_timePs (void)
+{
+  return pvt_hdNow;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            GLOBAL INTERRUPTS
+ *
+ * Description : Enables (1) or disables (0) the simulated interrupts, as sei()
+ *               and cli() do.
+ *
+ * Arguments   : enable     1 to enable, 0 to disable.
+ *
+ * Returns     : Previous setting.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t hd_setInterrupts (uint8_t enable)
+{
+  uint8_t prev = pvt_hdIntOn;
+
+  pvt_hdIntOn = enable ? 1 : 0;
+  if (pvt_hdIntOn && !prev)
+    pvt_hdService();
+  return prev;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             INSPECT THE MODEL
+ *
+ * Description : hd_ddram() and hd_cgram() return a byte of the controller's
+ *               RAM. hd_displayChar() returns the character code shown at a
+ *               position of the display, of the LCD_GEOMETRY profile in
+ *               LCD_ADDR.H, taking the display shift into account.
+ *               hd_stats() returns the bus activity counts.
+ *               hd_printDisplay() prints the display contents, and
+ *               hd_printReport() the counts, to stdout. The counts are of
+ *               all the controllers, and the other functions refer to the
+ *               one chosen with hd_select(), controller 0 by default.
+ *               hd_select() returns the controller chosen before.
+ *
+ * Arguments   : ctrl     controller, 0 to HD_CTRLS - 1.
+ *               addr     RAM address.
+ *               row      display line, 0 to LCD_ROWS - 1.
+ *               col      position in the line, 0 to LCD_COLS - 1.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t hd_select (uint8_t ctrl)
+{
+  uint8_t prev = pvt_hdSel - pvt_hdCtrls;
+
+  if (ctrl < HD_CTRLS)
+    pvt_hdSel = &pvt_hdCtrls[ctrl];
+  return prev;
+}
+
+uint8_t hd_ddram (uint8_t addr)
+{
+  return pvt_hdSel->ddram[addr & 0x7F];
+}
+
+uint8_t hd_cgram (uint8_t addr)
+{
+  return pvt_hdSel->cgram[addr & 0x3F];
+}
+
+uint8_t hd_displayChar (uint8_t row, uint8_t col)
+{
+  // lines 3 and 4 are the second half of lines 1 and 2.
+  uint8_t base = (row & 1) ? 0x40 : 0x00;
+  uint8_t pos  = ((row >> 1) * LCD_COLS + col + pvt_hdSel->shift) % HD_LINE_LEN;
+
+  return pvt_hdSel->ddram[base + pos];
+}
+
+const hd_stats_t * hd_stats (void)
+{
+  pvt_hdSync();
+  return &pvt_hdStats;
+}
+
+void hd_printDisplay (void)
+{
+  pvt_hdSync();
+
+  putchar ('\n');
+  pvt_hdPrintBorder();
+  printf ("%s", (pvt_hdSel->display & HD_D) ? "" : " (display off)");
+#if defined (LCD_TWI)
+  printf ("%s", (pvt_hdExpander & (1 << HD_X_BL)) ? "" : " (backlight off)");
+#elif defined (LCD_SPI)
+  printf ("%s", (pvt_hdShiftOut & (1 << HD_X_BL)) ? "" : " (backlight off)");
+#endif
+  putchar ('\n');
+  for (uint8_t row = 0; row < LCD_ROWS; row++)
+  {
+    putchar ('|');
+    for (uint8_t col = 0; col < LCD_COLS; col++)
+    {
+      uint8_t c = hd_displayChar (row, col);
+      putchar ((c >= 0x20 && c < 0x7F) ? c : '#');
+    }
+    printf ("|\n");
+  }
+  pvt_hdPrintBorder();
+  putchar ('\n');
+}
+
+void hd_printReport (void)
+{
+  pvt_hdSync();
+
+  printf ("time         : %.3f ms\n", pvt_hdNow / 1e9);
+  printf ("enable pulses: %u\n", pvt_hdStats.enablePulses);
+  printf ("instructions : %u\n", pvt_hdStats.instructions);
+  printf ("data writes  : %u\n", pvt_hdStats.dataWrites);
+  printf ("data reads   : %u\n", pvt_hdStats.dataReads);
+  printf ("busy reads   : %u\n", pvt_hdStats.busyReads);
+#ifdef LCD_TWI
+  printf ("twi starts   : %u\n", pvt_hdStats.twiStarts);
+  printf ("twi bytes    : %u\n", pvt_hdStats.twiBytes);
+#endif
+#ifdef LCD_SPI
+  printf ("spi bytes    : %u\n", pvt_hdStats.spiBytes);
+#endif
+  for (uint8_t v = 0; v < HD_VIOL_COUNT; v++)
+    printf ("violations   : %-10s %u\n", pvt_hdViolNames[v],
+            pvt_hdStats.violations[v]);
+}
@@ -0,0 +1,54 @@
+/*
+ * File        : USART0_HOST.C
+ * Author      : Joshua Fain
+ * Host Target : Linux (gcc)
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Host implementation of USART0.H over stdin/stdout, used in place of
+ * USART0.C when building for the host. A terminal sends a carriage return
+ * for the Enter key, so newlines read from stdin are returned as '\r'. At the
+ * end of the input the emulated display and bus statistics are printed and
+ * the program exits, as the AVR programs never return from main().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "usart0.h"
+#include "lcd_base.h"
+#include "hd44780.h"
+
+
+/*
+ ******************************************************************************
+ *                                  FUNCTIONS
+ ******************************************************************************
+ */
+
+void usart_init (void)
+{
+  setvbuf (stdout, NULL, _IOLBF, 0);
+}
+
+uint8_t usart_receive (void)
+{
+  int c = getchar();
+
+  if (c == EOF)
+  {
+#ifdef LCD_TWI
+    // the bytes still queued are sent while waiting for input.
+    lcd_twiFlush();
+#endif
+    hd_printDisplay();
+    hd_printReport();
+    exit (0);
+  }
+  return (c == '\n') ? '\r' : (uint8_t)c;
+}
+
+void usart_transmit (uint8_t data)
+{
+  putchar (data);
+}
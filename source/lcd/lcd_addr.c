@@ -0,0 +1,28 @@
+/*
+ * File        : LCD_ADDR.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_ADDR.H. Holds the lookup tables generated from the
+ * LCD_GEOMETRY profile.
+ */
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "lcd_addr.h"
+
+
+/*
+ ******************************************************************************
+ *                                 LOOKUP TABLES
+ ******************************************************************************
+ */
+
+// DDRAM address of each display position.
+const uint8_t lcd_xyAddr[LCD_ROWS][LCD_COLS] PROGMEM = XY_ADDR_TABLE;
+
+// display position of each DDRAM address, or POS_NONE.
+const uint8_t lcd_addrPos[128] PROGMEM = ADDR_POS_TABLE;
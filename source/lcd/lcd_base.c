@@ -10,12 +10,73 @@
  */
 
 #include <stdint.h>
+#include <stddef.h>
 #include <avr/io.h>
 #include <util/delay.h>
 #include "lcd_base.h"
+#include "lcd_addr.h"
+#include "lcd_timing.h"
+#include "lcd_timer.h"
+#include "lcd_trace.h"
+#include "lcd_stats.h"
 #include "prints.h"
 
 
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+// index of each cached mode register in modeSkips and bit in modesKnown of
+// lcd_t.
+#define MODE_ENTRY           0
+#define MODE_DISPLAY         1
+#define MODE_FUNCTION        2
+
+// bus transfers per byte.
+#if (LCD_DATA_LENGTH == DATA_LENGTH_4_BITS)
+  #define BUS_CYCLES_PER_BYTE  2
+#else
+  #define BUS_CYCLES_PER_BYTE  1
+#endif
+
+//
+// CPU cycles taken by one read of the busy flag, counted towards the busy 
+// timeout. This is the bus waits only, so the real time is a little longer.
+//
+#define CYCLES_BUSY_READ     (BUS_CYCLES_PER_BYTE * (CYCLES_ADDR_SETUP       \
+                              + CYCLES_DATA_DELAY + CYCLES_ENABLE_CYCLE))
+
+// lcd_t.warmMagic once lcd_init() has completed.
+#define WARM_MAGIC           0x4C43
+
+
+
+/*
+ ******************************************************************************
+ *                                 "PRIVATE" DATA
+ ******************************************************************************
+ */
+
+//
+// Instruction execution times in microseconds. The table is indexed by the 
+// position of the instruction bit, i.e. the highest bit set in an 
+// instruction byte, which is how the instruction constants in LCD_BASE.H are
+// defined.
+//
+const uint16_t pvt_execTimeUs[8] =
+{
+  EXEC_LONG_US,                                    // CLEAR_DISPLAY
+  EXEC_LONG_US,                                    // RETURN_HOME
+  EXEC_SHORT_US,                                   // ENTRY_MODE_SET
+  EXEC_SHORT_US,                                   // DISPLAY_CTRL
+  EXEC_SHORT_US,                                   // CURSOR_DISPLAY_SHIFT
+  EXEC_SHORT_US,                                   // FUNCTION_SET
+  EXEC_SHORT_US,                                   // SET_CGRAM_ADDR
+  EXEC_SHORT_US                                    // SET_DDRAM_ADDR
+};
+
 /*
  ******************************************************************************
  *                            "PRIVATE" FUNCTION
@@ -24,19 +85,199 @@
 
 //
 // Called by all of the data port instruction functions to ensure the LCD's
-// controller is not busy and to set the control port to 'write mode' and
-// ensure the 'data register' has been selected.
+// controller is not busy. The transport selects the register when the 
+// instruction is sent.
 //
-void pvt_instrPreset (void)
+void pvt_instrPreset (lcd_t * lcd)
 {
   // ensure busy flag not set before proceeding
-  lcd_waitClearBusy();
+  lcd_waitClearBusy (lcd);
+}
 
-  // Set ctrl port pins
-  DATA_REG_SELECT;
-  WRITE_MODE;
+//
+// Records the execution time, in microseconds, of the byte just sent. This is
+// what lcd_waitClearBusy() waits out in builds that do not poll the busy 
+// flag. With LCD_DEADLINE the time is kept as a deadline on LCD_TIMER, so any
+// work done by the application before the next transfer counts towards it.
+//
+void pvt_execStart (lcd_t * lcd, uint16_t us)
+{
+#if defined (LCD_DEADLINE)
+  lcd->execBegin = LCD_TIMER_NOW;
+  lcd->execTicks = US_TO_TICKS (us);
+#elif defined (LCD_WRITE_ONLY)
+  lcd->pendingUs = us;
+#else
+  (void)us;
+#endif
 }
 
+//
+// Moves the shadow address counter one position in the given direction, 
+// following the controller's wrap-around rules. In 2-line mode, DDRAM is two
+// 40 byte lines at 0x00-0x27 and 0x40-0x67. In 1-line mode it is one 80 byte
+// line at 0x00-0x4F. CGRAM addresses are 6 bits.
+//
+void pvt_stepAddr (lcd_t * lcd, uint8_t increment)
+{
+  uint8_t ac = lcd->ac;
+
+  if (lcd->acCGRAM)
+    ac = (increment ? ac + 1 : ac - 1) & 0x3F;
+  else if (lcd->function & TWO_LINES)
+  {
+    if (increment)
+      ac = (ac == 0x27) ? 0x40 : (ac == 0x67) ? 0x00 : ac + 1;
+    else
+      ac = (ac == 0x40) ? 0x27 : (ac == 0x00) ? 0x67 : ac - 1;
+  }
+  else
+  {
+    if (increment)
+      ac = (ac == 0x4F) ? 0x00 : ac + 1;
+    else
+      ac = (ac == 0x00) ? 0x4F : ac - 1;
+  }
+
+  lcd->ac = ac;
+}
+
+//
+// Updates the shadow controller state according to an instruction that has
+// just been sent. Instructions are tested from the highest instruction bit
+// down, as the lower bits of an instruction byte are its settings.
+//
+void pvt_trackInstr (lcd_t * lcd, uint8_t inst)
+{
+  if (inst & SET_DDRAM_ADDR)
+  {
+    lcd->ac = inst & ADDRESS_MASK;
+    lcd->acCGRAM = 0;
+  }
+  else if (inst & SET_CGRAM_ADDR)
+  {
+    lcd->ac = inst & (SET_CGRAM_ADDR - 1);
+    lcd->acCGRAM = 1;
+  }
+  else if (inst & FUNCTION_SET)
+  {
+    lcd->function = inst & (FUNCTION_SET - 1);
+    lcd->modesKnown |= 1 << MODE_FUNCTION;
+  }
+  else if (inst & CURSOR_DISPLAY_SHIFT)
+  {
+    // a display shift does not change the address counter.
+    if (!(inst & DISPLAY_SHIFT))
+      pvt_stepAddr (lcd, inst & RIGHT_SHIFT);
+  }
+  else if (inst & DISPLAY_CTRL)
+  {
+    // does not affect the address counter.
+    lcd->display = inst & (DISPLAY_CTRL - 1);
+    lcd->modesKnown |= 1 << MODE_DISPLAY;
+  }
+  else if (inst & ENTRY_MODE_SET)
+  {
+    lcd->entryMode = inst & (ENTRY_MODE_SET - 1);
+    lcd->modesKnown |= 1 << MODE_ENTRY;
+  }
+  else if (inst & (RETURN_HOME | CLEAR_DISPLAY))
+  {
+    lcd->ac = 0;
+    lcd->acCGRAM = 0;
+
+    // clearing the display also sets the entry mode to increment.
+    if (inst & CLEAR_DISPLAY)
+    {
+      lcd->entryMode |= INCREMENT;
+    }
+  }
+}
+
+//
+// Returns 1, and counts the skip, if the mode register is known to already
+// hold setting, in which case the instruction does not need to be sent.
+//
+uint8_t pvt_modeUnchanged (lcd_t * lcd, uint8_t mode, uint8_t cached,
+                           uint8_t setting)
+{
+  if ((lcd->modesKnown & (1 << mode)) && cached == setting)
+  {
+    lcd->modeSkips[mode]++;
+    return 1;
+  }
+  return 0;
+}
+
+#ifdef LCD_MULTI_INSTANCE
+//
+// As pvt_modeUnchanged(), for any instruction. Only the mode instructions 
+// can be found unchanged. As in pvt_trackInstr(), the instruction bits are
+// tested from the highest down.
+//
+uint8_t pvt_instrUnchanged (lcd_t * lcd, uint8_t inst)
+{
+  if (inst & (SET_DDRAM_ADDR | SET_CGRAM_ADDR))
+    return 0;
+  if (inst & FUNCTION_SET)
+    return pvt_modeUnchanged (lcd, MODE_FUNCTION, lcd->function, 
+                              inst & (FUNCTION_SET - 1));
+  if (inst & CURSOR_DISPLAY_SHIFT)
+    return 0;
+  if (inst & DISPLAY_CTRL)
+    return pvt_modeUnchanged (lcd, MODE_DISPLAY, lcd->display, 
+                              inst & (DISPLAY_CTRL - 1));
+  if (inst & ENTRY_MODE_SET)
+    return pvt_modeUnchanged (lcd, MODE_ENTRY, lcd->entryMode, 
+                              inst & (ENTRY_MODE_SET - 1));
+  return 0;
+}
+#endif // LCD_MULTI_INSTANCE
+
+#ifndef LCD_WRITE_ONLY
+
+//
+// Polls the busy flag, starting immediately and backing off between reads 
+// according to BUSY_BACKOFF, until it is clear or BUSY_TIMEOUT_US has passed.
+// The time elapsed is counted in CPU cycles. Returns the time waited in 
+// microseconds, or BUSY_WAIT_TIMEOUT.
+//
+uint16_t pvt_pollBusy (lcd_t * lcd)
+{
+  uint32_t cycles = 0;
+#if (BUSY_BACKOFF == BACKOFF_EXPONENTIAL)
+  uint8_t  step = BUSY_POLL_FIRST_US;
+#else
+  uint8_t  step = BUSY_POLL_INTERVAL_US;
+#endif
+
+  while (1)
+  {
+    STATS_INC (busyPolls);
+    if ( !(lcd_readBusyAndAddr (lcd) & BUSY_MASK))
+      return cycles / CYCLES_PER_US;
+
+    // delay between reads, in microsecond steps.
+    for (uint8_t us = step; us > 0; us--)
+      _delay_us (1);
+
+    cycles += CYCLES_BUSY_READ + (uint32_t)step * CYCLES_PER_US;
+    if (cycles >= BUSY_TIMEOUT_CYCLES)
+      break;
+
+#if (BUSY_BACKOFF == BACKOFF_EXPONENTIAL)
+    step = (step > BUSY_POLL_INTERVAL_US / 2) ? BUSY_POLL_INTERVAL_US 
+                                              : step * 2;
+#endif
+  }
+
+  // busy flag NOT cleared
+  STATS_INC (busyTimeouts);
+  return BUSY_WAIT_TIMEOUT;
+}
+
+#endif // LCD_WRITE_ONLY
+
 
 /*
  ******************************************************************************
@@ -44,48 +285,271 @@ void pvt_instrPreset (void)
  ******************************************************************************
  */
 
+#ifdef LCD_MULTI_INSTANCE
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                             CONFIGURE AN LCD
+ * 
+ * Description : Sets the ports, pins and geometry of an LCD in its lcd_t. 
+ *               This must be done before any other function is called with 
+ *               the lcd_t, and does not access the LCD. The direction and pin
+ *               registers of each port are those at the addresses below its
+ *               PORT register, as on the ATmega1280.
+ * 
+ * Arguments   : lcd          the LCD.
+ *               dataPort     data port, e.g. &PORTA.
+ *               ctrlPort     control port, e.g. &PORTC.
+ *               rs, rw, en   control port pins, e.g. PC0. rw is not used 
+ *                            with LCD_WRITE_ONLY.
+ *               rows         number of display lines, 1 to 4.
+ *               cols         characters per line, 1 to 40.
+ * 
+ * Returns     : LCD Error code. INVALID_ARG if rows or cols is out of range
+ *               or a pin is not 0 to 7. Otherwise LCD_INSTR_SUCCESS.
+ * 
+ * Notes       : Lines 3 and 4 are taken to continue lines 1 and 2 in DDRAM,
+ *               as on the HD44780 20x4 and 16x4 modules.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_config (lcd_t * lcd, volatile uint8_t * dataPort, 
+                    volatile uint8_t * ctrlPort, uint8_t rs, uint8_t rw, 
+                    uint8_t en, uint8_t rows, uint8_t cols)
+{
+  if (rows < 1 || rows > 4 || cols < 1 || cols > 40 
+      || rs > 7 || rw > 7 || en > 7)
+    return INVALID_ARG;
+
+  // PINx, DDRx and PORTx are consecutive.
+  lcd->dataPort = dataPort;
+  lcd->dataDdr  = dataPort - 1;
+  lcd->dataPin  = dataPort - 2;
+  lcd->ctrlPort = ctrlPort;
+  lcd->ctrlDdr  = ctrlPort - 1;
+  lcd->rsMask   = 1 << rs;
+  lcd->rwMask   = 1 << rw;
+  lcd->enMask   = 1 << en;
+
+  // lines 1 and 2 start each DDRAM line, and 3 and 4 follow them.
+  lcd->rows = rows;
+  lcd->cols = cols;
+  for (uint8_t row = 0; row < 4; row++)
+    lcd->rowAddr[row] = ((row & 1) ? 0x40 : 0x00) + ((row & 2) ? cols : 0);
+
+  return LCD_INSTR_SUCCESS;
+}
+
+#endif // LCD_MULTI_INSTANCE
+
+
+#ifdef LCD_BUS_RUNTIME
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                           SELECT A TRANSPORT
+ * 
+ * Description : Sets the transport used for an LCD, from those built (see 
+ *               LCD_BUS.H). This must be done after every reset of the MCU,
+ *               before lcd_init() or lcd_warmInit() is called with the 
+ *               lcd_t, and does not access the LCD.
+ * 
+ * Arguments   : lcd     the LCD.
+ *               bus     operation table of the transport, e.g. &lcd_busPar,
+ *                       or LCD_BUS_DEFAULT.
+ * 
+ * Returns     : void
+ * 
+ * Notes       : Requires LCD_BUS_RUNTIME. LCD_TWI and LCD_SPI each drive a
+ *               single LCD.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_setBus (lcd_t * lcd, const lcd_bus_t * bus)
+{
+  lcd->bus = bus;
+}
+
+#endif // LCD_BUS_RUNTIME
+
+
 /* 
   * ---------------------------------------------------------------------------
   *                                                          INITIALIZE THE LCD
   * 
-  * Description : The 'Initializing by Instruction' routine - 8-bit mode 
-  *               version. This must be executed if the power supply conditions
-  *               for operating the internal reset circuit are not met when 
-  *               powering up.
+  * Description : The 'Initializing by Instruction' routine. The 8-bit or 4-bit
+  *               version is used depending on LCD_DATA_LENGTH. This must be 
+  *               executed if the power supply conditions for operating the 
+  *               internal reset circuit are not met when powering up.
   * 
-  * Arguments   : void
+  * Arguments   : lcd     the LCD.
   * 
   * Returns     : void
   * ---------------------------------------------------------------------------
   */
 
-void lcd_init (void)
+void lcd_init (lcd_t * lcd)
 {
-  // ensure enable is low
-  ENABLE_LO;
-  
-  // Set Data and Control port data direction to output 
-  DATA_DDR = DDR_OUTPUT;
-  CTRL_DDR = DDR_OUTPUT;
-
-  // Set ctrl port pins to necessary values
-  DATA_REG_SELECT;
-  WRITE_MODE;
+  // the controller's mode registers are unknown until they are set below,
+  // and lcd_warmInit() must not trust them if this does not complete. The
+  // rest of lcd_t may not have been initialized, see LCD_NOINIT.
+  lcd->warmMagic  = 0;
+  lcd->modesKnown = 0;
+  lcd->modeSkips[MODE_ENTRY] = 0;
+  lcd->modeSkips[MODE_DISPLAY] = 0;
+  lcd->modeSkips[MODE_FUNCTION] = 0;
+  lcd->fill = NULL;
+  pvt_execStart (lcd, 0);
+
+#ifdef LCD_DEADLINE
+  lcd_timerInit();
+#endif
+
+  BUS_INIT (lcd);
 
-  // Busy flag should not be checked until after these
-  // three FUNCTION_SET instructions have been sent.
+  //
+  // Busy flag should not be checked until after these three FUNCTION_SET 
+  // instructions have been sent. In 4-bit mode only the upper nibble of each
+  // is sent, as the controller still operates in 8-bit mode at this point,
+  // and is then followed by the upper nibble of a 4-bit FUNCTION_SET, which 
+  // switches the controller to 4-bit mode.
+  //
+#if (LCD_DATA_LENGTH == DATA_LENGTH_4_BITS)
+  _delay_ms(16);
+  BUS_WRITE_NIBBLE (lcd, (FUNCTION_SET | DATA_LENGTH_8_BITS) >> 4);
+  _delay_ms(5);
+  BUS_WRITE_NIBBLE (lcd, (FUNCTION_SET | DATA_LENGTH_8_BITS) >> 4);
+  _delay_ms(1);
+  BUS_WRITE_NIBBLE (lcd, (FUNCTION_SET | DATA_LENGTH_8_BITS) >> 4);
+  _delay_us(EXEC_SHORT_US);
+  BUS_WRITE_NIBBLE (lcd, (FUNCTION_SET | DATA_LENGTH_4_BITS) >> 4);
+  _delay_us(EXEC_SHORT_US);
+#else
   _delay_ms(16);
-  lcd_sendInstruction (FUNCTION_SET | DATA_LENGTH_8_BITS);
+  lcd_sendInstruction (lcd, FUNCTION_SET | DATA_LENGTH_8_BITS);
   _delay_ms(5);
-  lcd_sendInstruction (FUNCTION_SET | DATA_LENGTH_8_BITS);
+  lcd_sendInstruction (lcd, FUNCTION_SET | DATA_LENGTH_8_BITS);
   _delay_ms(1);
-  lcd_sendInstruction (FUNCTION_SET | DATA_LENGTH_8_BITS);
+  lcd_sendInstruction (lcd, FUNCTION_SET | DATA_LENGTH_8_BITS);
+#endif
 
   // Busy flag can be checked, so now the instruction functions can be used.
-  lcd_functionSet (DATA_LENGTH_8_BITS | TWO_LINES | FONT_5x8);
-  lcd_displayCtrl (DISPLAY_OFF | CURSOR_OFF | BLINKING_OFF);
-  lcd_clearDisplay();
-  lcd_entryModeSet (INCREMENT);  
+  lcd_functionSet (lcd, LCD_DATA_LENGTH | TWO_LINES | FONT_5x8);
+  lcd_displayCtrl (lcd, DISPLAY_OFF | CURSOR_OFF | BLINKING_OFF);
+  lcd_clearDisplay (lcd);
+  lcd_entryModeSet (lcd, INCREMENT);  
+
+  lcd->warmMagic = WARM_MAGIC;
+}
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                      WARM RESTART OF THE LCD
+ * 
+ * Description : For use in place of lcd_init() after a watchdog or soft reset
+ *               of the MCU, when the LCD is likely to still be powered and
+ *               configured. If lcd_init() has completed since the MCU last 
+ *               lost power, and the controller responds with the busy flag
+ *               clear and a DDRAM address in the address counter, only the 
+ *               FUNCTION_SET, DISPLAY_CTRL and ENTRY_MODE_SET settings last
+ *               sent are sent again. The display is not cleared and the 
+ *               address counter is read back from the controller. Otherwise 
+ *               lcd_init() is called.
+ * 
+ * Arguments   : lcd     the LCD.
+ * 
+ * Returns     : WARM_INIT if the LCD was restarted without lcd_init(), else
+ *               COLD_INIT.
+ * 
+ * Notes       : In 4-bit mode the reset may have come between the nibbles of
+ *               a transfer, so the 4-bit switch sequence of lcd_init() is 
+ *               sent first, without the power-on delays. This may complete
+ *               the interrupted instruction. With LCD_WRITE_ONLY the
+ *               controller cannot be checked and is assumed to be configured,
+ *               and the address counter is set to 0. The display shift is
+ *               not restored. The lcd_t must be in .noinit (LCD_NOINIT),
+ *               otherwise lcd_init() is always called.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_warmInit (lcd_t * lcd)
+{
+  uint8_t entry    = lcd->entryMode;
+  uint8_t display  = lcd->display;
+  uint8_t function = lcd->function;
+
+  // the saved settings must be ones this build could have sent.
+  if (lcd->warmMagic != WARM_MAGIC
+      || (entry & ~(INCREMENT | DISPLAY_SHIFT_DATA))
+      || (display & ~(DISPLAY_ON | CURSOR_ON | BLINKING_ON))
+      || (function & ~(DATA_LENGTH_8_BITS | TWO_LINES | FONT_5x10))
+      || (function & DATA_LENGTH_8_BITS) != LCD_DATA_LENGTH)
+  {
+    lcd_init (lcd);
+    return COLD_INIT;
+  }
+
+#ifdef LCD_DEADLINE
+  lcd_timerInit();
+#endif
+
+  // the framebuffer registered with LCD_MOVE did not survive the reset.
+  lcd->fill = NULL;
+  pvt_execStart (lcd, 0);
+  BUS_INIT (lcd);
+
+#if (LCD_DATA_LENGTH == DATA_LENGTH_4_BITS)
+  //
+  // Let any instruction in progress at the reset finish, then resynchronize
+  // the nibbles. From either phase these leave the controller in 4-bit mode
+  // expecting a high nibble. The first nibble may complete an instruction.
+  //
+  _delay_us (EXEC_LONG_US);
+  BUS_WRITE_NIBBLE (lcd, (FUNCTION_SET | DATA_LENGTH_8_BITS) >> 4);
+  _delay_us (EXEC_LONG_US);
+  BUS_WRITE_NIBBLE (lcd, (FUNCTION_SET | DATA_LENGTH_8_BITS) >> 4);
+  _delay_us (EXEC_SHORT_US);
+  BUS_WRITE_NIBBLE (lcd, (FUNCTION_SET | DATA_LENGTH_8_BITS) >> 4);
+  _delay_us (EXEC_SHORT_US);
+  BUS_WRITE_NIBBLE (lcd, (FUNCTION_SET | DATA_LENGTH_4_BITS) >> 4);
+  _delay_us (EXEC_SHORT_US);
+#endif
+
+#ifdef LCD_WRITE_ONLY
+  // allow for an instruction in progress at the reset.
+  pvt_execStart (lcd, EXEC_LONG_US);
+  lcd->ac = 0;
+#else
+  uint8_t addr;
+
+  // the busy flag is polled even with LCD_DEADLINE, as it shows whether the
+  // controller responds.
+  if (pvt_pollBusy (lcd) == BUSY_WAIT_TIMEOUT)
+  {
+    lcd_init (lcd);
+    return COLD_INIT;
+  }
+
+  // the address counter must be within the DDRAM for the line mode.
+  addr = lcd_readBusyAndAddr (lcd) & ADDRESS_MASK;
+  if ((function & TWO_LINES) ? (addr > 0x27 && addr < 0x40) || addr > 0x67
+                             : addr > 0x4F)
+  {
+    lcd_init (lcd);
+    return COLD_INIT;
+  }
+  lcd->ac = addr;
+#endif // LCD_WRITE_ONLY
+
+  lcd->acCGRAM = 0;
+  lcd_resyncModes (lcd);
+
+#ifdef LCD_WRITE_ONLY
+  lcd_setAddrDDRAM (lcd, 0);
+#endif
+
+  return WARM_INIT;
 }
 
 
@@ -98,16 +562,16 @@ void lcd_init (void)
  * Description : Clears the display and sets DDRAM address to 0 in the address 
  *               counter.
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : void
  * ----------------------------------------------------------------------------
  */
 
-void lcd_clearDisplay (void)
+void lcd_clearDisplay (lcd_t * lcd)
 {
-  pvt_instrPreset();
-  lcd_sendInstruction (CLEAR_DISPLAY);
+  pvt_instrPreset (lcd);
+  lcd_sendInstruction (lcd, CLEAR_DISPLAY);
 }
 
 
@@ -118,16 +582,16 @@ void lcd_clearDisplay (void)
  * Description : Sets DDRAM address to 0 in the address counter, returning the 
  *               dispaly cursor to the 0 position. Display is not changed.
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : void
  * ----------------------------------------------------------------------------
  */
 
-void lcd_returnHome (void)
+void lcd_returnHome (lcd_t * lcd)
 {
-  pvt_instrPreset();
-  lcd_sendInstruction (RETURN_HOME);
+  pvt_instrPreset (lcd);
+  lcd_sendInstruction (lcd, RETURN_HOME);
 }
 
 
@@ -139,7 +603,8 @@ void lcd_returnHome (void)
  *               the cursor moves and specifies whether the display will shift.
  *               These will be performed during data writes and reads.
  * 
- * Argument    : setting     The settings of the instruction-specific bits to 
+ * Arguments   : lcd         the LCD.
+ *               setting     The settings of the instruction-specific bits to 
  *                           send with the ENTRY_MODE_SET instruction. The 
  *                           available settings are listed below. The setting
  *                           flags should be OR'd.
@@ -155,16 +620,22 @@ void lcd_returnHome (void)
  * Returns     : LCD Error code. INVALID_ARG will be returned if the value of 
  *               settings value is >= ENTRY_MODE_SET. Otherwise 
  *               LCD_INSTR_SUCCESS is returned.
+ * 
+ * Notes       : The instruction is not sent if the setting matches the value
+ *               last sent (see lcd_resyncModes()).
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_entryModeSet (uint8_t setting)
+uint8_t lcd_entryModeSet (lcd_t * lcd, uint8_t setting)
 {
   if (setting >= ENTRY_MODE_SET)
     return INVALID_ARG;
 
-  pvt_instrPreset();
-  lcd_sendInstruction (ENTRY_MODE_SET | setting);
+  if (pvt_modeUnchanged (lcd, MODE_ENTRY, lcd->entryMode, setting))
+    return LCD_INSTR_SUCCESS;
+
+  pvt_instrPreset (lcd);
+  lcd_sendInstruction (lcd, ENTRY_MODE_SET | setting);
   return LCD_INSTR_SUCCESS;
 }
 
@@ -177,7 +648,8 @@ uint8_t lcd_entryModeSet (uint8_t setting)
  *               used to turn the display ON or OFF, to turn the cursor ON or 
  *               OFF, and to specify whether cursor blinking will be ON or OFF.
  * 
- * Argument    : setting     The settings of the instruction-specific bits to 
+ * Arguments   : lcd         the LCD.
+ *               setting     The settings of the instruction-specific bits to 
  *                           send with the DISPLAY_CTRL instruction. The 
  *                           available settings are listed below. The setting
  *                           flags should be OR'd.
@@ -194,17 +666,23 @@ uint8_t lcd_entryModeSet (uint8_t setting)
  * Returns     : LCD Error code. INVALID_ARG will be returned if the value of 
  *               settings value is >= DISPLAY_CTRL. Otherwise LCD_INSTR_SUCCESS
  *               is returned.
+ * 
+ * Notes       : The instruction is not sent if the setting matches the value
+ *               last sent (see lcd_resyncModes()).
  * ----------------------------------------------------------------------------
  */
 
 uint8_t
-lcd_displayCtrl (uint8_t setting)
+lcd_displayCtrl (lcd_t * lcd, uint8_t setting)
 {
   if (setting >= DISPLAY_CTRL)
     return INVALID_ARG;
 
-  pvt_instrPreset();
-  lcd_sendInstruction (DISPLAY_CTRL | setting);
+  if (pvt_modeUnchanged (lcd, MODE_DISPLAY, lcd->display, setting))
+    return LCD_INSTR_SUCCESS;
+
+  pvt_instrPreset (lcd);
+  lcd_sendInstruction (lcd, DISPLAY_CTRL | setting);
   return LCD_INSTR_SUCCESS;
 }
 
@@ -219,7 +697,8 @@ lcd_displayCtrl (uint8_t setting)
  *               display, and it does not matter what the ENTRY_MODE_SET 
  *               settings are.
  * 
- * Argument    : setting     The settings of the instruction-specific bits to 
+ * Arguments   : lcd         the LCD.
+ *               setting     The settings of the instruction-specific bits to 
  *                           send with the CURSOR_DISPLAY_SHIFT instruction.
  *                           The available settings are listed below. The
  *                           setting flags should be OR'd.
@@ -236,13 +715,13 @@ lcd_displayCtrl (uint8_t setting)
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_cursorDisplayShift (uint8_t setting)
+uint8_t lcd_cursorDisplayShift (lcd_t * lcd, uint8_t setting)
 {
   if (setting >= CURSOR_DISPLAY_SHIFT)
     return INVALID_ARG;
 
-  pvt_instrPreset();
-  lcd_sendInstruction (CURSOR_DISPLAY_SHIFT | setting);
+  pvt_instrPreset (lcd);
+  lcd_sendInstruction (lcd, CURSOR_DISPLAY_SHIFT | setting);
   return LCD_INSTR_SUCCESS;
 }
 
@@ -255,7 +734,8 @@ uint8_t lcd_cursorDisplayShift (uint8_t setting)
  *               data length (4 or 8 bits), to set the number of display lines,
  *               and set the character font.
  * 
- * Argument    : setting     The settings of the instruction-specific bits to 
+ * Arguments   : lcd         the LCD.
+ *               setting     The settings of the instruction-specific bits to 
  *                           send with the FUNCTION_SET instruction. The 
  *                           available settings are listed below. The setting
  *                           flags should be OR'd.
@@ -270,18 +750,29 @@ uint8_t lcd_cursorDisplayShift (uint8_t setting)
  *               FONT_5x8                
  * 
  * Returns     : LCD Error code. INVALID_ARG will be returned if the value of 
- *               settings value is >= FUNCTION_SET. Otherwise LCD_INSTR_SUCCESS
- *               is returned.
+ *               settings value is >= FUNCTION_SET, or if the data length does
+ *               not match LCD_DATA_LENGTH. Otherwise LCD_INSTR_SUCCESS is 
+ *               returned.
+ * 
+ * Notes       : The instruction is not sent if the setting matches the value
+ *               last sent (see lcd_resyncModes()).
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_functionSet (uint8_t setting)
+uint8_t lcd_functionSet (lcd_t * lcd, uint8_t setting)
 {
   if (setting >= FUNCTION_SET)
     return INVALID_ARG;
 
-  pvt_instrPreset();
-  lcd_sendInstruction (FUNCTION_SET | setting);
+  // changing the data length would desynchronize the bus.
+  if ((setting & DATA_LENGTH_8_BITS) != LCD_DATA_LENGTH)
+    return INVALID_ARG;
+
+  if (pvt_modeUnchanged (lcd, MODE_FUNCTION, lcd->function, setting))
+    return LCD_INSTR_SUCCESS;
+
+  pvt_instrPreset (lcd);
+  lcd_sendInstruction (lcd, FUNCTION_SET | setting);
   return LCD_INSTR_SUCCESS;
 }
 
@@ -294,7 +785,8 @@ uint8_t lcd_functionSet (uint8_t setting)
  *               of the Character Generator RAM. CGRAM data is sent and 
  *               received after sending this instruction.
  * 
- * Argument    : acg     byte specifying the address the CGRAM pointer will 
+ * Arguments   : lcd     the LCD.
+ *               acg     byte specifying the address the CGRAM pointer will 
  *                       point to. The lowest 6 bits in the acg argument are
  *                       the address.
  * 
@@ -304,13 +796,13 @@ uint8_t lcd_functionSet (uint8_t setting)
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_setAddrCGRAM (uint8_t acg)
+uint8_t lcd_setAddrCGRAM (lcd_t * lcd, uint8_t acg)
 {
   if (acg >= SET_CGRAM_ADDR)
     return INVALID_ARG;
 
-  pvt_instrPreset();
-  lcd_sendInstruction (SET_CGRAM_ADDR | acg);
+  pvt_instrPreset (lcd);
+  lcd_sendInstruction (lcd, SET_CGRAM_ADDR | acg);
   return LCD_INSTR_SUCCESS;
 }
 
@@ -323,7 +815,8 @@ uint8_t lcd_setAddrCGRAM (uint8_t acg)
  *               of the Display Data RAM. DDRAM data is sent and received after
  *               sending this instruction.
  *  
- * Argument    : add     byte specifying the address the DDRAM pointer will 
+ * Arguments   : lcd     the LCD.
+ *               add     byte specifying the address the DDRAM pointer will 
  *                       point to. The lowest 7 bits in the add argument are
  *                       the address.
  *
@@ -333,26 +826,28 @@ uint8_t lcd_setAddrCGRAM (uint8_t acg)
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_setAddrDDRAM (uint8_t add)
+uint8_t lcd_setAddrDDRAM (lcd_t * lcd, uint8_t add)
 {
   if (add >= SET_DDRAM_ADDR)
     return INVALID_ARG;
 
-  pvt_instrPreset();
-  lcd_sendInstruction (SET_DDRAM_ADDR | add);
+  pvt_instrPreset (lcd);
+  lcd_sendInstruction (lcd, SET_DDRAM_ADDR | add);
   return LCD_INSTR_SUCCESS;
 }
 
 
 // *****************   LCD Control Port Instruction Functions   ***************
 
+#ifndef LCD_WRITE_ONLY
+
 /* 
  * ----------------------------------------------------------------------------
  *                                                   READ BUSY FLAG and ADDRESS
  * 
  * Description : Reads & returns the busy flag setting and the address counter.
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : Byte
  *               [0:6] = The current value in the address counter.
@@ -360,35 +855,20 @@ uint8_t lcd_setAddrDDRAM (uint8_t add)
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_readBusyAndAddr (void)
+uint8_t lcd_readBusyAndAddr (lcd_t * lcd)
 {
   uint8_t busy_addr;       
 
-  // data pins set to input
-  DATA_DDR = DDR_INPUT;
-
-  //
-  // Set control port pins. For control port instructions, these settings
-  // are the instruction which is "sent" when the ENABLE pin goes high.  
-  //
-  DATA_REG_SELECT;
-  READ_MODE;
-
-  // "send" control port instruction
-  ENABLE_HI;
-
-  // wait then read pin values
-  _delay_ms(1);
-  busy_addr = DATA_PIN;
-  _delay_ms(1);
-
-  // reset data pins back to output before exiting
-  DATA_DDR = DDR_OUTPUT;
+  // "send" control port instruction and read the pin values
+  busy_addr = BUS_READ_STATUS (lcd);
+  TRACE_BUS (TRACE_RW, busy_addr);
   
   // return the current busy flag and address counter
   return busy_addr;
 }
 
+#endif // LCD_WRITE_ONLY
+
 
 /* 
  * ----------------------------------------------------------------------------
@@ -399,7 +879,8 @@ uint8_t lcd_readBusyAndAddr (void)
  *               determined by the most recent "set address" instruction that 
  *               was sent (i.e. SET_DDRAM_ADDR or SET_CGRAM_ADDR).
  * 
- * Arguments   : data     data byte that will be written to the DDRAM or 
+ * Arguments   : lcd      the LCD.
+ *               data     data byte that will be written to the DDRAM or 
  *                        CGRAM at the location pointed to by the address 
  *                        counter.
  * 
@@ -407,24 +888,54 @@ uint8_t lcd_readBusyAndAddr (void)
  * ----------------------------------------------------------------------------
 */
 
-void lcd_writeData (uint8_t data)
+void lcd_writeData (lcd_t * lcd, uint8_t data)
 {
   // ensure LCD controller is not busy
-  lcd_waitClearBusy();
+  lcd_waitClearBusy (lcd);
+  lcd_sendData (lcd, data);
+}
 
-  // set control port pins
-  INSTR_REG_SELECT;
-  WRITE_MODE;
 
-  // write to data port
-  DATA_PORT = data;
-  
-  // wait and pulse enable pin to send the data to LCD.
-  _delay_ms(1);
-  lcd_pulseEnable();
+/* 
+ * ----------------------------------------------------------------------------
+ *                                            WRITE DATA BUFFER TO DDRAM or CGRAM
+ * 
+ * Description : Writes a run of data bytes to consecutive locations of the 
+ *               DDRAM or CGRAM, starting at the location pointed to by the 
+ *               address counter. This is equivalent to calling 
+ *               lcd_writeData() for each byte.
+ * 
+ * Arguments   : lcd     the LCD.
+ *               buf     pointer to the data bytes to write.
+ *               len     number of bytes to write.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_writeDataBuf (lcd_t * lcd, const uint8_t * buf, uint8_t len)
+{
+  for (uint8_t first = 1; len > 0; len--, buf++, first = 0)
+  {
+    // ensure LCD controller is not busy
+    lcd_waitClearBusy (lcd);
+
+    // the data register is only selected for the first byte of the run.
+    if (first)
+      BUS_WRITE_DATA (lcd, *buf);
+    else
+      BUS_WRITE_DATA_NEXT (lcd, *buf);
+    TRACE_BUS (TRACE_RS, *buf);
+    STATS_INC (dataWrites);
+    pvt_stepAddr (lcd, lcd->entryMode & INCREMENT);
+
+    pvt_execStart (lcd, EXEC_DATA_US);
+  }
 }
 
 
+#ifndef LCD_WRITE_ONLY
+
 /* 
  * ----------------------------------------------------------------------------
  *                                                READ DATA FROM DDRAM or CGRAM
@@ -434,45 +945,32 @@ void lcd_writeData (uint8_t data)
  *               determined by the most recent "set address" instruction that 
  *               was sent (i.e. SET_DDRAM_ADDR or SET_CGRAM_ADDR).
  * 
- * Arguments  : void
+ * Arguments  : lcd     the LCD.
  * 
  * Returns    : byte in either CGRAM or DDRAM at the address pointed at by
  *              the address counter.
  * ----------------------------------------------------------------------------
  */
 
-uint8_t lcd_readData (void)
+uint8_t lcd_readData (lcd_t * lcd)
 {
   uint8_t data;
 
   // ensure LCD controller is not busy
-  lcd_waitClearBusy();
+  lcd_waitClearBusy (lcd);
 
-  DATA_DDR = DDR_INPUT;
-
-  //
-  // Set control port pins. For control port instructions, these settings
-  // are the instruction which is "sent" when the ENABLE pin goes high.  
-  //
-  INSTR_REG_SELECT;
-  READ_MODE;
-
-  // 'send' the instruction
-  _delay_ms(5);
-  ENABLE_HI;
-
-  // wait and read in pin values
-  _delay_ms(1);
-  data = DATA_PIN;
-  _delay_ms(1);
-
-  // set data pins back to output before exiting
-  DATA_DDR = DDR_OUTPUT;
+  // 'send' the instruction and read the pin values
+  data = BUS_READ_DATA (lcd);
+  TRACE_BUS (TRACE_RS | TRACE_RW, data);
+  STATS_INC (dataReads);
+  pvt_stepAddr (lcd, lcd->entryMode & INCREMENT);
 
   // return the CGRAM or DDRAM data
   return data;
 }
 
+#endif // LCD_WRITE_ONLY
+
 
 // ************************   Some helper functions   *************************
 
@@ -482,57 +980,163 @@ uint8_t lcd_readData (void)
  * 
  * Description : Use this function to poll the busy flag. This function will
  *               return once it detects the busy flag is no longer set or 
- *               a timeout has been reached.
+ *               a timeout has been reached. The flag is read immediately 
+ *               and then after each back-off delay (BUSY_BACKOFF) for up to
+ *               BUSY_TIMEOUT_US microseconds (see LCD_TIMING.H). 
+ *               lcd_waitBusyUs() does the same, but returns the time waited.
+ * 
+ *               If LCD_WRITE_ONLY is defined the busy flag cannot be read. In
+ *               that case this function waits out whatever remains of the 
+ *               execution time of the last instruction or data write.
+ * 
+ *               If LCD_DEADLINE is defined the busy flag is not polled 
+ *               either. Instead, each transfer sets a deadline on the 
+ *               LCD_TIMER time base, its execution time after it was sent,
+ *               and this function only waits for whatever remains of it, so
+ *               work done by the application between LCD calls overlaps the
+ *               controller's execution time.
  * 
- * Arguments   : void
+ *               With LCD_WRITE_ONLY the wait is the Idle operation of the 
+ *               transport (see LCD_BUS.H). With LCD_TWI the execution time is
+ *               queued on the bus, as idle bytes ahead of the next transfer
+ *               (see LCD_TWI.H), and the CPU only waits if the queue is full.
+ *               With LCD_SPI it is waited out from when the last byte was 
+ *               latched.
+ * 
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : On of the Busy Error Flags. BUSY_RESET_SUCCESS is returned if
  *               the busy flag was found to be reset and the LCD's controller 
  *               is ready to receive the next command. BUSY_RESET_TIMEOUT if 
  *               the flag does not reset after a set timeout period.
+ * 
+ *               lcd_waitBusyUs() returns the time waited in microseconds, or
+ *               BUSY_WAIT_TIMEOUT.
  * ----------------------------------------------------------------------------
 */
 
-uint8_t lcd_waitClearBusy (void)
+uint8_t lcd_waitClearBusy (lcd_t * lcd)
 {
-  // loop to poll the DATA_PIN to and check if busy flag has cleared
-  for (uint8_t timeout = 0; timeout < 0xFE; timeout++)
-  {
-    //delay between loop iterations
-    _delay_ms(1);
-    if ( !(lcd_readBusyAndAddr() & BUSY_MASK))
-      return BUSY_RESET_SUCCESS;
-  }
-  // busy flag NOT cleared
-  return BUSY_RESET_TIMEOUT;
+  if (lcd_waitBusyUs (lcd) == BUSY_WAIT_TIMEOUT)
+    return BUSY_RESET_TIMEOUT;
+  return BUSY_RESET_SUCCESS;
+}
+
+uint16_t lcd_waitBusyUs (lcd_t * lcd)
+{
+  uint16_t us;
+  STATS_WAIT_BEGIN;
+
+#if defined (LCD_DEADLINE)
+  // wait out whatever remains of the deadline of the last byte sent.
+  us = TICKS_TO_US (lcd_deadlineLeft (lcd));
+  while ((uint16_t)(LCD_TIMER_NOW - lcd->execBegin) < lcd->execTicks)
+    ;
+  lcd->execTicks = 0;
+#elif defined (LCD_WRITE_ONLY)
+  // wait out the remaining execution time of the last byte sent, which the 
+  // transport may leave to the bus rather than the CPU.
+  us = lcd->pendingUs;
+  BUS_IDLE (lcd, us);
+  lcd->pendingUs = 0;
+#else
+  us = pvt_pollBusy (lcd);
+#endif
+
+  STATS_WAIT_END;
+  return us;
 }
 
 
+#if !defined (LCD_WRITE_ONLY) || defined (LCD_DEADLINE)
+
 /* 
  * ----------------------------------------------------------------------------
- *                                                             PULSE ENABLE PIN
+ *                                                         CHECK IF LCD IS BUSY
  * 
- * Description : Pulses the enable pin.  
+ * Description : Returns whether the controller is still executing the last
+ *               byte sent, without waiting. The busy flag is read once, or
+ *               with LCD_DEADLINE the deadline is checked.
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
- * Returns     : void
+ * Returns     : 1 if busy, else 0.
+ * 
+ * Notes       : Not available with LCD_WRITE_ONLY unless LCD_DEADLINE is
+ *               also defined, as there is then no way to tell how long ago
+ *               the last byte was sent.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_isBusy (lcd_t * lcd)
+{
+#ifdef LCD_DEADLINE
+  return lcd_deadlineLeft (lcd) ? 1 : 0;
+#else
+  return (lcd_readBusyAndAddr (lcd) & BUSY_MASK) ? 1 : 0;
+#endif
+}
+
+#endif
+
+
+#ifdef LCD_DEADLINE
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                        TIME LEFT OF DEADLINE
+ * 
+ * Description : Returns the time left until the controller has executed the
+ *               last byte sent, from the deadline on LCD_TIMER. Once it has
+ *               passed the deadline is cleared, so that it is not mistaken
+ *               for a pending one after LCD_TIMER wraps (every 65536 ticks).
+ * 
+ * Arguments   : lcd     the LCD.
  * 
- * Notes       : In order to execute an instruction the enable pin must
- *               transition from high to low. This function performs this
- *               operation by setting the enable pin high and then low. This 
- *               function should be called once all the other necessary pins 
- *               have been set according to the desired instruction and 
- *               settings.
+ * Returns     : Ticks of LCD_TIMER left, 0 if the controller is not busy.
+ * 
+ * Notes       : Requires LCD_DEADLINE.
  * ----------------------------------------------------------------------------
  */
 
-void lcd_pulseEnable (void)
+uint16_t lcd_deadlineLeft (lcd_t * lcd)
 {
-  _delay_ms(0.5);
-  ENABLE_HI;
-  _delay_ms(0.5);
-  ENABLE_LO;
+  uint16_t elapsed = LCD_TIMER_NOW - lcd->execBegin;
+
+  if (elapsed < lcd->execTicks)
+    return lcd->execTicks - elapsed;
+
+  lcd->execTicks = 0;
+  return 0;
+}
+
+#endif
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                   INSTRUCTION EXECUTION TIME
+ * 
+ * Description : Returns the documented execution time of an instruction, 
+ *               i.e. how long the busy flag remains set after the instruction
+ *               has been sent. The time is taken from a table keyed on the
+ *               instruction bit, which is the highest bit set in instr.
+ * 
+ * Arguments   : instr     instruction byte, including any settings. 
+ * 
+ * Returns     : Execution time in microseconds. For data reads and writes, 
+ *               use EXEC_DATA_US from LCD_TIMING.H instead.
+ * ----------------------------------------------------------------------------
+ */
+
+uint16_t lcd_execTime (uint8_t instr)
+{
+  // find the instruction bit.
+  uint8_t bit = 7;
+  while (bit > 0 && !(instr & (1 << bit)))
+    bit--;
+
+  return pvt_execTimeUs[bit];
 }
 
 
@@ -540,24 +1144,253 @@ void lcd_pulseEnable (void)
  * ----------------------------------------------------------------------------
  *                                                      SEND INSTRUCTION TO LCD
  * 
- * Description : This function sets the necessary port pins for executing the
- *               instructions and their settings. This function is called by 
- *               all of the data port instruction functions.
+ * Description : Sends an instruction and its settings through the transport
+ *               of the LCD, which selects the instruction register for a 
+ *               write, and updates the state tracked in the lcd_t. This 
+ *               function is called by all of the instruction functions. 
+ *               Unlike them, it does not wait for the controller to be 
+ *               ready, so the caller must ensure it is not busy. In 4-bit 
+ *               mode the high nibble is sent first, followed by the low 
+ *               nibble.
  * 
- * Arguments   : instr     instruction and settings that are to be executed by
+ * Arguments   : lcd       the LCD.
+ *               instr     instruction and settings that are to be executed by
  *                         the LCDs controller.
  * 
  * Returns     : void
  * ----------------------------------------------------------------------------
  */
 
-void lcd_sendInstruction (uint8_t inst)
+void lcd_sendInstruction (lcd_t * lcd, uint8_t inst)
+{
+  // set pins according to the instuction and settings and 'send' them.
+  BUS_WRITE_INSTR (lcd, inst);
+  TRACE_BUS (0, inst);
+  STATS_INSTR (inst);
+
+  pvt_trackInstr (lcd, inst);
+
+  pvt_execStart (lcd, lcd_execTime (inst));
+}
+
+
+#ifdef LCD_MULTI_INSTANCE
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                              BROADCAST INSTRUCTION TO 2 LCDS
+ * 
+ * Description : Sends an instruction to two controllers in one bus cycle, by
+ *               raising both of their enables together, and updates the 
+ *               state tracked in both lcd_t. Both controllers are first
+ *               allowed to finish what they are executing. A mode 
+ *               instruction (ENTRY_MODE_SET, DISPLAY_CTRL or FUNCTION_SET)
+ *               is only sent to a controller it would change, so it may be
+ *               sent to one of them alone, or not at all.
+ * 
+ * Arguments   : lcd       the LCD.
+ *               other     the second LCD. It must share the data port and 
+ *                         the RS and RW pins with lcd, as the two 
+ *                         controllers of a 40x4 module do, and have its own 
+ *                         EN pin.
+ *               inst      instruction and settings. It is not validated.
+ * 
+ * Returns     : void
+ * 
+ * Notes       : Requires LCD_MULTI_INSTANCE. Nothing is read from the LCDs
+ *               while both enables are raised.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_broadcastInstruction (lcd_t * lcd, lcd_t * other, uint8_t inst)
+{
+  uint8_t held      = pvt_instrUnchanged (lcd, inst);
+  uint8_t otherHeld = pvt_instrUnchanged (other, inst);
+  uint8_t enMask    = lcd->enMask;
+
+  // a mode instruction only needs to go to the controllers it changes.
+  if (held || otherHeld)
+  {
+    if (held && otherHeld)
+      return;
+    lcd = held ? other : lcd;
+    pvt_instrPreset (lcd);
+    lcd_sendInstruction (lcd, inst);
+    return;
+  }
+
+  lcd_waitClearBusy (other);
+  pvt_instrPreset (lcd);
+
+  // both controllers latch the instruction on the falling edge of EN.
+  lcd->enMask |= other->enMask;
+  lcd_sendInstruction (lcd, inst);
+  lcd->enMask = enMask;
+
+  pvt_trackInstr (other, inst);
+  pvt_execStart (other, lcd_execTime (inst));
+}
+
+#endif // LCD_MULTI_INSTANCE
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                       SHADOW ADDRESS COUNTER
+ * 
+ * Description : Returns the value of the address counter as tracked by the
+ *               driver from the instructions and data it has sent, without
+ *               reading the LCD. lcd_addrIsCGRAM() returns whether the
+ *               address counter points to CGRAM (1) or DDRAM (0), i.e. 
+ *               which "set address" instruction was sent most recently.
+ * 
+ * Arguments   : lcd     the LCD.
+ * 
+ * Returns     : Current value of the address counter.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_addrCounter (lcd_t * lcd)
+{
+  return lcd->ac;
+}
+
+uint8_t lcd_addrIsCGRAM (lcd_t * lcd)
+{
+  return lcd->acCGRAM;
+}
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                               DISPLAY POSITION OF AN ADDRESS
+ * 
+ * Description : Returns the display position of a DDRAM address, packed as
+ *               by LCD_ADDR_POS() of LCD_ADDR.H. The position is read from
+ *               the LCD_ADDR table in flash for the LCD_GEOMETRY profile, or
+ *               found from the lines set by lcd_config() with
+ *               LCD_MULTI_INSTANCE.
+ * 
+ * Arguments   : lcd      the LCD.
+ *               addr     DDRAM address.
+ * 
+ * Returns     : Packed position, for POS_ROW() and POS_COL(), or POS_NONE if
+ *               the address is not a visible position.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_addrToPos (lcd_t * lcd, uint8_t addr)
+{
+#ifdef LCD_MULTI_INSTANCE
+  for (uint8_t row = 0; row < lcd->rows; row++)
+  {
+    uint8_t col = addr - lcd->rowAddr[row];
+    if (col < lcd->cols)
+      return POS_AT (row, col);
+  }
+
+  return POS_NONE;
+#else
+  return LCD_ADDR_POS (addr);
+#endif // LCD_MULTI_INSTANCE
+}
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                            SHADOW ENTRY MODE
+ * 
+ * Description : Returns the ENTRY_MODE_SET settings most recently sent to the
+ *               LCD, as tracked by the driver, i.e. INCREMENT and/or 
+ *               DISPLAY_SHIFT_DATA.
+ * 
+ * Arguments   : lcd     the LCD.
+ * 
+ * Returns     : Current entry mode settings.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_entryMode (lcd_t * lcd)
+{
+  return lcd->entryMode;
+}
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                        RESYNC MODE REGISTERS
+ * 
+ * Description : The driver keeps copies of the ENTRY_MODE_SET, DISPLAY_CTRL
+ *               and FUNCTION_SET settings last sent, and lcd_entryModeSet(),
+ *               lcd_displayCtrl() and lcd_functionSet() do not send an 
+ *               instruction that would not change them. lcd_resyncModes() 
+ *               sends all three again regardless, e.g. after a power glitch
+ *               may have reset the controller. lcd_modeSkips() returns the 
+ *               number of instructions that have been skipped.
+ * 
+ * Arguments   : lcd       the LCD.
+ *               instr     ENTRY_MODE_SET, DISPLAY_CTRL or FUNCTION_SET.
+ * 
+ * Returns     : Number of skipped instructions of type instr, or 0 if instr
+ *               is not one of the above.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_resyncModes (lcd_t * lcd)
+{
+  lcd->modesKnown = 0;
+
+  pvt_instrPreset (lcd);
+  lcd_sendInstruction (lcd, FUNCTION_SET | lcd->function);
+  pvt_instrPreset (lcd);
+  lcd_sendInstruction (lcd, DISPLAY_CTRL | lcd->display);
+  pvt_instrPreset (lcd);
+  lcd_sendInstruction (lcd, ENTRY_MODE_SET | lcd->entryMode);
+}
+
+uint16_t lcd_modeSkips (lcd_t * lcd, uint8_t instr)
+{
+  switch (instr)
+  {
+    case ENTRY_MODE_SET:
+      return lcd->modeSkips[MODE_ENTRY];
+    case DISPLAY_CTRL:
+      return lcd->modeSkips[MODE_DISPLAY];
+    case FUNCTION_SET:
+      return lcd->modeSkips[MODE_FUNCTION];
+    default:
+      return 0;
+  }
+}
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                             SEND DATA TO LCD
+ * 
+ * Description : Sends the data byte to the LCD through its transport, which
+ *               selects the data register for a write. Unlike 
+ *               lcd_writeData(), this does not wait for the controller to be
+ *               ready, so the caller must ensure it is not busy.
+ * 
+ * Arguments   : lcd      the LCD.
+ *               data     data byte that will be written to the DDRAM or 
+ *                        CGRAM at the location pointed to by the address 
+ *                        counter.
+ * 
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_sendData (lcd_t * lcd, uint8_t data)
 {
-  // set pins according to the instuction and settings
-  DATA_PORT = inst;
-  _delay_ms(0.2);
-  // 'send' the instruction and settings
-  lcd_pulseEnable();
+  // select the data register and send the data to the LCD.
+  BUS_WRITE_DATA (lcd, data);
+  TRACE_BUS (TRACE_RS, data);
+  STATS_INC (dataWrites);
+  pvt_stepAddr (lcd, lcd->entryMode & INCREMENT);
+
+  pvt_execStart (lcd, EXEC_DATA_US);
 }
 
 
@@ -589,6 +1422,15 @@ void lcd_printError(uint8_t err)
     case BUSY_RESET_TIMEOUT:
       print_str("\n\rBUSY_RESET_TIMEOUT");
       break;
+    case QUEUE_FULL:
+      print_str("\n\rQUEUE_FULL");
+      break;
+    case WARM_INIT:
+      print_str("\n\rWARM_INIT");
+      break;
+    case COLD_INIT:
+      print_str("\n\rCOLD_INIT");
+      break;
     default:
       print_str("\n\rINVALID LCD ERROR");
       break;
@@ -0,0 +1,302 @@
+/*
+ * File        : LCD_DUAL.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_DUAL.H
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include "lcd_base.h"
+#include "lcd_sf.h"
+#include "lcd_dual.h"
+
+// the wiring of each controller is needed. See LCD_DUAL.H.
+#ifdef LCD_MULTI_INSTANCE
+
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTIONS
+ ******************************************************************************
+ */
+
+//
+// Sends the DISPLAY_CTRL settings of the surface to both controllers. The
+// cursor and blinking are only shown by the controller holding the cursor,
+// so the settings are only broadcast if neither is on.
+//
+void pvt_dualShowDisplay (lcd_dual_t * dual)
+{
+  lcd_t * shown  = dual->ctrl[dual->cur];
+  lcd_t * hidden = dual->ctrl[!dual->cur];
+  uint8_t plain  = dual->display & DISPLAY_ON;
+
+  if (dual->display == plain)
+    lcd_broadcastInstruction (shown, hidden, DISPLAY_CTRL | plain);
+  else
+  {
+    lcd_displayCtrl (hidden, plain);
+    lcd_displayCtrl (shown, dual->display);
+  }
+}
+
+//
+// Moves the cursor to a controller, 0 or 1. The display control settings
+// only need to be sent again if the cursor or blinking is shown.
+//
+void pvt_dualSelect (lcd_dual_t * dual, uint8_t cur)
+{
+  if (cur == dual->cur)
+    return;
+
+  dual->cur = cur;
+  if (dual->display & (CURSOR_ON | BLINKING_ON))
+    pvt_dualShowDisplay (dual);
+}
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       INITIALIZE THE SURFACE
+ *
+ * Description : Binds the two controllers to the surface and sets the
+ *               display control of both from the first, with the cursor on
+ *               the first. The controllers must each have been configured
+ *               with lcd_config() as 2-line displays of the same width and
+ *               initialized with lcd_init().
+ *
+ * Arguments   : dual       the surface.
+ *               top        controller of lines 1 and 2.
+ *               bottom     controller of lines 3 and 4.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if the controllers do not share
+ *               the data and control ports and the RS and RW pins, have the
+ *               same EN pin, or are not 2-line displays of the same width.
+ *               Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_dualInit (lcd_dual_t * dual, lcd_t * top, lcd_t * bottom)
+{
+  // the broadcast instructions need a shared bus with separate enables.
+  if (top->dataPort != bottom->dataPort || top->ctrlPort != bottom->ctrlPort
+      || top->rsMask != bottom->rsMask || top->rwMask != bottom->rwMask
+      || top->enMask == bottom->enMask)
+    return INVALID_ARG;
+
+  if (top->rows != LCD_DUAL_CTRL_ROWS || bottom->rows != LCD_DUAL_CTRL_ROWS
+      || top->cols != bottom->cols)
+    return INVALID_ARG;
+
+  dual->ctrl[0] = top;
+  dual->ctrl[1] = bottom;
+  dual->cur = 0;
+  dual->display = top->display;
+  pvt_dualShowDisplay (dual);
+
+  return LCD_INSTR_SUCCESS;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          CONTROLLER OF A ROW
+ *
+ * Description : Returns the controller that shows a row of the surface, for
+ *               calling the LCD_BASE, LCD_SF and LCD_MOVE functions on it.
+ *               Its display lines are rows 0 and 1 of the surface, or 2 and
+ *               3.
+ *
+ * Arguments   : dual     the surface.
+ *               row      row of the surface, 0 to LCD_DUAL_ROWS - 1.
+ *
+ * Returns     : The controller, or NULL if row is out of range.
+ * ----------------------------------------------------------------------------
+ */
+
+lcd_t * lcd_dualCtrl (lcd_dual_t * dual, uint8_t row)
+{
+  if (row >= LCD_DUAL_ROWS)
+    return NULL;
+
+  return dual->ctrl[row / LCD_DUAL_CTRL_ROWS];
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       BROADCAST INSTRUCTIONS
+ *
+ * Description : Carry out the instruction on the whole surface, in one bus
+ *               cycle for both controllers.
+ *
+ *               lcd_dualClear()         : clears both controllers, and moves
+ *                                         the cursor to row 0, column 0.
+ *               lcd_dualReturnHome()    : returns both controllers home, and
+ *                                         moves the cursor to row 0, column
+ *                                         0.
+ *               lcd_dualEntryModeSet()  : as lcd_entryModeSet().
+ *               lcd_dualDisplayCtrl()   : as lcd_displayCtrl(). CURSOR_ON and
+ *                                         BLINKING_ON only apply to the
+ *                                         controller holding the cursor, in
+ *                                         which case the two controllers are
+ *                                         sent different settings.
+ *
+ * Arguments   : dual        the surface.
+ *               setting     the settings of the instruction.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if the setting is not valid for
+ *               the instruction. Otherwise LCD_INSTR_SUCCESS.
+ *
+ * Notes       : As with a single controller, an entry mode or display
+ *               control setting is not sent to a controller that already
+ *               holds it.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_dualClear (lcd_dual_t * dual)
+{
+  lcd_broadcastInstruction (dual->ctrl[0], dual->ctrl[1], CLEAR_DISPLAY);
+  pvt_dualSelect (dual, 0);
+}
+
+void lcd_dualReturnHome (lcd_dual_t * dual)
+{
+  lcd_broadcastInstruction (dual->ctrl[0], dual->ctrl[1], RETURN_HOME);
+  pvt_dualSelect (dual, 0);
+}
+
+uint8_t lcd_dualEntryModeSet (lcd_dual_t * dual, uint8_t setting)
+{
+  if (setting >= ENTRY_MODE_SET)
+    return INVALID_ARG;
+
+  lcd_broadcastInstruction (dual->ctrl[0], dual->ctrl[1], 
+                            ENTRY_MODE_SET | setting);
+  return LCD_INSTR_SUCCESS;
+}
+
+uint8_t lcd_dualDisplayCtrl (lcd_dual_t * dual, uint8_t setting)
+{
+  if (setting >= DISPLAY_CTRL)
+    return INVALID_ARG;
+
+  dual->display = setting;
+  pvt_dualShowDisplay (dual);
+  return LCD_INSTR_SUCCESS;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                               GO TO POSITION
+ *
+ * Description : Sets the address counter of the controller that shows row
+ *               to the position, as lcd_gotoXY() does, and moves the cursor
+ *               to that controller.
+ *
+ * Arguments   : dual     the surface.
+ *               row      row of the surface, 0 to LCD_DUAL_ROWS - 1.
+ *               col      position in the row, 0 to the width - 1.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if row or col is out of range, in
+ *               which case nothing is sent. Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_dualGotoXY (lcd_dual_t * dual, uint8_t row, uint8_t col)
+{
+  if (row >= LCD_DUAL_ROWS)
+    return INVALID_ARG;
+
+  if (lcd_gotoXY (dual->ctrl[row / LCD_DUAL_CTRL_ROWS], 
+                  row % LCD_DUAL_CTRL_ROWS, col) == INVALID_ARG)
+    return INVALID_ARG;
+
+  pvt_dualSelect (dual, row / LCD_DUAL_CTRL_ROWS);
+  return LCD_INSTR_SUCCESS;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         WRITE TO THE SURFACE
+ *
+ * Description : lcd_dualWriteData() writes a character at the address
+ *               counter of the controller holding the cursor.
+ *
+ *               lcd_dualWriteAt() and lcd_dualWriteBufAt() write a string or
+ *               buffer from a position, continuing at the start of the next
+ *               row (0 -> 1 -> 2 -> 3 -> 0) when a row is filled, on
+ *               whichever controller shows it. Each row is written as
+ *               lcd_writeBufAt() does. The cursor is left on the controller
+ *               of the last row written.
+ *
+ * Arguments   : dual     the surface.
+ *               data     the character.
+ *               row      row of the surface, 0 to LCD_DUAL_ROWS - 1.
+ *               col      position in the row, 0 to the width - 1.
+ *               str      null-terminated string, of up to 255 characters.
+ *               buf      pointer to the characters to write.
+ *               len      number of characters in buf.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if row or col is out of range, in
+ *               which case nothing is written. Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_dualWriteData (lcd_dual_t * dual, uint8_t data)
+{
+  lcd_writeData (dual->ctrl[dual->cur], data);
+}
+
+uint8_t lcd_dualWriteAt (lcd_dual_t * dual, uint8_t row, uint8_t col,
+                         const char * str)
+{
+  uint8_t len = 0;
+  while (len < 0xFF && str[len] != '\0')
+    len++;
+
+  return lcd_dualWriteBufAt (dual, row, col, (const uint8_t *)str, len);
+}
+
+uint8_t lcd_dualWriteBufAt (lcd_dual_t * dual, uint8_t row, uint8_t col,
+                            const uint8_t * buf, uint8_t len)
+{
+  uint8_t cols = dual->ctrl[0]->cols;
+  uint8_t run;
+
+  if (row >= LCD_DUAL_ROWS || col >= cols)
+    return INVALID_ARG;
+
+  // one run per row, on the controller that shows it.
+  while (1)
+  {
+    run = (len < cols - col) ? len : cols - col;
+    lcd_writeBufAt (dual->ctrl[row / LCD_DUAL_CTRL_ROWS], 
+                    row % LCD_DUAL_CTRL_ROWS, col, buf, run);
+    pvt_dualSelect (dual, row / LCD_DUAL_CTRL_ROWS);
+    buf += run;
+    len -= run;
+
+    if (len == 0)
+      return LCD_INSTR_SUCCESS;
+
+    row = (row + 1) % LCD_DUAL_ROWS;
+    col = 0;
+  }
+}
+
+#endif // LCD_MULTI_INSTANCE
@@ -0,0 +1,320 @@
+/*
+ * File        : LCD_FB.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_FB.H
+ */
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "lcd_base.h"
+#include "lcd_addr.h"
+#include "lcd_fb.h"
+#include "lcd_move.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+#define FB_CELLS             (LCD_ROWS * LCD_COLS)
+
+// character codes 0x00-0x07 and their mirrors 0x08-0x0F display CGRAM.
+#define IS_GLYPH(c)          ((c) < 0x10)
+#define GLYPH_SLOT(c)        ((c) & 0x07)
+
+// test, set and clear the dirty bit of a cell.
+#define IS_DIRTY(cell)       (pvt_fbDirty[(cell) >> 3] &   (1 << ((cell) & 7)))
+#define SET_DIRTY(cell)      (pvt_fbDirty[(cell) >> 3] |=  (1 << ((cell) & 7)))
+#define CLEAR_DIRTY(cell)    (pvt_fbDirty[(cell) >> 3] &= ~(1 << ((cell) & 7)))
+
+
+/*
+ ******************************************************************************
+ *                                 "PRIVATE" DATA
+ ******************************************************************************
+ */
+
+uint8_t pvt_fbCells[FB_CELLS];                 // characters, row by row
+uint8_t pvt_fbDirty[(FB_CELLS + 7) / 8];       // one dirty bit per cell
+uint8_t pvt_fbGlyphRefs[8];                    // cells holding each CGRAM slot
+uint8_t pvt_fbShownRefs[8];                    // dirty cells still showing it
+lcd_t * pvt_fbLcd;                             // LCD the cells are sent to
+
+// rows in ascending order of their DDRAM address.
+const uint8_t pvt_fbRowOrder[LCD_ROWS] = LINE_ADDR_ORDER;
+
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTION
+ ******************************************************************************
+ */
+
+//
+// Marks a cell dirty. A clean cell shows its character on the display until
+// lcd_flush() writes the cell, so if that is a CGRAM slot it stays referenced
+// until then.
+//
+void pvt_fbMarkDirty (uint8_t cell)
+{
+  uint8_t old = pvt_fbCells[cell];
+
+  if (!IS_DIRTY (cell) && IS_GLYPH (old))
+    pvt_fbShownRefs[GLYPH_SLOT (old)]++;
+  SET_DIRTY (cell);
+}
+
+//
+// Sets the character of a cell and marks the cell dirty if it changed. The
+// CGRAM slot reference counts are kept up to date.
+//
+void pvt_fbSet (uint8_t cell, uint8_t c)
+{
+  uint8_t old = pvt_fbCells[cell];
+
+  if (old != c)
+  {
+    pvt_fbMarkDirty (cell);
+    if (IS_GLYPH (old))
+      pvt_fbGlyphRefs[GLYPH_SLOT (old)]--;
+    if (IS_GLYPH (c))
+      pvt_fbGlyphRefs[GLYPH_SLOT (c)]++;
+
+    pvt_fbCells[cell] = c;
+  }
+}
+
+//
+// Fill function registered with LCD_MOVE. Returns the character of the cell
+// at DDRAM address addr, which the planner will write, so the cell is marked
+// clean.
+//
+uint8_t pvt_fbFill (uint8_t addr)
+{
+  uint8_t pos = LCD_ADDR_POS (addr);
+  uint8_t cell;
+
+  if (pos == POS_NONE)
+    return ' ';
+
+  cell = POS_ROW (pos) * LCD_COLS + POS_COL (pos);
+  CLEAR_DIRTY (cell);
+  return pvt_fbCells[cell];
+}
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   INITIALIZE THE FRAMEBUFFER
+ *
+ * Description : Fills the framebuffer with spaces and marks every cell clean.
+ *               This matches the display contents after lcd_init() or
+ *               lcd_clearDisplay(), so it should be called after either. The
+ *               framebuffer is also registered with lcd_moveSetFill() so
+ *               lcd_flush() can move the cursor forward by rewriting cells.
+ *
+ * Arguments   : lcd     the LCD that lcd_flush() will send the cells to. 
+ *                       With LCD_MULTI_INSTANCE it must have LCD_ROWS lines
+ *                       of LCD_COLS characters.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_fbInit (lcd_t * lcd)
+{
+  pvt_fbLcd = lcd;
+
+  for (uint8_t cell = 0; cell < FB_CELLS; cell++)
+    pvt_fbCells[cell] = ' ';
+
+  for (uint8_t i = 0; i < sizeof pvt_fbDirty; i++)
+    pvt_fbDirty[i] = 0;
+
+  for (uint8_t slot = 0; slot < sizeof pvt_fbGlyphRefs; slot++)
+  {
+    pvt_fbGlyphRefs[slot] = 0;
+    pvt_fbShownRefs[slot] = 0;
+  }
+
+  lcd_moveSetFill (pvt_fbLcd, pvt_fbFill);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   INVALIDATE THE FRAMEBUFFER
+ *
+ * Description : Marks every cell dirty so the next lcd_flush() rewrites the
+ *               whole display, e.g. if the display contents were changed
+ *               without going through the framebuffer.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_fbInvalidate (void)
+{
+  for (uint8_t cell = 0; cell < FB_CELLS; cell++)
+    pvt_fbMarkDirty (cell);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    DRAW INTO THE FRAMEBUFFER
+ *
+ * Description : lcd_fbPutc() sets the character of a single cell.
+ *               lcd_fbPuts() sets consecutive cells of a row to the
+ *               characters of a string, stopping at the end of the row.
+ *               lcd_fbClear() sets every cell to a space. Only cells whose
+ *               character actually changes are marked dirty. Nothing is sent
+ *               to the LCD until lcd_flush() is called.
+ *
+ * Arguments   : row     display row, 0 to LCD_ROWS - 1.
+ *               col     display column, 0 to LCD_COLS - 1.
+ *               c       character to place in the cell.
+ *               str     null-terminated string to place in the row.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if row or col is out of range.
+ *               Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_fbPutc (uint8_t row, uint8_t col, uint8_t c)
+{
+  if (row >= LCD_ROWS || col >= LCD_COLS)
+    return INVALID_ARG;
+
+  pvt_fbSet (row * LCD_COLS + col, c);
+  return LCD_INSTR_SUCCESS;
+}
+
+uint8_t lcd_fbPuts (uint8_t row, uint8_t col, const char * str)
+{
+  if (row >= LCD_ROWS || col >= LCD_COLS)
+    return INVALID_ARG;
+
+  uint8_t cell = row * LCD_COLS + col;
+  for ( ; col < LCD_COLS && *str != '\0'; col++, cell++, str++)
+    pvt_fbSet (cell, *str);
+
+  return LCD_INSTR_SUCCESS;
+}
+
+void lcd_fbClear (void)
+{
+  for (uint8_t cell = 0; cell < FB_CELLS; cell++)
+    pvt_fbSet (cell, ' ');
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    READ FROM THE FRAMEBUFFER
+ *
+ * Description : Returns the character currently held by a cell of the
+ *               framebuffer.
+ *
+ * Arguments   : row     display row, 0 to LCD_ROWS - 1.
+ *               col     display column, 0 to LCD_COLS - 1.
+ *
+ * Returns     : Character in the cell, or 0 if row or col is out of range.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_fbGetc (uint8_t row, uint8_t col)
+{
+  if (row >= LCD_ROWS || col >= LCD_COLS)
+    return 0;
+
+  return pvt_fbCells[row * LCD_COLS + col];
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                        CGRAM SLOT REFERENCES
+ *
+ * Description : Returns the number of cells of the framebuffer that hold the
+ *               character code of a CGRAM slot, i.e. 0x00-0x07 or its mirror
+ *               0x08-0x0F, plus the number of cells that still show it on
+ *               the display. Used by LCD_GLYPH to avoid replacing a glyph
+ *               that is on the display, or will be after lcd_flush().
+ *
+ * Arguments   : slot     CGRAM slot, 0 to 7.
+ *
+ * Returns     : Number of cells referencing the slot.
+ *
+ * Notes       : Cells that have been changed but not yet flushed still show
+ *               their old character until lcd_flush() is called, so they
+ *               are counted for the old character as well as the new one.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_fbGlyphRefs (uint8_t slot)
+{
+  return pvt_fbGlyphRefs[GLYPH_SLOT (slot)]
+       + pvt_fbShownRefs[GLYPH_SLOT (slot)];
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         FLUSH TO THE DISPLAY
+ *
+ * Description : Sends every dirty cell to the LCD and marks it clean. The
+ *               display is walked in DDRAM address order and the cursor is
+ *               only moved, with lcd_moveFillTo(), when the next dirty cell
+ *               does not directly follow the last one written.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ *
+ * Notes       : On return the address counter points to the cell after the
+ *               last one written, so the cursor should be repositioned if it
+ *               is visible.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_flush (void)
+{
+  for (uint8_t i = 0; i < LCD_ROWS; i++)
+  {
+    uint8_t row  = pvt_fbRowOrder[i];
+    uint8_t cell = row * LCD_COLS;
+    uint8_t addr = LCD_XY_ADDR (row, 0);
+
+    for (uint8_t col = 0; col < LCD_COLS; col++, cell++, addr++)
+    {
+      if (!IS_DIRTY (cell))
+        continue;
+
+      // nothing is sent if the run is contiguous.
+      lcd_moveFillTo (pvt_fbLcd, addr);
+
+      lcd_writeData (pvt_fbLcd, pvt_fbCells[cell]);
+      CLEAR_DIRTY (cell);
+    }
+  }
+
+  // every cell now shows its character.
+  for (uint8_t slot = 0; slot < sizeof pvt_fbShownRefs; slot++)
+    pvt_fbShownRefs[slot] = 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * File        : LCD_GLYPH.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_GLYPH.H
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "lcd_base.h"
+#include "lcd_fb.h"
+#include "lcd_glyph.h"
+
+
+/*
+ ******************************************************************************
+ *                                 "PRIVATE" DATA
+ ******************************************************************************
+ */
+
+const uint8_t * pvt_glyphSlot[GLYPH_SLOTS];      // resident glyph, or NULL
+uint16_t pvt_glyphStamp[GLYPH_SLOTS];            // clock at last acquire
+uint16_t pvt_glyphClock;
+uint16_t pvt_glyphUploads;
+lcd_t * pvt_glyphLcd;                            // LCD the slots belong to
+
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTION
+ ******************************************************************************
+ */
+
+//
+// Writes the glyph's bitmap to a CGRAM slot, top row first, and restores the
+// entry mode and the address counter.
+//
+void pvt_glyphUpload (uint8_t slot, const uint8_t * glyph)
+{
+  uint8_t addr  = lcd_addrCounter (pvt_glyphLcd);
+  uint8_t cgram = lcd_addrIsCGRAM (pvt_glyphLcd);
+  uint8_t mode  = lcd_entryMode (pvt_glyphLcd);
+
+  // the rows are written in increasing address order whatever the mode.
+  lcd_entryModeSet (pvt_glyphLcd, INCREMENT);
+  lcd_setAddrCGRAM (pvt_glyphLcd, slot * GLYPH_ROWS);
+  for (uint8_t row = 0; row < GLYPH_ROWS; row++)
+    lcd_writeData (pvt_glyphLcd, pgm_read_byte (glyph + row));
+  lcd_entryModeSet (pvt_glyphLcd, mode);
+
+  if (cgram)
+    lcd_setAddrCGRAM (pvt_glyphLcd, addr);
+  else
+    lcd_setAddrDDRAM (pvt_glyphLcd, addr);
+
+  pvt_glyphUploads++;
+}
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                   INITIALIZE THE GLYPH CACHE
+ *
+ * Description : Marks every slot empty. Should be called after lcd_init(),
+ *               as the CGRAM contents are not known at that point.
+ *
+ * Arguments   : lcd     the LCD whose CGRAM is to be managed.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_glyphInit (lcd_t * lcd)
+{
+  pvt_glyphLcd = lcd;
+
+  for (uint8_t slot = 0; slot < GLYPH_SLOTS; slot++)
+    pvt_glyphSlot[slot] = NULL;
+
+  pvt_glyphUploads = 0;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              ACQUIRE A GLYPH
+ *
+ * Description : Returns the CGRAM slot that holds the glyph. If the glyph is
+ *               not resident, it is uploaded to an empty slot or, if there is
+ *               none, to the least recently acquired slot not referenced by
+ *               the framebuffer or still shown on the display. The DDRAM or
+ *               CGRAM address held in the address counter and the entry
+ *               mode beforehand are restored.
+ *
+ * Arguments   : glyph     pointer to the glyph's 8-byte bitmap in flash.
+ *
+ * Returns     : Slot, 0 to GLYPH_SLOTS - 1, which is the character code to
+ *               write to display the glyph. GLYPH_NO_SLOT if every slot is
+ *               referenced by the framebuffer or the display.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_glyphAcquire (const uint8_t * glyph)
+{
+  uint8_t  victim = GLYPH_NO_SLOT;
+  uint16_t oldest = 0;
+
+  pvt_glyphClock++;
+
+  for (uint8_t slot = 0; slot < GLYPH_SLOTS; slot++)
+  {
+    // already resident
+    if (pvt_glyphSlot[slot] == glyph)
+    {
+      pvt_glyphStamp[slot] = pvt_glyphClock;
+      return slot;
+    }
+
+    // empty slots are used first, then the least recently acquired.
+    if (lcd_fbGlyphRefs (slot) == 0)
+    {
+      uint16_t age = (pvt_glyphSlot[slot] == NULL)
+                   ? 0xFFFF : pvt_glyphClock - pvt_glyphStamp[slot];
+
+      if (victim == GLYPH_NO_SLOT || age > oldest)
+      {
+        victim = slot;
+        oldest = age;
+      }
+    }
+  }
+
+  if (victim == GLYPH_NO_SLOT)
+    return GLYPH_NO_SLOT;
+
+  pvt_glyphUpload (victim, glyph);
+  pvt_glyphSlot[victim]  = glyph;
+  pvt_glyphStamp[victim] = pvt_glyphClock;
+  return victim;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                GLYPH UPLOADS
+ *
+ * Description : Returns the number of glyphs uploaded to CGRAM since
+ *               lcd_glyphInit(), i.e. the number of cache misses.
+ *
+ * Arguments   : void
+ * ----------------------------------------------------------------------------
+ */
+
+uint16_t lcd_glyphUploads (void)
+{
+  return pvt_glyphUploads;
+}
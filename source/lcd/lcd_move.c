@@ -0,0 +1,166 @@
+/*
+ * File        : LCD_MOVE.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_MOVE.H
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include "lcd_base.h"
+#include "lcd_addr.h"
+#include "lcd_move.h"
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+// geometry of the LCD, from its lcd_t with LCD_MULTI_INSTANCE, or else the
+// LCD_ADDR tables.
+#ifdef LCD_MULTI_INSTANCE
+  #define MV_ROWS              (lcd->rows)
+  #define MV_COLS              (lcd->cols)
+  #define MV_XY_ADDR(row, col) (lcd->rowAddr[row] + (col))
+#else
+  #define MV_ROWS              LCD_ROWS
+  #define MV_COLS              LCD_COLS
+  #define MV_XY_ADDR(row, col) LCD_XY_ADDR (row, col)
+#endif // LCD_MULTI_INSTANCE
+
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTION
+ ******************************************************************************
+ */
+
+//
+// Moves the address counter to a DDRAM address. If fill is set, rewriting
+// the characters in between from lcd->fill is considered.
+//
+uint8_t pvt_moveTo (lcd_t * lcd, uint8_t addr, uint8_t fill)
+{
+  if (addr > ADDRESS_MASK)
+    return INVALID_ARG;
+
+  uint8_t from = lcd_addrCounter (lcd);
+
+  if (!lcd_addrIsCGRAM (lcd))
+  {
+    if (from == addr)
+      return LCD_INSTR_SUCCESS;
+
+    // rewriting forward within a display line, which requires INCREMENT
+    // without display shift.
+    uint8_t dist = addr - from;
+    if (fill && addr > from && dist <= LCD_MOVE_MAX_FILL
+        && dist * MOVE_COST_DATA < MOVE_COST_INSTR && lcd->fill != NULL
+        && lcd_entryMode (lcd) == INCREMENT)
+    {
+      uint8_t at = lcd_addrToPos (lcd, from);
+      uint8_t to = lcd_addrToPos (lcd, addr);
+      if (at != POS_NONE && to != POS_NONE && POS_ROW (at) == POS_ROW (to))
+      {
+        for ( ; from != addr; from++)
+          lcd_writeData (lcd, lcd->fill (from));
+        return LCD_INSTR_SUCCESS;
+      }
+    }
+  }
+
+  lcd_setAddrDDRAM (lcd, addr);
+  return LCD_INSTR_SUCCESS;
+}
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                     MOVE THE ADDRESS COUNTER
+ *
+ * Description : Moves the address counter to the given display position, or
+ *               DDRAM address, with a SET_DDRAM_ADDR. Nothing is sent if
+ *               the address counter is already there.
+ *
+ * Arguments   : lcd      the LCD.
+ *               row      display line, 0 (line 1) to LCD_ROWS - 1.
+ *               col      position in the line, 0 to LCD_COLS - 1.
+ *               addr     DDRAM address.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if row or col is out of range, or
+ *               addr is not a DDRAM address. Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_moveCursor (lcd_t * lcd, uint8_t row, uint8_t col)
+{
+  if (row >= MV_ROWS || col >= MV_COLS)
+    return INVALID_ARG;
+
+  return pvt_moveTo (lcd, MV_XY_ADDR (row, col), 0);
+}
+
+uint8_t lcd_moveToAddr (lcd_t * lcd, uint8_t addr)
+{
+  return pvt_moveTo (lcd, addr, 0);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                        MOVE THE ADDRESS COUNTER BY REWRITING
+ *
+ * Description : Moves the address counter to the given DDRAM address as
+ *               lcd_moveToAddr() does, but also considers rewriting the
+ *               characters in between from the registered fill function.
+ *               The caller must ensure those characters are what the
+ *               display shows, as lcd_flush() does.
+ *
+ * Arguments   : lcd      the LCD.
+ *               addr     DDRAM address.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if addr is not a DDRAM address.
+ *               Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_moveFillTo (lcd_t * lcd, uint8_t addr)
+{
+  return pvt_moveTo (lcd, addr, 1);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       REGISTER FILL FUNCTION
+ *
+ * Description : Registers the function that supplies the characters shown
+ *               on the display, allowing lcd_moveFillTo() to move the
+ *               cursor forward by rewriting them. lcd_fbInit() registers
+ *               the framebuffer.
+ *
+ * Arguments   : lcd      the LCD.
+ *               fill     function returning the character to write at a
+ *                        visible DDRAM address. NULL disables rewriting.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_moveSetFill (lcd_t * lcd, uint8_t (*fill)(uint8_t addr))
+{
+  lcd->fill = fill;
+}
@@ -0,0 +1,346 @@
+/*
+ * File        : LCD_PAR.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_PAR.H
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <util/delay.h>
+#include "lcd_base.h"
+#include "lcd_timing.h"
+
+// only built for the parallel ports, see LCD_BUS.H.
+#ifdef LCD_PAR
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+//
+// RS and RW for each kind of transfer. Through the pointers of
+// LCD_MULTI_INSTANCE the read-modify-write of the control port is not atomic
+// anyway, so both are set in one. Otherwise each is set by a single
+// instruction, which leaves the other pins of the port safe to change from
+// an interrupt.
+//
+#if defined (LCD_WRITE_ONLY)
+  #define PINS_INSTR_WRITE   DATA_REG_SELECT
+  #define PINS_DATA_WRITE    INSTR_REG_SELECT
+#elif defined (LCD_MULTI_INSTANCE)
+  #define PINS_INSTR_WRITE   CTRL_PORT &= ~(RS_MASK | RW_MASK)
+  #define PINS_DATA_WRITE    CTRL_PORT = (CTRL_PORT & ~RW_MASK) | RS_MASK
+  #define PINS_INSTR_READ    CTRL_PORT = (CTRL_PORT & ~RS_MASK) | RW_MASK
+  #define PINS_DATA_READ     CTRL_PORT |= RS_MASK | RW_MASK
+#else
+  #define PINS_INSTR_WRITE   do { DATA_REG_SELECT; WRITE_MODE; } while (0)
+  #define PINS_DATA_WRITE    do { INSTR_REG_SELECT; WRITE_MODE; } while (0)
+  #define PINS_INSTR_READ    do { DATA_REG_SELECT; READ_MODE; } while (0)
+  #define PINS_DATA_READ     do { INSTR_REG_SELECT; READ_MODE; } while (0)
+#endif
+
+// RS and RW for a data write after another. Without LCD_WRITE_ONLY the busy
+// flag has been read in between, so they are set again.
+#if defined (LCD_WRITE_ONLY)
+  #define PINS_DATA_NEXT     do { } while (0)
+#else
+  #define PINS_DATA_NEXT     PINS_DATA_WRITE
+#endif
+
+//
+// The bus cycles, as macros so each transfer is made within the function
+// called by LCD_BASE. A read samples DATA_PIN into pins while EN is high.
+//
+#define PAR_PULSE                                                             \
+  do {                                                                        \
+    WAIT_ADDR_SETUP;                                                          \
+    ENABLE_HI;                                                                \
+    WAIT_ENABLE_PULSE;                                                        \
+    ENABLE_LO;                                                                \
+    WAIT_ENABLE_CYCLE;                                                        \
+  } while (0)
+
+#define PAR_READ_CYCLE(pins)                                                  \
+  do {                                                                        \
+    WAIT_ADDR_SETUP;                                                          \
+    ENABLE_HI;                                                                \
+    WAIT_DATA_DELAY;                                                          \
+    (pins) = DATA_PIN;                                                        \
+    ENABLE_LO;                                                                \
+    WAIT_ENABLE_CYCLE;                                                        \
+  } while (0)
+
+// places the lower 4 bits of nib on DB4-DB7 and latches them.
+#define PAR_NIBBLE(nib)                                                       \
+  do {                                                                        \
+    DATA_PORT = (DATA_PORT & ~DATA_NIBBLE_MASK)                               \
+              | ((nib) << DATA_NIBBLE_SHIFT);                                 \
+    PAR_PULSE;                                                                \
+  } while (0)
+
+// a byte over the data bus, in 4-bit mode the high nibble first.
+#if (LCD_DATA_LENGTH == DATA_LENGTH_4_BITS)
+  #define PAR_WRITE(byte)                                                     \
+    do {                                                                      \
+      PAR_NIBBLE ((byte) >> 4);                                               \
+      PAR_NIBBLE ((byte) & 0x0F);                                             \
+    } while (0)
+
+  #define PAR_READ(byte)                                                      \
+    do {                                                                      \
+      uint8_t hi, lo;                                                         \
+      PAR_READ_CYCLE (hi);                                                    \
+      PAR_READ_CYCLE (lo);                                                    \
+      (byte) = ((hi & DATA_NIBBLE_MASK) >> DATA_NIBBLE_SHIFT) << 4            \
+             | ((lo & DATA_NIBBLE_MASK) >> DATA_NIBBLE_SHIFT);                \
+    } while (0)
+#else
+  #define PAR_WRITE(byte)                                                     \
+    do {                                                                      \
+      DATA_PORT = (byte);                                                     \
+      PAR_PULSE;                                                              \
+    } while (0)
+
+  #define PAR_READ(byte)     PAR_READ_CYCLE (byte)
+#endif
+
+
+/*
+ ******************************************************************************
+ *                                   VARIABLES
+ ******************************************************************************
+ */
+
+#ifdef LCD_BUS_RUNTIME
+const lcd_bus_t lcd_busPar =
+{
+  lcd_parInit,
+  lcd_parWriteNibble,
+  lcd_parWriteInstr,
+  lcd_parWriteData,
+  lcd_parWriteDataNext,
+#ifdef LCD_WRITE_ONLY
+  NULL,
+  NULL,
+#else
+  lcd_parReadStatus,
+  lcd_parReadData,
+#endif
+  lcd_parIdle
+};
+#endif // LCD_BUS_RUNTIME
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         INITIALIZE THE PORTS
+ *
+ * Description : Sets the data and control ports to outputs, with enable low
+ *               and the pins set for an instruction write. Called by
+ *               lcd_init() and lcd_warmInit().
+ *
+ * Arguments   : lcd     the LCD.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_parInit (lcd_t * lcd)
+{
+  // ensure enable is low
+  ENABLE_LO;
+
+  // Set Data and Control port data direction to output
+  DATA_BUS_OUTPUT;
+  CTRL_DDR |= CTRL_MASK;
+
+  // Set ctrl port pins to necessary values
+  DATA_REG_SELECT;
+  WRITE_MODE;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               WRITE AN INITIALIZATION NIBBLE
+ *
+ * Description : Places the lower 4 bits of nib on the DB4-DB7 pins and pulses
+ *               the enable pin to latch them, with the pins left as
+ *               lcd_parInit() set them. Only the pins in DATA_NIBBLE_MASK are
+ *               modified.
+ *
+ * Arguments   : lcd     the LCD.
+ *               nib     high nibble of an instruction, in the lower 4 bits.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_parWriteNibble (lcd_t * lcd, uint8_t nib)
+{
+  PAR_NIBBLE (nib);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 WRITE AN INSTRUCTION OR DATA
+ *
+ * Description : Selects the instruction (lcd_parWriteInstr()) or data
+ *               (lcd_parWriteData()) register for a write and writes the
+ *               byte over the data bus. In 4-bit mode the high nibble is
+ *               written first.
+ *
+ * Arguments   : lcd      the LCD.
+ *               inst     instruction and settings.
+ *               data     data byte.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_parWriteInstr (lcd_t * lcd, uint8_t inst)
+{
+  PINS_INSTR_WRITE;
+  PAR_WRITE (inst);
+}
+
+void lcd_parWriteData (lcd_t * lcd, uint8_t data)
+{
+  PINS_DATA_WRITE;
+  PAR_WRITE (data);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 WRITE THE NEXT DATA OF A RUN
+ *
+ * Description : Writes a data byte over the data bus after another, written
+ *               by lcd_parWriteData() or this function, with only the wait
+ *               for the controller in between. With LCD_WRITE_ONLY that
+ *               wait leaves the data register selected, so only the byte is
+ *               written. Otherwise the busy flag has been read, and the
+ *               register is selected again as lcd_parWriteData() does.
+ *
+ * Arguments   : lcd      the LCD.
+ *               data     data byte.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_parWriteDataNext (lcd_t * lcd, uint8_t data)
+{
+  PINS_DATA_NEXT;
+  PAR_WRITE (data);
+}
+
+
+#ifndef LCD_WRITE_ONLY
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 READ THE STATUS OR DATA BYTE
+ *
+ * Description : Sets the data bus to input, selects the instruction
+ *               (lcd_parReadStatus()) or data (lcd_parReadData()) register
+ *               for a read and reads a byte over the data bus. The data bus
+ *               is set back to output before returning. In 4-bit mode the
+ *               high nibble is read first.
+ *
+ * Arguments   : lcd     the LCD.
+ *
+ * Returns     : The busy flag and address counter, or the data byte.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_parReadStatus (lcd_t * lcd)
+{
+  uint8_t busy_addr;
+
+  DATA_BUS_INPUT;
+  PINS_INSTR_READ;
+  PAR_READ (busy_addr);
+  DATA_BUS_OUTPUT;
+
+  return busy_addr;
+}
+
+uint8_t lcd_parReadData (lcd_t * lcd)
+{
+  uint8_t data;
+
+  DATA_BUS_INPUT;
+  PINS_DATA_READ;
+  PAR_READ (data);
+  DATA_BUS_OUTPUT;
+
+  return data;
+}
+
+#endif // LCD_WRITE_ONLY
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              WAIT, CPU IDLE
+ *
+ * Description : Waits us microseconds in a delay loop, for the execution
+ *               time of the last byte sent to elapse.
+ *
+ * Arguments   : lcd     the LCD.
+ *               us      time in microseconds.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_parIdle (lcd_t * lcd, uint16_t us)
+{
+  for ( ; us > 0; us--)
+    _delay_us (1);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             PULSE ENABLE PIN
+ *
+ * Description : Pulses the enable pin.
+ *
+ * Arguments   : lcd     the LCD.
+ *
+ * Returns     : void
+ *
+ * Notes       : In order to execute an instruction the enable pin must
+ *               transition from high to low. This function performs this
+ *               operation by setting the enable pin high and then low. This
+ *               function should be called once all the other necessary pins
+ *               have been set according to the desired instruction and
+ *               settings. The setup, pulse width and enable cycle times are
+ *               taken from the timing profile in LCD_TIMING.H.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_pulseEnable (lcd_t * lcd)
+{
+  PAR_PULSE;
+}
+
+#endif // LCD_PAR
@@ -0,0 +1,294 @@
+/*
+ * File        : LCD_POLL.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_POLL.H
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "lcd_base.h"
+#include "lcd_poll.h"
+
+// lcd_isBusy() is needed, see LCD_POLL.H.
+#if !defined (LCD_WRITE_ONLY) || defined (LCD_DEADLINE)
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+#if (LCD_POLL_OPS & (LCD_POLL_OPS - 1)) || LCD_POLL_OPS > 64
+  #error "LCD_POLL_OPS must be a power of 2 no larger than 64"
+#endif
+
+#define POLL_MASK            (LCD_POLL_OPS - 1)
+
+// operation types
+#define OP_INSTR             0
+#define OP_WRITE             1
+#define OP_GLYPH             2
+
+// rows of a glyph, and steps of OP_GLYPH: set address, rows, restore.
+#define GLYPH_BYTES          8
+#define GLYPH_STEPS          (GLYPH_BYTES + 2)
+
+
+/*
+ ******************************************************************************
+ *                                    TYPES
+ ******************************************************************************
+ */
+
+// a pending operation.
+typedef struct
+{
+  uint8_t         type;                 // OP_*
+  uint8_t         arg;                  // instruction, or glyph slot
+  uint8_t         len;                  // bytes left to write
+  uint8_t         step;                 // transactions made so far
+  uint8_t         restore;              // OP_GLYPH: address to restore
+  const uint8_t * buf;                  // bytes to write, or glyph
+  lcd_pollDone_t  done;
+} pvt_pollOp_t;
+
+
+/*
+ ******************************************************************************
+ *                                 "PRIVATE" DATA
+ ******************************************************************************
+ */
+
+pvt_pollOp_t pvt_pollOps[LCD_POLL_OPS];
+uint8_t      pvt_pollHead;                      // next entry to be written
+uint8_t      pvt_pollTail;                      // operation in progress
+lcd_t *      pvt_pollLcd;                       // LCD operated on
+
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTIONS
+ ******************************************************************************
+ */
+
+//
+// Adds an operation. Returns QUEUE_FULL if there is no free entry.
+//
+uint8_t pvt_pollAdd (uint8_t type, uint8_t arg, const uint8_t * buf,
+                     uint8_t len, lcd_pollDone_t done)
+{
+  uint8_t next = (pvt_pollHead + 1) & POLL_MASK;
+  pvt_pollOp_t * op = &pvt_pollOps[pvt_pollHead];
+
+  if (next == pvt_pollTail)
+    return QUEUE_FULL;
+
+  op->type = type;
+  op->arg  = arg;
+  op->buf  = buf;
+  op->len  = len;
+  op->step = 0;
+  op->done = done;
+  pvt_pollHead = next;
+
+  return LCD_INSTR_SUCCESS;
+}
+
+//
+// Sends an instruction without waiting. The caller has checked the
+// controller is not busy.
+//
+void pvt_pollSendInstr (uint8_t inst)
+{
+  lcd_sendInstruction (pvt_pollLcd, inst);
+}
+
+//
+// Makes the next transaction of an operation. Returns 1 if that completed it.
+//
+uint8_t pvt_pollStep (pvt_pollOp_t * op)
+{
+  switch (op->type)
+  {
+    case OP_INSTR:
+      pvt_pollSendInstr (op->arg);
+      return 1;
+
+    case OP_WRITE:
+      lcd_sendData (pvt_pollLcd, *op->buf++);
+      return --op->len == 0;
+
+    default:                                            // OP_GLYPH
+      if (op->step == 0)
+      {
+        // remember where the address counter was, as an instruction.
+        op->restore = lcd_addrCounter (pvt_pollLcd)
+                      | (lcd_addrIsCGRAM (pvt_pollLcd) ? SET_CGRAM_ADDR 
+                                                       : SET_DDRAM_ADDR);
+        pvt_pollSendInstr (SET_CGRAM_ADDR | op->arg * GLYPH_BYTES);
+      }
+      else if (op->step <= GLYPH_BYTES)
+        lcd_sendData (pvt_pollLcd, pgm_read_byte (op->buf + op->step - 1));
+      else
+        pvt_pollSendInstr (op->restore);
+
+      return ++op->step == GLYPH_STEPS;
+  }
+}
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    INITIALIZE THE OPERATIONS
+ *
+ * Description : Discards any pending operations, without calling their
+ *               callbacks. Should be called after lcd_init().
+ *
+ * Arguments   : lcd     the LCD the operations are carried out on.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_pollInit (lcd_t * lcd)
+{
+  pvt_pollLcd = lcd;
+  pvt_pollHead = pvt_pollTail = 0;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          SUBMIT AN OPERATION
+ *
+ * Description : Adds an operation to the end of the pending operations. They
+ *               are carried out in order by lcd_poll().
+ *
+ *               lcd_pollInstr()   : sends any instruction, e.g.
+ *                                   RETURN_HOME or DISPLAY_CTRL | DISPLAY_ON.
+ *               lcd_pollClear()   : clears the display.
+ *               lcd_pollSetAddr() : sets the DDRAM address.
+ *               lcd_pollWrite()   : writes len bytes from buf, starting at
+ *                                   the current address. buf is not copied,
+ *                                   so must be left unchanged until the
+ *                                   operation completes.
+ *               lcd_pollGlyph()   : writes an 8-byte glyph bitmap stored in
+ *                                   flash to a CGRAM slot (0 to 7), then
+ *                                   restores the address counter. This does
+ *                                   not update the LCD_GLYPH cache.
+ *
+ * Arguments   : done     function called once the operation has completed,
+ *                        or NULL.
+ *
+ * Returns     : LCD_INSTR_SUCCESS if the operation was added, QUEUE_FULL if
+ *               LCD_POLL_OPS - 1 operations are already pending, or
+ *               INVALID_ARG.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_pollInstr (uint8_t instr, lcd_pollDone_t done)
+{
+  if (instr == 0)
+    return INVALID_ARG;
+
+  return pvt_pollAdd (OP_INSTR, instr, NULL, 0, done);
+}
+
+uint8_t lcd_pollClear (lcd_pollDone_t done)
+{
+  return pvt_pollAdd (OP_INSTR, CLEAR_DISPLAY, NULL, 0, done);
+}
+
+uint8_t lcd_pollSetAddr (uint8_t addr, lcd_pollDone_t done)
+{
+  if (addr > ADDRESS_MASK)
+    return INVALID_ARG;
+
+  return pvt_pollAdd (OP_INSTR, SET_DDRAM_ADDR | addr, NULL, 0, done);
+}
+
+uint8_t lcd_pollWrite (const uint8_t * buf, uint8_t len, lcd_pollDone_t done)
+{
+  if (len == 0)
+    return INVALID_ARG;
+
+  return pvt_pollAdd (OP_WRITE, 0, buf, len, done);
+}
+
+uint8_t lcd_pollGlyph (uint8_t slot, const uint8_t * glyph,
+                       lcd_pollDone_t done)
+{
+  if (slot > 7)
+    return INVALID_ARG;
+
+  return pvt_pollAdd (OP_GLYPH, slot, glyph, 0, done);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                       ADVANCE THE OPERATIONS
+ *
+ * Description : If an operation is pending and the controller is not busy,
+ *               makes the next bus transaction of the oldest operation, and
+ *               calls its callback if that completed it. Returns without
+ *               waiting otherwise. Call this from the superloop.
+ *
+ * Arguments   : void
+ *
+ * Returns     : Number of operations still pending. 0 when idle.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_poll (void)
+{
+  if (pvt_pollHead != pvt_pollTail && !lcd_isBusy (pvt_pollLcd))
+  {
+    pvt_pollOp_t * op = &pvt_pollOps[pvt_pollTail];
+
+    if (pvt_pollStep (op))
+    {
+      // free the entry first, so the callback can submit another.
+      lcd_pollDone_t done = op->done;
+      pvt_pollTail = (pvt_pollTail + 1) & POLL_MASK;
+      if (done)
+        done();
+    }
+  }
+
+  return lcd_pollPending();
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           PENDING OPERATIONS
+ *
+ * Description : Returns the number of operations not yet completed.
+ *
+ * Arguments   : void
+ *
+ * Returns     : Number of pending operations.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_pollPending (void)
+{
+  return (pvt_pollHead - pvt_pollTail) & POLL_MASK;
+}
+
+#endif
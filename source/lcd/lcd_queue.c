@@ -0,0 +1,356 @@
+/*
+ * File        : LCD_QUEUE.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_QUEUE.H
+ */
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "lcd_base.h"
+#include "lcd_timing.h"
+#include "lcd_queue.h"
+#ifdef LCD_TWI
+#include "lcd_twi.h"
+#endif
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+#if (LCD_QUEUE_SIZE & (LCD_QUEUE_SIZE - 1)) || LCD_QUEUE_SIZE > 128
+  #error "LCD_QUEUE_SIZE must be a power of 2 no larger than 128"
+#endif
+
+#define QUEUE_MASK           (LCD_QUEUE_SIZE - 1)
+
+// set in a queue entry if the byte is data rather than an instruction.
+#define QUEUE_DATA_FLAG      0x100
+
+// Timer/Counter2 runs at F_CPU/8. OCR2A value for one tick.
+#define QUEUE_OCR            (F_CPU / 1000000UL * LCD_QUEUE_TICK_US / 8 - 1)
+
+#if QUEUE_OCR < 1 || QUEUE_OCR > 255
+  #error "LCD_QUEUE_TICK_US is out of range for Timer/Counter2 at this F_CPU"
+#endif
+
+#if defined (LCD_TWI) && LCD_TWI_SIZE <= LCD_TWI_WRITE_BYTES
+  #error "LCD_TWI_SIZE is too small to hold a byte sent by LCD_QUEUE"
+#endif
+
+
+/*
+ ******************************************************************************
+ *                                 "PRIVATE" DATA
+ ******************************************************************************
+ */
+
+volatile uint16_t pvt_queue[LCD_QUEUE_SIZE];
+volatile uint8_t  pvt_qHead;                     // next entry to be written
+volatile uint8_t  pvt_qTail;                     // next entry to be sent
+uint8_t           pvt_qPolicy;
+uint16_t          pvt_qDropped;
+lcd_t *           pvt_qLcd;                      // LCD the bytes are sent to
+
+#ifdef LCD_WRITE_ONLY
+// execution time, in microseconds, remaining of the last byte sent.
+volatile uint16_t pvt_qHoldUs;
+#endif
+
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTION
+ ******************************************************************************
+ */
+
+//
+// Adds an entry to the head of the queue, applying the overflow policy if the
+// queue is full.
+//
+uint8_t pvt_enqueue (uint16_t entry)
+{
+  uint8_t next = (pvt_qHead + 1) & QUEUE_MASK;
+
+  if (next == pvt_qTail)
+  {
+    if (pvt_qPolicy == QUEUE_DROP_NEW)
+    {
+      pvt_qDropped++;
+      return QUEUE_FULL;
+    }
+    else if (pvt_qPolicy == QUEUE_DROP_OLDEST)
+    {
+      // the ISR may have made room in the meantime.
+      ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+      {
+        if (next == pvt_qTail)
+        {
+          pvt_qTail = (pvt_qTail + 1) & QUEUE_MASK;
+          pvt_qDropped++;
+        }
+      }
+    }
+    else
+    {
+      // wait for the ISR to send the oldest entry.
+      while (next == pvt_qTail)
+        ;
+    }
+  }
+
+  pvt_queue[pvt_qHead] = entry;
+  pvt_qHead = next;
+  return LCD_INSTR_SUCCESS;
+}
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         INITIALIZE THE QUEUE
+ *
+ * Description : Empties the queue and starts Timer/Counter2 in CTC mode with
+ *               its compare match interrupt firing every LCD_QUEUE_TICK_US.
+ *               lcd_init() should be called first, and global interrupts
+ *               must be enabled by the application (i.e. sei()) for the
+ *               queue to drain.
+ *
+ * Arguments   : lcd     the LCD the queued bytes are sent to.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_queueInit (lcd_t * lcd)
+{
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+  {
+    pvt_qLcd = lcd;
+    pvt_qHead = 0;
+    pvt_qTail = 0;
+    pvt_qDropped = 0;
+#ifdef LCD_WRITE_ONLY
+    pvt_qHoldUs = 0;
+#endif
+  }
+
+  // CTC mode, prescaler = 8, interrupt on compare match A.
+  TCCR2A = 1 << WGM21;
+  OCR2A  = QUEUE_OCR;
+  TCCR2B = 1 << CS21;
+  TIMSK2 |= 1 << OCIE2A;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 QUEUE INSTRUCTION or DATA
+ *
+ * Description : Adds an instruction or a data byte to the end of the queue.
+ *               The byte will be sent to the LCD once all bytes queued ahead
+ *               of it have been sent and the controller is no longer busy.
+ *
+ * Arguments   : instr     instruction and settings, e.g.
+ *                         SET_DDRAM_ADDR | LINE_2_BEG. These are not
+ *                         validated.
+ *
+ *               data      data byte to write to the DDRAM or CGRAM.
+ *
+ * Returns     : LCD_INSTR_SUCCESS if the byte was queued. QUEUE_FULL if the
+ *               queue was full and the policy is QUEUE_DROP_NEW.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_queueInstruction (uint8_t instr)
+{
+  return pvt_enqueue (instr);
+}
+
+uint8_t lcd_queueData (uint8_t data)
+{
+  return pvt_enqueue (QUEUE_DATA_FLAG | data);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              FLUSH THE QUEUE
+ *
+ * Description : Discards all bytes that have been queued but not yet sent.
+ *               A byte that is currently being executed by the controller is
+ *               not affected.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_queueFlush (void)
+{
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+  {
+    pvt_qTail = pvt_qHead;
+  }
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              WAIT UNTIL IDLE
+ *
+ * Description : Blocks until every queued byte has been sent and the
+ *               controller has finished executing the last one. Global
+ *               interrupts must be enabled.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_queueWaitIdle (void)
+{
+  // wait for the ISR to empty the queue.
+  while (pvt_qHead != pvt_qTail)
+    ;
+
+#ifdef LCD_WRITE_ONLY
+  // wait for the ISR to count down the execution time of the last byte.
+  uint16_t hold;
+  do
+  {
+    ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+    {
+      hold = pvt_qHoldUs;
+    }
+  }
+  while (hold);
+#else
+  // the ISR does not touch the bus while the queue is empty.
+  lcd_waitClearBusy (pvt_qLcd);
+#endif
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    SET QUEUE OVERFLOW POLICY
+ *
+ * Description : Sets what happens when a byte is queued while the queue is
+ *               full.
+ *
+ * Arguments   : policy     QUEUE_BLOCK, QUEUE_DROP_NEW or QUEUE_DROP_OLDEST.
+ *
+ * Returns     : LCD Error code. INVALID_ARG if policy is not one of the
+ *               above. Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_queueSetPolicy (uint8_t policy)
+{
+  if (policy > QUEUE_DROP_OLDEST)
+    return INVALID_ARG;
+
+  pvt_qPolicy = policy;
+  return LCD_INSTR_SUCCESS;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 QUEUE STATUS
+ *
+ * Description : lcd_queueLength() returns the number of bytes waiting to be
+ *               sent. lcd_queueDropped() returns the number of bytes that
+ *               have been discarded due to overflow since lcd_queueInit().
+ *
+ * Arguments   : void
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_queueLength (void)
+{
+  return (pvt_qHead - pvt_qTail) & QUEUE_MASK;
+}
+
+uint16_t lcd_queueDropped (void)
+{
+  return pvt_qDropped;
+}
+
+
+/*
+ ******************************************************************************
+ *                              INTERRUPT HANDLER
+ ******************************************************************************
+ */
+
+//
+// Sends at most one queued byte per compare match. Nothing is sent while the
+// controller is still executing the previous byte. In write-only mode this
+// is determined from the execution time of the last byte sent, otherwise the
+// busy flag is read. With LCD_TWI, nothing is sent until the expander's ring
+// buffer has room for the whole byte.
+//
+ISR (TIMER2_COMPA_vect)
+{
+  lcd_t *  lcd = pvt_qLcd;
+  uint16_t entry;
+
+#ifdef LCD_WRITE_ONLY
+  if (pvt_qHoldUs > LCD_QUEUE_TICK_US)
+  {
+    pvt_qHoldUs -= LCD_QUEUE_TICK_US;
+    return;
+  }
+  pvt_qHoldUs = 0;
+#endif
+
+  if (pvt_qHead == pvt_qTail)
+    return;
+
+#ifndef LCD_WRITE_ONLY
+  if (lcd_readBusyAndAddr (lcd) & BUSY_MASK)
+    return;
+#endif
+
+#ifdef LCD_TWI
+  // the TWI interrupt cannot make room in its ring while this one runs.
+  if (LCD_TWI_SIZE - 1 - lcd_twiPending() < LCD_TWI_WRITE_BYTES)
+    return;
+#endif
+
+  entry = pvt_queue[pvt_qTail];
+  pvt_qTail = (pvt_qTail + 1) & QUEUE_MASK;
+
+  if (entry & QUEUE_DATA_FLAG)
+  {
+    lcd_sendData (lcd, entry);
+#ifdef LCD_WRITE_ONLY
+    pvt_qHoldUs = EXEC_DATA_US;
+#endif
+  }
+  else
+  {
+    lcd_sendInstruction (lcd, entry);
+#ifdef LCD_WRITE_ONLY
+    pvt_qHoldUs = lcd_execTime (entry);
+#endif
+  }
+}
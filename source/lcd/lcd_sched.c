@@ -0,0 +1,352 @@
+/*
+ * File        : LCD_SCHED.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_SCHED.H
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include "lcd_base.h"
+#include "lcd_sched.h"
+
+// several controllers, and lcd_isBusy(), are needed. See LCD_SCHED.H.
+#if defined (LCD_MULTI_INSTANCE)                                              \
+    && (!defined (LCD_WRITE_ONLY) || defined (LCD_DEADLINE))
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+#if (LCD_SCHED_SIZE & (LCD_SCHED_SIZE - 1)) || LCD_SCHED_SIZE > 128
+  #error "LCD_SCHED_SIZE must be a power of 2 no larger than 128"
+#endif
+
+#define SCHED_MASK           (LCD_SCHED_SIZE - 1)
+
+// set in a ring entry if the byte is data rather than an instruction.
+#define SCHED_DATA_FLAG      0x100
+
+
+/*
+ ******************************************************************************
+ *                                    TYPES
+ ******************************************************************************
+ */
+
+// an attached controller and its pending bytes.
+typedef struct
+{
+  lcd_t *  lcd;
+  uint16_t ring[LCD_SCHED_SIZE];
+  uint8_t  head;                        // next entry to be written
+  uint8_t  tail;                        // next entry to be sent
+} pvt_schedLcd_t;
+
+
+/*
+ ******************************************************************************
+ *                                 "PRIVATE" DATA
+ ******************************************************************************
+ */
+
+pvt_schedLcd_t pvt_schedLcds[LCD_SCHED_LCDS];
+uint8_t        pvt_schedCount;                  // controllers attached
+uint8_t        pvt_schedLast;                   // controller served last
+
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTIONS
+ ******************************************************************************
+ */
+
+//
+// Returns the scheduler entry of an attached controller, or NULL.
+//
+pvt_schedLcd_t * pvt_schedFind (lcd_t * lcd)
+{
+  for (uint8_t i = 0; i < pvt_schedCount; i++)
+    if (pvt_schedLcds[i].lcd == lcd)
+      return &pvt_schedLcds[i];
+  return NULL;
+}
+
+//
+// Returns the number of free entries in the ring of a controller.
+//
+uint8_t pvt_schedFree (pvt_schedLcd_t * sl)
+{
+  return (sl->tail - sl->head - 1) & SCHED_MASK;
+}
+
+//
+// Returns the controller, with bytes pending, to serve next, or NULL if
+// none has bytes pending. Starting after the one served last, this is the
+// first that is not busy or, with LCD_DEADLINE, the one whose deadline
+// expires first. *ready is set if it is not busy.
+//
+pvt_schedLcd_t * pvt_schedNext (uint8_t * ready)
+{
+  pvt_schedLcd_t * next = NULL;
+#ifdef LCD_DEADLINE
+  uint16_t soonest = UINT16_MAX;
+#endif
+
+  *ready = 0;
+  for (uint8_t n = 1; n <= pvt_schedCount; n++)
+  {
+    uint8_t i = (pvt_schedLast + n) % pvt_schedCount;
+    pvt_schedLcd_t * sl = &pvt_schedLcds[i];
+
+    if (sl->head == sl->tail)
+      continue;
+
+#ifdef LCD_DEADLINE
+    // ticks left of its deadline.
+    uint16_t left = lcd_deadlineLeft (sl->lcd);
+
+    if (left < soonest)
+    {
+      soonest = left;
+      next = sl;
+    }
+    if (left == 0)
+      break;
+#else
+    next = sl;
+    if (!lcd_isBusy (sl->lcd))
+    {
+      *ready = 1;
+      break;
+    }
+#endif
+  }
+
+#ifdef LCD_DEADLINE
+  *ready = (next != NULL && soonest == 0);
+#endif
+  return next;
+}
+
+//
+// Sends the next pending byte of a controller, which is not busy.
+//
+void pvt_schedSend (pvt_schedLcd_t * sl)
+{
+  lcd_t *  lcd   = sl->lcd;
+  uint16_t entry = sl->ring[sl->tail];
+
+  if (entry & SCHED_DATA_FLAG)
+    lcd_sendData (lcd, (uint8_t)entry);
+  else
+    lcd_sendInstruction (lcd, (uint8_t)entry);
+
+  sl->tail = (sl->tail + 1) & SCHED_MASK;
+  pvt_schedLast = sl - pvt_schedLcds;
+}
+
+//
+// Adds an entry to the ring of a controller.
+//
+uint8_t pvt_schedAdd (lcd_t * lcd, uint16_t entry)
+{
+  pvt_schedLcd_t * sl = pvt_schedFind (lcd);
+
+  if (sl == NULL)
+    return INVALID_ARG;
+  if (pvt_schedFree (sl) == 0)
+    return QUEUE_FULL;
+
+  sl->ring[sl->head] = entry;
+  sl->head = (sl->head + 1) & SCHED_MASK;
+  return LCD_INSTR_SUCCESS;
+}
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                     INITIALIZE THE SCHEDULER
+ *
+ * Description : Detaches all controllers and discards any pending bytes.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_schedInit (void)
+{
+  pvt_schedCount = 0;
+  pvt_schedLast = 0;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          ATTACH A CONTROLLER
+ *
+ * Description : Adds a controller to those scheduled. lcd_init() should be
+ *               called for it first.
+ *
+ * Arguments   : lcd     the LCD.
+ *
+ * Returns     : LCD_INSTR_SUCCESS, or QUEUE_FULL if LCD_SCHED_LCDS
+ *               controllers are already attached.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_schedAttach (lcd_t * lcd)
+{
+  pvt_schedLcd_t * sl = &pvt_schedLcds[pvt_schedCount];
+
+  if (pvt_schedCount == LCD_SCHED_LCDS)
+    return QUEUE_FULL;
+
+  sl->lcd = lcd;
+  sl->head = sl->tail = 0;
+  pvt_schedCount++;
+  return LCD_INSTR_SUCCESS;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    SCHEDULE INSTRUCTION/DATA
+ *
+ * Description : Adds bytes to the end of the ring of a controller. They are
+ *               sent in order by lcd_schedRun() or lcd_schedFlush().
+ *
+ *               lcd_schedInstr() : an instruction, e.g.
+ *                                  SET_DDRAM_ADDR | LINE_2_BEG. It is not
+ *                                  validated.
+ *               lcd_schedData()  : a data byte.
+ *               lcd_schedWrite() : len data bytes from buf, which is copied.
+ *                                  Either all of them are added or none.
+ *
+ * Arguments   : lcd      the LCD, which must be attached.
+ *               instr    instruction and settings.
+ *               data     data byte.
+ *               buf      data bytes, len of them.
+ *
+ * Returns     : LCD_INSTR_SUCCESS, QUEUE_FULL if there is not enough room,
+ *               or INVALID_ARG if lcd is not attached.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_schedInstr (lcd_t * lcd, uint8_t instr)
+{
+  return pvt_schedAdd (lcd, instr);
+}
+
+uint8_t lcd_schedData (lcd_t * lcd, uint8_t data)
+{
+  return pvt_schedAdd (lcd, SCHED_DATA_FLAG | data);
+}
+
+uint8_t lcd_schedWrite (lcd_t * lcd, const uint8_t * buf, uint8_t len)
+{
+  pvt_schedLcd_t * sl = pvt_schedFind (lcd);
+
+  if (sl == NULL)
+    return INVALID_ARG;
+  if (pvt_schedFree (sl) < len)
+    return QUEUE_FULL;
+
+  while (len--)
+  {
+    sl->ring[sl->head] = SCHED_DATA_FLAG | *buf++;
+    sl->head = (sl->head + 1) & SCHED_MASK;
+  }
+  return LCD_INSTR_SUCCESS;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                            RUN THE SCHEDULER
+ *
+ * Description : lcd_schedRun() sends at most one byte, the next of a
+ *               controller that has bytes pending and is not busy, and
+ *               returns without waiting otherwise. Controllers that are
+ *               ready are served in turn. Call this from the superloop.
+ *
+ *               lcd_schedFlush() blocks until every pending byte has been
+ *               sent, waiting only when no controller with bytes pending is
+ *               ready.
+ *
+ * Arguments   : void
+ *
+ * Returns     : lcd_schedRun() returns the number of bytes still pending.
+ * ----------------------------------------------------------------------------
+ */
+
+uint16_t lcd_schedRun (void)
+{
+  uint8_t ready;
+  pvt_schedLcd_t * sl = pvt_schedNext (&ready);
+
+  if (sl != NULL && ready)
+    pvt_schedSend (sl);
+
+  return lcd_schedPending();
+}
+
+void lcd_schedFlush (void)
+{
+  uint8_t ready;
+  pvt_schedLcd_t * sl;
+
+  while ((sl = pvt_schedNext (&ready)) != NULL)
+  {
+#ifdef LCD_DEADLINE
+    // wait out only what remains of the deadline that expires first.
+    if (!ready)
+      lcd_waitClearBusy (sl->lcd);
+    pvt_schedSend (sl);
+#else
+    if (ready)
+      pvt_schedSend (sl);
+#endif
+  }
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                PENDING BYTES
+ *
+ * Description : Returns the number of bytes not yet sent, of all attached
+ *               controllers.
+ *
+ * Arguments   : void
+ *
+ * Returns     : Number of pending bytes.
+ * ----------------------------------------------------------------------------
+ */
+
+uint16_t lcd_schedPending (void)
+{
+  uint16_t pending = 0;
+
+  for (uint8_t i = 0; i < pvt_schedCount; i++)
+    pending += (pvt_schedLcds[i].head - pvt_schedLcds[i].tail) & SCHED_MASK;
+  return pending;
+}
+
+#endif
@@ -13,10 +13,32 @@
 #include <avr/io.h>
 #include <util/delay.h>
 #include "lcd_base.h"
+#include "lcd_addr.h"
 #include "lcd_sf.h"
+#include "lcd_move.h"
+#include "lcd_timing.h"
 #include "prints.h"
 
 
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+// geometry of the LCD, from its lcd_t with LCD_MULTI_INSTANCE, or else the
+// LCD_ADDR tables.
+#ifdef LCD_MULTI_INSTANCE
+  #define SF_ROWS              (lcd->rows)
+  #define SF_COLS              (lcd->cols)
+  #define SF_XY_ADDR(row, col) (lcd->rowAddr[row] + (col))
+#else
+  #define SF_ROWS              LCD_ROWS
+  #define SF_COLS              LCD_COLS
+  #define SF_XY_ADDR(row, col) LCD_XY_ADDR (row, col)
+#endif // LCD_MULTI_INSTANCE
+
+
 /*
  ******************************************************************************
  *                                FUNCTIONS
@@ -27,22 +49,68 @@
  * ----------------------------------------------------------------------------
  *                                                         READ ADDRESS COUNTER
  * 
- * Description : Gets the value in the address counter. It does this by calling 
- *               lcd_readBusyAndAddr() and clearing the busy flag from its 
- *               returned value, leaving only the address counter value.
+ * Description : Gets the value in the address counter. The value tracked by
+ *               the driver (see lcd_addrCounter()) is returned, so this 
+ *               does not access the LCD.
  * 
- * Arguments   : None
+ *               If LCD_VERIFY_ADDR is defined, the address counter is instead
+ *               read from the LCD by calling lcd_readBusyAndAddr() and 
+ *               clearing the busy flag from its returned value, and compared
+ *               to the tracked value. On a mismatch, lcd_addrMismatches() is
+ *               incremented and the address is set again so that the LCD and
+ *               the driver agree. This is intended for debugging.
+ * 
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : Current value in the address counter.
+ * 
+ * Notes       : When verifying, the address counter is only updated T_ADD_US
+ *               after the busy flag resets, so the busy flag is cleared and
+ *               this time is waited out before the address counter is read.
  * -----------------------------------------------------------------------------
  */
 
-uint8_t lcd_readAddr (void)
+#ifdef LCD_VERIFY_ADDR
+
+#ifdef LCD_WRITE_ONLY
+  #error "LCD_VERIFY_ADDR requires the LCD to be readable"
+#endif
+
+uint8_t lcd_readAddr (lcd_t * lcd)
+{
+  // ensure the last instruction has completed and the AC has been updated.
+  lcd_waitClearBusy (lcd);
+  _delay_us (T_ADD_US);
+
+  // extract address.
+  uint8_t addr = ADDRESS_MASK & lcd_readBusyAndAddr (lcd);
+
+  // resynchronize the LCD and driver if they disagree.
+  if (addr != lcd_addrCounter (lcd))
+  {
+    lcd->addrMismatches++;
+    if (lcd_addrIsCGRAM (lcd))
+      lcd_setAddrCGRAM (lcd, addr);
+    else
+      lcd_setAddrDDRAM (lcd, addr);
+  }
+  return addr;
+}
+
+uint16_t lcd_addrMismatches (lcd_t * lcd)
+{
+  return lcd->addrMismatches;
+}
+
+#else
+
+uint8_t lcd_readAddr (lcd_t * lcd)
 {
-  // extract and return address.
-  return (ADDRESS_MASK & lcd_readBusyAndAddr());
+  return lcd_addrCounter (lcd);
 }
 
+#endif // LCD_VERIFY_ADDR
+
 
 /* 
  * ----------------------------------------------------------------------------
@@ -52,20 +120,20 @@ uint8_t lcd_readAddr (void)
  *               on which function is called. These functions will call
  *               lcd_cursorDisplayShift() with the appropriate arguments. 
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : void
  * ----------------------------------------------------------------------------
  */
 
-void lcd_rightShiftCursor (void)
+void lcd_rightShiftCursor (lcd_t * lcd)
 {
-  lcd_cursorDisplayShift (CURSOR_SHIFT | RIGHT_SHIFT);
+  lcd_cursorDisplayShift (lcd, CURSOR_SHIFT | RIGHT_SHIFT);
 }
 
-void lcd_leftShiftCursor (void)
+void lcd_leftShiftCursor (lcd_t * lcd)
 {
-  lcd_cursorDisplayShift (CURSOR_SHIFT | LEFT_SHIFT);
+  lcd_cursorDisplayShift (lcd, CURSOR_SHIFT | LEFT_SHIFT);
 }
 
 
@@ -77,21 +145,154 @@ void lcd_leftShiftCursor (void)
  *               depending on which function is called. These functions will 
  *               call lcd_cursorDisplayShift() with the appropriate arguments. 
  * 
- * Arguments   : void
+ * Arguments   : lcd     the LCD.
  * 
  * Returns     : void
  * ----------------------------------------------------------------------------
  */
 
-void lcd_rightShiftDisplay (void)
+void lcd_rightShiftDisplay (lcd_t * lcd)
 {
-  lcd_cursorDisplayShift (DISPLAY_SHIFT | RIGHT_SHIFT);
+  lcd_cursorDisplayShift (lcd, DISPLAY_SHIFT | RIGHT_SHIFT);
 }
 
-void lcd_leftShiftDisplay (void)
+void lcd_leftShiftDisplay (lcd_t * lcd)
 {
-  lcd_cursorDisplayShift (DISPLAY_SHIFT | LEFT_SHIFT);
+  lcd_cursorDisplayShift (lcd, DISPLAY_SHIFT | LEFT_SHIFT);
 }
 
 
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                   WRITE STRING or BUFFER
+ * 
+ * Description : Writes a string or a buffer of characters to the display, 
+ *               starting at the current address counter position. The 
+ *               characters are written in runs, one per display line, with 
+ *               lcd_writeDataBuf(). When a run reaches the end of a display 
+ *               line, the address counter is set to the beginning of the next
+ *               display line, i.e. line 1 -> 2 -> 3 -> 4 -> 1, rather than
+ *               following the DDRAM address order.
+ * 
+ * Arguments   : lcd     the LCD.
+ *               str     null-terminated string, of up to 255 characters.
+ *               buf     pointer to the characters to write.
+ *               len     number of characters in buf.
+ * 
+ * Returns     : void
+ * 
+ * Notes       : The ENTRY_MODE_SET must be INCREMENT. If the address counter
+ *               does not point to a visible DDRAM position (e.g. it points to
+ *               CGRAM) the bytes are written without any line wrapping.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_writeString (lcd_t * lcd, const char * str)
+{
+  uint8_t len = 0;
+  while (len < 0xFF && str[len] != '\0')
+    len++;
+
+  lcd_writeBuf (lcd, (const uint8_t *)str, len);
+}
+
+void lcd_writeBuf (lcd_t * lcd, const uint8_t * buf, uint8_t len)
+{
+  uint8_t pos = lcd_addrToPos (lcd, lcd_addrCounter (lcd));
+  uint8_t row, room, run;
 
+  // not on a visible line, so there is nothing to wrap.
+  if (lcd_addrIsCGRAM (lcd) || pos == POS_NONE)
+  {
+    lcd_writeDataBuf (lcd, buf, len);
+    return;
+  }
+
+  // positions remaining in the current line
+  row  = POS_ROW (pos);
+  room = SF_COLS - POS_COL (pos);
+
+  while (1)
+  {
+    run = (len < room) ? len : room;
+    lcd_writeDataBuf (lcd, buf, run);
+    buf += run;
+    len -= run;
+
+    if (len == 0)
+      return;
+
+    // continue at the beginning of the next display line
+    row = (row + 1 < SF_ROWS) ? row + 1 : 0;
+    lcd_moveToAddr (lcd, SF_XY_ADDR (row, 0));
+    room = SF_COLS;
+  }
+}
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                          WRITE STRING or BUFFER AT POSITION
+ * 
+ * Description : Moves the address counter to the given display position with
+ *               lcd_moveCursor() and then writes the string or buffer as 
+ *               lcd_writeString() and lcd_writeBuf() do.
+ * 
+ * Arguments   : lcd     the LCD.
+ *               row     display line, 0 (line 1) to LCD_ROWS - 1.
+ *               col     position in the line, 0 to LCD_COLS - 1.
+ *               str     null-terminated string, of up to 255 characters.
+ *               buf     pointer to the characters to write.
+ *               len     number of characters in buf.
+ * 
+ * Returns     : LCD Error code. INVALID_ARG if row or col is out of range, in
+ *               which case nothing is written. Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_writeAt (lcd_t * lcd, uint8_t row, uint8_t col, const char * str)
+{
+  uint8_t len = 0;
+  while (len < 0xFF && str[len] != '\0')
+    len++;
+
+  return lcd_writeBufAt (lcd, row, col, (const uint8_t *)str, len);
+}
+
+uint8_t lcd_writeBufAt (lcd_t * lcd, uint8_t row, uint8_t col, 
+                        const uint8_t * buf, uint8_t len)
+{
+  if (lcd_moveCursor (lcd, row, col) == INVALID_ARG)
+    return INVALID_ARG;
+
+  lcd_writeBuf (lcd, buf, len);
+  return LCD_INSTR_SUCCESS;
+}
+
+
+/* 
+ * ----------------------------------------------------------------------------
+ *                                                               GO TO POSITION
+ * 
+ * Description : Sets the address counter to the given display position with
+ *               a single SET_DDRAM_ADDR. The address is read from the 
+ *               LCD_ADDR table in flash for the LCD_GEOMETRY profile, or 
+ *               taken from the lcd_t with LCD_MULTI_INSTANCE. Unlike 
+ *               lcd_moveCursor() no cheaper way of moving is considered.
+ * 
+ * Arguments   : lcd     the LCD.
+ *               row     display line, 0 (line 1) to LCD_ROWS - 1.
+ *               col     position in the line, 0 to LCD_COLS - 1.
+ * 
+ * Returns     : LCD Error code. INVALID_ARG if row or col is out of range, in
+ *               which case nothing is sent. Otherwise LCD_INSTR_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_gotoXY (lcd_t * lcd, uint8_t row, uint8_t col)
+{
+  if (row >= SF_ROWS || col >= SF_COLS)
+    return INVALID_ARG;
+
+  return lcd_setAddrDDRAM (lcd, SF_XY_ADDR (row, col));
+}
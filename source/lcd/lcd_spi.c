@@ -0,0 +1,272 @@
+/*
+ * File        : LCD_SPI.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_SPI.H
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <util/delay.h>
+#include "lcd_base.h"
+#include "lcd_spi.h"
+
+// only built for the shift register, see LCD_SPI.H.
+#ifdef LCD_SPI
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+// pins that must be set up before EN rises.
+#define SPI_SETUP_MASK       ((1 << LCD_SPI_RS) | (1 << LCD_SPI_RW))
+
+// DB4-DB7 are on QE-QH.
+#define SPI_NIBBLE_SHIFT     4
+
+// a rising edge of RCLK copies the shift register to the outputs.
+#define SPI_LATCH                                                             \
+  do {                                                                        \
+    LCD_SPI_PORT |=  (1 << LCD_SPI_LATCH);                                    \
+    LCD_SPI_PORT &= ~(1 << LCD_SPI_LATCH);                                    \
+  } while (0)
+
+
+/*
+ ******************************************************************************
+ *                                 "PRIVATE" DATA
+ ******************************************************************************
+ */
+
+uint8_t pvt_spiShifting;                         // a byte is not yet latched
+uint8_t pvt_spiLast;                             // last byte shifted
+
+
+/*
+ ******************************************************************************
+ *                                   VARIABLES
+ ******************************************************************************
+ */
+
+#ifdef LCD_BUS_RUNTIME
+const lcd_bus_t lcd_busSpi =
+{
+  lcd_spiInit,
+  lcd_spiWriteNibble,
+  lcd_spiWriteInstr,
+  lcd_spiWriteData,
+  lcd_spiWriteDataNext,
+  NULL,
+  NULL,
+  lcd_spiIdle
+};
+#endif // LCD_BUS_RUNTIME
+
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTIONS
+ ******************************************************************************
+ */
+
+//
+// Latches the byte being shifted, if any, once it is complete, then starts
+// shifting the new byte and returns without waiting for it.
+//
+void pvt_spiPut (uint8_t pins)
+{
+  lcd_spiFlush();
+
+  SPDR = pins;
+  pvt_spiShifting = 1;
+  pvt_spiLast = pins;
+}
+
+//
+// Shifts a nibble with RS set as given, as two bytes with EN high and then
+// low. If RS has changed since the last byte shifted, a byte with the new
+// setting and EN low is shifted before EN rises, for the address setup time.
+// The backlight is left as it is. The last byte is not latched.
+//
+void pvt_spiNibble (uint8_t rs, uint8_t nib)
+{
+  uint8_t pins = (pvt_spiLast & (1 << LCD_SPI_BL)) | rs
+               | (nib << SPI_NIBBLE_SHIFT);
+
+  if ((pins ^ pvt_spiLast) & SPI_SETUP_MASK)
+    pvt_spiPut (pins);
+  pvt_spiPut (pins | (1 << LCD_SPI_EN));
+  pvt_spiPut (pins);
+}
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           INITIALIZE THE SPI
+ *
+ * Description : Latches any byte still shifting, sets the SPI pins to
+ *               outputs and enables the SPI as master at fosc/2, mode 0, MSB
+ *               first, then latches the pins with EN low and the backlight
+ *               on. Called by lcd_init() and lcd_warmInit().
+ *
+ * Arguments   : lcd     the LCD.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_spiInit (lcd_t * lcd)
+{
+  lcd_spiFlush();
+
+  LCD_SPI_PORT &= ~(1 << LCD_SPI_LATCH);
+  LCD_SPI_DDR  |= (1 << LCD_SPI_LATCH) | (1 << LCD_SPI_SCK)
+                | (1 << LCD_SPI_MOSI);
+
+  SPCR = (1 << SPE) | (1 << MSTR);                 // master, fosc/4
+  SPSR = (1 << SPI2X);                             // doubled to fosc/2
+
+  pvt_spiPut (1 << LCD_SPI_BL);
+  lcd_spiFlush();
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               WRITE AN INITIALIZATION NIBBLE
+ *
+ * Description : Shifts out the lower 4 bits of nib on DB4-DB7 as an
+ *               instruction nibble, and latches the last byte.
+ *
+ * Arguments   : lcd     the LCD.
+ *               nib     high nibble of an instruction, in the lower 4 bits.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_spiWriteNibble (lcd_t * lcd, uint8_t nib)
+{
+  pvt_spiNibble (0, nib);
+  lcd_spiFlush();
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 WRITE AN INSTRUCTION OR DATA
+ *
+ * Description : Shifts out an instruction (lcd_spiWriteInstr()) or data
+ *               (lcd_spiWriteData()) byte, as its high nibble and then its
+ *               low nibble, with RS set to select the register. Each byte is
+ *               latched as the next is shifted, and the last once it has
+ *               been shifted, so the transfer is complete on return.
+ *
+ * Arguments   : lcd      the LCD.
+ *               inst     instruction and settings.
+ *               data     data byte.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_spiWriteInstr (lcd_t * lcd, uint8_t inst)
+{
+  pvt_spiNibble (0, inst >> 4);
+  pvt_spiNibble (0, inst & 0x0F);
+  lcd_spiFlush();
+}
+
+void lcd_spiWriteData (lcd_t * lcd, uint8_t data)
+{
+  pvt_spiNibble (1 << LCD_SPI_RS, data >> 4);
+  pvt_spiNibble (1 << LCD_SPI_RS, data & 0x0F);
+  lcd_spiFlush();
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                              WAIT, CPU IDLE
+ *
+ * Description : Waits us microseconds in a delay loop, for the execution
+ *               time of the last byte latched to elapse.
+ *
+ * Arguments   : lcd     the LCD.
+ *               us      time in microseconds.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_spiIdle (lcd_t * lcd, uint16_t us)
+{
+  for ( ; us > 0; us--)
+    _delay_us (1);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                          LATCH THE LAST BYTE
+ *
+ * Description : Waits for the byte being shifted, if any, to complete and
+ *               latches it onto the outputs. Called at the end of each
+ *               transfer.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_spiFlush (void)
+{
+  if (!pvt_spiShifting)
+    return;
+
+  // SPIF is cleared by the access of SPDR that starts the next byte.
+  while (!(SPSR & (1 << SPIF)))
+    ;
+  SPI_LATCH;
+  pvt_spiShifting = 0;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    BACKLIGHT
+ *
+ * Description : Turns the backlight on or off, by shifting and latching the
+ *               pins with the new setting.
+ *
+ * Arguments   : on     1 for on, 0 for off.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_spiBacklight (uint8_t on)
+{
+  if (on)
+    pvt_spiPut (pvt_spiLast | (1 << LCD_SPI_BL));
+  else
+    pvt_spiPut (pvt_spiLast & ~(1 << LCD_SPI_BL));
+  lcd_spiFlush();
+}
+
+#endif // LCD_SPI
@@ -0,0 +1,159 @@
+/*
+ * File        : LCD_STATS.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_STATS.H
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+#include "lcd_timer.h"
+#include "lcd_stats.h"
+#include "prints.h"
+
+
+/*
+ ******************************************************************************
+ *                                 "PRIVATE" DATA
+ ******************************************************************************
+ */
+
+lcd_stats_t pvt_stats;
+
+// instruction names, in instruction bit order as lcd_stats_t.instructions.
+char * const pvt_statsInstrNames[8] =
+{
+  "CLEAR_DISPLAY", "RETURN_HOME", "ENTRY_MODE_SET", "DISPLAY_CTRL",
+  "CURSOR_DISPLAY_SHIFT", "FUNCTION_SET", "SET_CGRAM_ADDR", "SET_DDRAM_ADDR"
+};
+
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTIONS
+ ******************************************************************************
+ */
+
+//
+// Counts an instruction under its instruction bit (see lcd_execTime()).
+//
+void pvt_statsInstr (uint8_t inst)
+{
+  uint8_t bit = 7;
+  while (bit > 0 && !(inst & (1 << bit)))
+    bit--;
+
+  pvt_stats.instructions[bit]++;
+}
+
+//
+// Adds the time since start to the total wait time and keeps the maximum.
+//
+void pvt_statsWait (uint16_t start)
+{
+  uint16_t ticks = (uint16_t)LCD_TIMER_NOW - start;
+
+  pvt_stats.waitTicks += ticks;
+  if (ticks > pvt_stats.maxWaitTicks)
+    pvt_stats.maxWaitTicks = ticks;
+}
+
+//
+// Prints one counter as "\n\r<name>: <value>".
+//
+void pvt_statsLine (char * name, uint32_t value)
+{
+  print_str ("\n\r");
+  print_str (name);
+  print_str (": ");
+  print_dec (value);
+}
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           RESET THE COUNTERS
+ *
+ * Description : Zeros the counters and starts the LCD_TIMER time base, which
+ *               times the waits. Should be called before lcd_init() so the
+ *               initialization is counted.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_statsReset (void)
+{
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+  {
+    memset (&pvt_stats, 0, sizeof pvt_stats);
+  }
+  lcd_timerInit();
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                             GET THE COUNTERS
+ *
+ * Description : Copies the counters, with interrupts disabled so the copy is
+ *               consistent with any updates made by the LCD_QUEUE interrupt.
+ *
+ * Arguments   : stats     pointer to the lcd_stats_t to copy the counters to.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_stats (lcd_stats_t * stats)
+{
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+  {
+    *stats = pvt_stats;
+  }
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           PRINT THE COUNTERS
+ *
+ * Description : Prints the counters to a terminal via PRINTS, one per line,
+ *               with the wait times converted to microseconds.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_printStats (void)
+{
+  lcd_stats_t stats;
+  lcd_stats (&stats);
+
+  print_str ("\n\rLCD STATS");
+  for (uint8_t i = 0; i < 8; i++)
+    pvt_statsLine (pvt_statsInstrNames[i], stats.instructions[i]);
+  pvt_statsLine ("DATA_WRITES", stats.dataWrites);
+  pvt_statsLine ("DATA_READS", stats.dataReads);
+  pvt_statsLine ("BUSY_POLLS", stats.busyPolls);
+  pvt_statsLine ("BUSY_TIMEOUTS", stats.busyTimeouts);
+  pvt_statsLine ("MAX_WAIT_US", TICKS_TO_US (stats.maxWaitTicks));
+  pvt_statsLine ("WAIT_US", TICKS_TO_US (stats.waitTicks));
+  print_str ("\n\r");
+}
@@ -0,0 +1,42 @@
+/*
+ * File        : LCD_TIMER.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_TIMER.H
+ */
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "lcd_timer.h"
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                      INITIALIZE THE TIME BASE
+ *
+ * Description : Starts Timer/Counter1 in normal mode with a prescaler of
+ *               LCD_TIMER_PRESCALE. Timer/Counter1 should not be used for
+ *               anything else while the time base is in use.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_timerInit (void)
+{
+  // normal mode, prescaler = LCD_TIMER_PRESCALE.
+  TCCR1A = 0;
+  TCCR1B = TIMER_CLOCK_SELECT;
+}
@@ -0,0 +1,126 @@
+/*
+ * File        : LCD_TRACE.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_TRACE.H
+ */
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "lcd_timer.h"
+#include "lcd_trace.h"
+#include "prints.h"
+#include "usart0.h"
+
+
+#if (LCD_TRACE_SIZE & (LCD_TRACE_SIZE - 1)) || LCD_TRACE_SIZE > 256
+  #error "LCD_TRACE_SIZE must be a power of 2 no larger than 256"
+#endif
+
+
+/*
+ ******************************************************************************
+ *                                 "PRIVATE" DATA
+ ******************************************************************************
+ */
+
+lcd_trace_t pvt_trace[LCD_TRACE_SIZE];
+uint16_t    pvt_traceCount;                   // transactions recorded
+uint8_t     pvt_traceFull;                    // the ring has wrapped
+
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTION
+ ******************************************************************************
+ */
+
+//
+// Sends the lower digits of num as hex, with leading zeros.
+//
+void pvt_traceHex (uint16_t num, uint8_t digits)
+{
+  while (digits--)
+  {
+    uint8_t d = (num >> (4 * digits)) & 0x0F;
+    usart_transmit (d < 10 ? '0' + d : 'A' + d - 10);
+  }
+}
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         INITIALIZE THE TRACE
+ *
+ * Description : Empties the trace and starts the LCD_TIMER time base. Should
+ *               be called before lcd_init() so the initialization is traced.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_traceInit (void)
+{
+  pvt_traceCount = 0;
+  pvt_traceFull  = 0;
+  lcd_timerInit();
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                               DUMP THE TRACE
+ *
+ * Description : Sends the recorded transactions, oldest first, through the
+ *               USART as one line of hex per transaction:
+ *
+ *                 C DD TTTT
+ *
+ *               where C is the ctrl value (0-3, see TRACE_BUS), DD the byte
+ *               and TTTT the timestamp in LCD_TIMER ticks. The first line
+ *               gives the total number of transactions recorded, in hex and
+ *               modulo 0x10000, which is more than the number dumped once
+ *               the trace has wrapped. Once it has, all LCD_TRACE_SIZE
+ *               transactions kept are dumped, however large the total.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_traceDump (void)
+{
+  uint16_t count = pvt_traceCount;
+
+  // the count itself wraps, so the ring's fill level is kept separately.
+  uint16_t first = count - (pvt_traceFull ? LCD_TRACE_SIZE : count);
+
+  print_str ("\n\rLCD TRACE ");
+  print_hex (count);
+
+  for (uint16_t i = first; i != count; i++)
+  {
+    lcd_trace_t * e = &pvt_trace[(uint8_t)i & TRACE_MASK];
+
+    print_str ("\n\r");
+    pvt_traceHex (e->ctrl, 1);
+    usart_transmit (' ');
+    pvt_traceHex (e->data, 2);
+    usart_transmit (' ');
+    pvt_traceHex (e->time, 4);
+  }
+  print_str ("\n\r");
+}
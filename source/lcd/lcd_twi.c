@@ -0,0 +1,400 @@
+/*
+ * File        : LCD_TWI.C
+ * Author      : Joshua Fain
+ * Host Target : ATMega1280
+ * LCD         : Gravitech 20x4 LCD with built-in HD44780 controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Implementation of LCD_TWI.H
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/delay.h>
+#include "lcd_base.h"
+#include "lcd_twi.h"
+
+// only built for the I2C backpack, see LCD_TWI.H.
+#ifdef LCD_TWI
+
+
+/*
+ ******************************************************************************
+ *                                    MACROS
+ ******************************************************************************
+ */
+
+#if (LCD_TWI_SIZE & (LCD_TWI_SIZE - 1)) || LCD_TWI_SIZE > 128
+  #error "LCD_TWI_SIZE must be a power of 2 no larger than 128"
+#endif
+
+#define TWI_MASK             (LCD_TWI_SIZE - 1)
+
+// TWBR for LCD_TWI_FREQ with the prescaler at 1. The datasheet asks for at
+// least 10 in master mode.
+#define TWI_TWBR             ((F_CPU / LCD_TWI_FREQ - 16) / 2)
+
+#if TWI_TWBR < 10 || TWI_TWBR > 255
+  #error "LCD_TWI_FREQ is out of range for the TWI at this F_CPU"
+#endif
+
+// time taken by one byte on the bus, 9 SCL periods, in nanoseconds.
+#define TWI_BYTE_NS          (9 * (16 + 2 * TWI_TWBR) * 1000000000ULL / F_CPU)
+
+// status codes (TWSR & TWI_STATUS_MASK) of the master transmitter.
+#define TWI_STATUS_MASK      0xF8
+#define TWI_START            0x08
+#define TWI_REP_START        0x10
+#define TWI_SLA_ACK          0x18
+#define TWI_DATA_ACK         0x28
+
+// address byte of a write to the expander.
+#define TWI_SLA_W            (LCD_TWI_ADDR << 1)
+
+// TWCR values to start a transaction, send TWDR and stop.
+#define TWI_CR_START         ((1 << TWINT) | (1 << TWSTA) | (1 << TWEN)       \
+                              | (1 << TWIE))
+#define TWI_CR_SEND          ((1 << TWINT) | (1 << TWEN) | (1 << TWIE))
+#define TWI_CR_STOP          ((1 << TWINT) | (1 << TWSTO) | (1 << TWEN))
+
+// pins that must be set up before EN rises.
+#define TWI_SETUP_MASK       ((1 << LCD_TWI_RS) | (1 << LCD_TWI_RW))
+
+// DB4-DB7 are on P4-P7.
+#define TWI_NIBBLE_SHIFT     4
+
+
+/*
+ ******************************************************************************
+ *                                 "PRIVATE" DATA
+ ******************************************************************************
+ */
+
+volatile uint8_t  pvt_twiRing[LCD_TWI_SIZE];
+volatile uint8_t  pvt_twiHead;                   // next byte to be written
+volatile uint8_t  pvt_twiTail;                   // next byte to be sent
+volatile uint8_t  pvt_twiActive;                 // transaction in progress
+volatile uint16_t pvt_twiErrors;
+uint8_t           pvt_twiLast;                   // last byte queued
+
+
+/*
+ ******************************************************************************
+ *                                   VARIABLES
+ ******************************************************************************
+ */
+
+#ifdef LCD_BUS_RUNTIME
+const lcd_bus_t lcd_busTwi =
+{
+  lcd_twiInit,
+  lcd_twiWriteNibble,
+  lcd_twiWriteInstr,
+  lcd_twiWriteData,
+  lcd_twiWriteDataNext,
+  NULL,
+  NULL,
+  lcd_twiIdle
+};
+#endif // LCD_BUS_RUNTIME
+
+
+/*
+ ******************************************************************************
+ *                            "PRIVATE" FUNCTIONS
+ ******************************************************************************
+ */
+
+//
+// Adds a byte to the ring, waiting for room if it is full, and starts a
+// transaction if none is in progress.
+//
+void pvt_twiPut (uint8_t pins)
+{
+  uint8_t next = (pvt_twiHead + 1) & TWI_MASK;
+
+  // wait for the interrupt to send the oldest byte.
+  while (next == pvt_twiTail)
+    _delay_us (1);
+
+  pvt_twiRing[pvt_twiHead] = pins;
+  pvt_twiHead = next;
+  pvt_twiLast = pins;
+
+  // the interrupt ends the transaction once the ring is empty.
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+  {
+    if (!pvt_twiActive)
+    {
+      // the stop ending the previous transaction must have been sent.
+      while (TWCR & (1 << TWSTO))
+        ;
+      pvt_twiActive = 1;
+      TWCR = TWI_CR_START;
+    }
+  }
+}
+
+//
+// Queues a nibble with RS set as given, as two bytes with EN high and then
+// low. If RS has changed since the last byte queued, a byte with the new
+// setting and EN low is queued before EN rises, for the address setup time.
+// The backlight is left as it is.
+//
+void pvt_twiNibble (uint8_t rs, uint8_t nib)
+{
+  uint8_t pins = (pvt_twiLast & (1 << LCD_TWI_BL)) | rs
+               | (nib << TWI_NIBBLE_SHIFT);
+
+  if ((pins ^ pvt_twiLast) & TWI_SETUP_MASK)
+    pvt_twiPut (pins);
+  pvt_twiPut (pins | (1 << LCD_TWI_EN));
+  pvt_twiPut (pins);
+}
+
+
+/*
+ ******************************************************************************
+ *                           INTERRUPT SERVICE ROUTINE
+ ******************************************************************************
+ */
+
+//
+// Sends the address after a start, then the queued bytes one per interrupt,
+// and stops once the ring is empty. On any other status the transaction is
+// abandoned and the queued bytes discarded.
+//
+ISR (TWI_vect)
+{
+  switch (TWSR & TWI_STATUS_MASK)
+  {
+    case TWI_START:
+    case TWI_REP_START:
+      TWDR = TWI_SLA_W;
+      TWCR = TWI_CR_SEND;
+      break;
+
+    case TWI_SLA_ACK:
+    case TWI_DATA_ACK:
+      if (pvt_twiTail != pvt_twiHead)
+      {
+        TWDR = pvt_twiRing[pvt_twiTail];
+        pvt_twiTail = (pvt_twiTail + 1) & TWI_MASK;
+        TWCR = TWI_CR_SEND;
+      }
+      else
+      {
+        TWCR = TWI_CR_STOP;
+        pvt_twiActive = 0;
+      }
+      break;
+
+    default:
+      pvt_twiErrors++;
+      pvt_twiTail = pvt_twiHead;
+      TWCR = TWI_CR_STOP;
+      pvt_twiActive = 0;
+      break;
+  }
+}
+
+
+/*
+ ******************************************************************************
+ *                                 FUNCTIONS
+ ******************************************************************************
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                           INITIALIZE THE TWI
+ *
+ * Description : Waits for any bytes still queued to be sent, then empties
+ *               the ring buffer, sets the bit rate for LCD_TWI_FREQ and
+ *               enables the TWI, and sends the pins with EN low and the
+ *               backlight on. Returns once they have been sent. Called by
+ *               lcd_init() and lcd_warmInit().
+ *
+ * Arguments   : lcd     the LCD.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_twiInit (lcd_t * lcd)
+{
+  lcd_twiFlush();
+
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+  {
+    pvt_twiHead = 0;
+    pvt_twiTail = 0;
+    pvt_twiLast = 1 << LCD_TWI_BL;
+
+    TWSR = 0;                                      // prescaler of 1
+    TWBR = TWI_TWBR;
+    TWCR = 1 << TWEN;
+  }
+
+  pvt_twiPut (pvt_twiLast);
+  lcd_twiFlush();
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                               WRITE AN INITIALIZATION NIBBLE
+ *
+ * Description : Queues the lower 4 bits of nib on DB4-DB7 as an instruction
+ *               nibble, and waits for it to be sent.
+ *
+ * Arguments   : lcd     the LCD.
+ *               nib     high nibble of an instruction, in the lower 4 bits.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_twiWriteNibble (lcd_t * lcd, uint8_t nib)
+{
+  pvt_twiNibble (0, nib);
+  lcd_twiFlush();
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                 WRITE AN INSTRUCTION OR DATA
+ *
+ * Description : Queues an instruction (lcd_twiWriteInstr()) or data
+ *               (lcd_twiWriteData()) byte, as its high nibble and then its
+ *               low nibble, with RS set to select the register. Returns
+ *               without waiting for the bytes to be sent.
+ *
+ * Arguments   : lcd      the LCD.
+ *               inst     instruction and settings.
+ *               data     data byte.
+ *
+ * Returns     : void
+ *
+ * Notes       : Waits for room if the ring buffer is full.
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_twiWriteInstr (lcd_t * lcd, uint8_t inst)
+{
+  pvt_twiNibble (0, inst >> 4);
+  pvt_twiNibble (0, inst & 0x0F);
+}
+
+void lcd_twiWriteData (lcd_t * lcd, uint8_t data)
+{
+  pvt_twiNibble (1 << LCD_TWI_RS, data >> 4);
+  pvt_twiNibble (1 << LCD_TWI_RS, data & 0x0F);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                 IDLE THE BUS
+ *
+ * Description : Queues enough idle bytes, repeating the last output, for us
+ *               microseconds to pass on the bus before the next nibble is
+ *               latched. The EN high and low bytes of that nibble count
+ *               towards it. Used by lcd_waitClearBusy() to wait out the
+ *               execution time of the last byte sent without the CPU.
+ *
+ * Arguments   : lcd    the LCD.
+ *               us     time in microseconds.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_twiIdle (lcd_t * lcd, uint16_t us)
+{
+  // bytes until the latch, the last two of which are the next nibble's.
+  uint16_t bytes = ((uint32_t)us * 1000 + TWI_BYTE_NS - 1) / TWI_BYTE_NS;
+
+  for ( ; bytes > 2; bytes--)
+    pvt_twiPut (pvt_twiLast);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                    WAIT FOR BYTES TO BE SENT
+ *
+ * Description : Blocks until every queued byte has been sent and the
+ *               transaction has been stopped.
+ *
+ * Arguments   : void
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_twiFlush (void)
+{
+  while (pvt_twiActive)
+    _delay_us (1);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                                    BACKLIGHT
+ *
+ * Description : Turns the backlight on or off, by queuing the pins with the
+ *               new setting.
+ *
+ * Arguments   : on     1 for on, 0 for off.
+ *
+ * Returns     : void
+ * ----------------------------------------------------------------------------
+ */
+
+void lcd_twiBacklight (uint8_t on)
+{
+  if (on)
+    pvt_twiPut (pvt_twiLast | (1 << LCD_TWI_BL));
+  else
+    pvt_twiPut (pvt_twiLast & ~(1 << LCD_TWI_BL));
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ *                                                         PENDING BYTES/ERRORS
+ *
+ * Description : lcd_twiPending() returns the number of bytes queued but not
+ *               yet sent. lcd_twiErrors() returns the number of transactions
+ *               that were not acknowledged by the expander, or lost the bus.
+ *               The bytes queued at the time are discarded, so the LCD
+ *               should be initialized again after an error.
+ *
+ * Arguments   : void
+ *
+ * Returns     : Number of bytes or errors.
+ * ----------------------------------------------------------------------------
+ */
+
+uint8_t lcd_twiPending (void)
+{
+  return (pvt_twiHead - pvt_twiTail) & TWI_MASK;
+}
+
+uint16_t lcd_twiErrors (void)
+{
+  uint16_t errors;
+
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+    errors = pvt_twiErrors;
+  return errors;
+}
+
+#endif // LCD_TWI
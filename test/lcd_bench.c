@@ -0,0 +1,468 @@
+/*
+ *                          BENCHMARKS FOR AVR-LCD
+ *
+ * File        : LCD_BENCH.C
+ * Author      : Joshua Fain
+ * Host Target : Linux (gcc), with the HD44780 emulator
+ * LCD         : Gravitech 20x4 LCD using HD44780 LCD controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Contains main(). Runs a fixed set of workloads against the AVR-LCD module
+ * on the host build (see MAKE_HOST.SH) and reports the cost of each, as
+ * measured by the HD44780 emulator, as one JSON object per line:
+ *
+ *   {"workload":"init","enable_pulses":...,"busy_polls":...,
+ *    "bus_reads":...,"instructions":...,"data_writes":...,"sim_us":...,
+ *    "cpu_cycles":...,"chars_per_sec":...,"violations":...}
+ *
+ * enable_pulses : enable cycles, i.e. bus transfers (nibbles in 4-bit mode).
+ * busy_polls    : reads of the busy flag/address counter.
+ * bus_reads     : all reads from the LCD, busy polls included.
+ * sim_us        : simulated time taken by the workload.
+ * cpu_cycles    : CPU cycles at F_CPU spent in the driver. The simulated
+ *                 clock only advances inside the driver (register accesses
+ *                 and delays) and in the application work simulated by the
+ *                 workload, which is not counted.
+ * chars_per_sec : data_writes per second of sim_us, i.e. the throughput
+ *                 achieved, rounded to an integer.
+ * violations    : timing violations and bytes lost to the busy controller.
+ *
+ * "two_lcd_serial" and "two_lcd_sched" write a line to each of two
+ * controllers sharing the bus, and are only run with LCD_MULTI_INSTANCE.
+ * "dual_clear_serial", "dual_clear_broadcast" and "dual_redraw" use the
+ * same two controllers as a 40x4 module through LCD_DUAL, and are also only
+ * run with LCD_MULTI_INSTANCE. A broadcast instruction is counted once by
+ * each controller.
+ *
+ * sim_us includes any application work simulated by the workload, which for
+ * "interleaved" is 30us before each byte written and for "superloop" 10us
+ * per call of lcd_poll(), while cpu_cycles does not.
+ *
+ * With LCD_TWI, sim_us runs until the last byte queued has been sent on the
+ * I2C bus, while cpu_cycles stops when the driver returns, so the difference
+ * is the time the CPU was free during the transfers. Each object also has
+ *   "twi_bytes"        : data bytes sent to the expander.
+ *   "twi_transactions" : start/stop sequences they were sent in.
+ *
+ * With LCD_SPI each object also has
+ *   "spi_bytes"        : bytes shifted out to the 74HC595.
+ *
+ * The workloads run in order against one emulated LCD, so the output is
+ * deterministic and can be diffed between commits, e.g.
+ *   ../untracked/build/host/lcd_bench > bench.jsonl
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+#include "hd44780.h"
+#include "lcd_addr.h"
+#include "lcd_base.h"
+#include "lcd_sf.h"
+#include "lcd_poll.h"
+#include "lcd_fb.h"
+#include "lcd_glyph.h"
+#include "lcd_sched.h"
+#include "lcd_dual.h"
+
+
+// 127 = backspace, as in LCD_TEST.C
+#define BACK_SPACE           127
+
+// glyphs for the animation and upload workloads: a bar filling up.
+const uint8_t bar[GLYPH_SLOTS + 1][GLYPH_ROWS] PROGMEM =
+{
+  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F },
+  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F },
+  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F },
+  { 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F },
+  { 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },
+  { 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },
+  { 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },
+  { 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },
+  { 0x1F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1F },
+};
+
+// the emulated LCD
+lcd_t lcd;
+
+#if defined (LCD_MULTI_INSTANCE)                                              \
+    && (!defined (LCD_WRITE_ONLY) || defined (LCD_DEADLINE))
+  #define BENCH_SCHED
+// the second emulated controller, on the same bus with its EN on PC3.
+lcd_t lcd2;
+#endif
+
+#ifdef LCD_MULTI_INSTANCE
+// the two controllers taken as the halves of a 40x4 module.
+lcd_t      top;
+lcd_t      bottom;
+lcd_dual_t dual;
+#endif
+
+// state at the start of the current workload
+hd_stats_t pvt_start;
+uint64_t   pvt_startPs;
+uint64_t   pvt_appPs;                   // application work simulated
+
+
+//
+// Copies str to the cols bytes of buf, truncated or padded with spaces, so
+// the workloads write whole lines of any geometry.
+//
+void bench_pad (uint8_t * buf, const char * str, uint8_t cols)
+{
+  size_t len = strlen (str);
+
+  if (len > cols)
+    len = cols;
+  memset (buf, ' ', cols);
+  memcpy (buf, str, len);
+}
+
+//
+// Starts measuring a workload. The controller is first allowed to finish
+// the previous instruction, so the workload is not charged for it.
+//
+void bench_begin (void)
+{
+  lcd_waitClearBusy (&lcd);
+#ifdef LCD_TWI
+  lcd_twiFlush();
+#endif
+  pvt_start   = *hd_stats();
+  pvt_startPs = hd_timePs();
+  pvt_appPs   = 0;
+}
+
+//
+// Simulates us microseconds of application work, which is not charged to
+// the driver. Interrupts taken during it still are.
+//
+void bench_app (uint16_t us)
+{
+  hd_delayUs (us);
+  pvt_appPs += us * 1000000ULL;
+}
+
+//
+// Prints the cost of the workload since bench_begin().
+//
+void bench_end (const char * name)
+{
+  uint64_t cpuPs = hd_timePs() - pvt_startPs - pvt_appPs;
+
+#ifdef LCD_TWI
+  // the bytes still queued are sent while the CPU is free.
+  lcd_twiFlush();
+#endif
+
+  const hd_stats_t * now = hd_stats();
+  uint64_t ps = hd_timePs() - pvt_startPs;
+  uint32_t violations = 0;
+  uint32_t writes = now->dataWrites - pvt_start.dataWrites;
+
+  for (uint8_t v = 0; v < HD_VIOL_COUNT; v++)
+    violations += now->violations[v] - pvt_start.violations[v];
+
+  printf ("{\"workload\":\"%s\",\"enable_pulses\":%u,\"busy_polls\":%u,"
+          "\"bus_reads\":%u,\"instructions\":%u,\"data_writes\":%u,"
+          "\"sim_us\":%.3f,\"cpu_cycles\":%llu,\"chars_per_sec\":%.0f,"
+          "\"violations\":%u",
+          name,
+          now->enablePulses - pvt_start.enablePulses,
+          now->busyReads - pvt_start.busyReads,
+          now->busyReads - pvt_start.busyReads
+            + now->dataReads - pvt_start.dataReads,
+          now->instructions - pvt_start.instructions,
+          writes,
+          ps / 1e6,
+          (unsigned long long)(cpuPs * (F_CPU / 1000000UL) / 1000000ULL),
+          ps ? writes * 1e12 / ps : 0.0,
+          violations);
+#ifdef LCD_TWI
+  printf (",\"twi_bytes\":%u,\"twi_transactions\":%u",
+          now->twiBytes - pvt_start.twiBytes,
+          now->twiStarts - pvt_start.twiStarts);
+#endif
+#ifdef LCD_SPI
+  printf (",\"spi_bytes\":%u", now->spiBytes - pvt_start.spiBytes);
+#endif
+  printf ("}\n");
+}
+
+#if !defined (LCD_WRITE_ONLY) || defined (LCD_DEADLINE)
+// lines drawn by the superloop workload.
+const uint8_t pvt_pollAddr[LCD_ROWS] = LINE_BEG_ADDRS;
+const char *  pvt_pollText[4] =
+{
+  "Superloop line one.", "Superloop line two.",
+  "Superloop line 3.", "Superloop line 4."
+};
+uint8_t pvt_pollLines[LCD_ROWS][LCD_COLS];
+uint8_t pvt_pollRow;
+
+//
+// Submits the next line of the superloop workload to LCD_POLL, and is the
+// callback of its write.
+//
+void bench_pollLine (void)
+{
+  if (pvt_pollRow == LCD_ROWS)
+    return;
+
+  lcd_pollSetAddr (pvt_pollAddr[pvt_pollRow], NULL);
+  lcd_pollWrite (pvt_pollLines[pvt_pollRow], LCD_COLS, bench_pollLine);
+  pvt_pollRow++;
+}
+#endif
+
+//
+// Handles a typed character the way LCD_TEST.C does.
+//
+void bench_type (char c)
+{
+  uint8_t pos;
+
+  if (c == BACK_SPACE)
+  {
+    lcd_entryModeSet (&lcd, DECREMENT);
+    pos = LCD_ADDR_POS (lcd_readAddr (&lcd));
+    if (pos != POS_NONE && POS_COL (pos) == 0 && POS_ROW (pos) > 0)
+      lcd_gotoXY (&lcd, POS_ROW (pos) - 1, LCD_COLS - 1);
+    else
+      lcd_leftShiftCursor (&lcd);
+    lcd_writeData (&lcd, ' ');
+    lcd_rightShiftCursor (&lcd);
+    lcd_entryModeSet (&lcd, INCREMENT);
+  }
+  else
+  {
+    pos = LCD_ADDR_POS (lcd_readAddr (&lcd));
+    lcd_writeData (&lcd, c);
+    if (pos != POS_NONE && POS_COL (pos) == LCD_COLS - 1)
+      lcd_gotoXY (&lcd, (POS_ROW (pos) + 1) % LCD_ROWS, 0);
+  }
+}
+
+int main (void)
+{
+  const char * typed = "The quick brown fox\x7f\x7f\x7f" "fox jumps over the "
+                       "lazy dog. 0123456789";
+  const char * marquee = "  AVR-LCD scrolling marquee demo  ";
+  char line[40 + 1];                    // a line of the widest geometry
+
+#ifdef LCD_MULTI_INSTANCE
+  lcd_config (&lcd, &PORTA, &PORTC, PC0, PC1, PC2, LCD_ROWS, LCD_COLS);
+#endif
+#ifdef LCD_BUS_RUNTIME
+  lcd_setBus (&lcd, LCD_BUS_DEFAULT);
+#endif
+#ifdef LCD_TWI
+  // the TWI interrupt sends the bytes queued for the expander.
+  sei();
+#endif
+
+  // ----------------------------------------------------------------- init
+  bench_begin();
+  lcd_init (&lcd);
+  lcd_displayCtrl (&lcd, DISPLAY_ON | CURSOR_OFF | BLINKING_OFF);
+  bench_end ("init");
+
+  lcd_fbInit (&lcd);
+  lcd_glyphInit (&lcd);
+
+  // --------------------------------------------------------------- typing
+  bench_begin();
+  for (const char * c = typed; *c; c++)
+    bench_type (*c);
+  bench_end ("typing");
+
+  // --------------------------------------------------------- full redraw
+  lcd_clearDisplay (&lcd);
+  bench_begin();
+  for (uint8_t row = 0; row < LCD_ROWS; row++)
+  {
+    snprintf (line, sizeof line, "Row %u: full redraw.", row + 1);
+    lcd_writeAt (&lcd, row, 0, line);
+  }
+  bench_end ("full_redraw");
+
+  // ---------------------------------------------------- single-cell update
+  lcd_clearDisplay (&lcd);
+  lcd_fbInit (&lcd);
+  bench_begin();
+  lcd_fbPutc (LCD_ROWS / 2, 10, '*');
+  lcd_flush();
+  bench_end ("cell_update");
+
+  // ---------------------------------------------------- dashboard refresh
+  lcd_fbPuts (0, 0, "RPM :");
+  lcd_fbPuts (1, 0, "TEMP:");
+  lcd_fbPuts (2, 0, "VOLT:");
+  lcd_fbPuts (3, 0, "LOAD:");
+  lcd_flush();
+  bench_begin();
+  for (uint16_t frame = 0; frame < 20; frame++)
+  {
+    snprintf (line, sizeof line, "%5u", 3000 + frame * 7);
+    lcd_fbPuts (0, 6, line);
+    snprintf (line, sizeof line, "%3u C", 80 + frame / 5);
+    lcd_fbPuts (1, 6, line);
+    snprintf (line, sizeof line, "%2u.%u V", 13, frame % 10);
+    lcd_fbPuts (2, 6, line);
+    snprintf (line, sizeof line, "%3u %%", (frame * 5) % 100);
+    lcd_fbPuts (3, 6, line);
+    lcd_flush();
+  }
+  bench_end ("dashboard");
+
+  // ------------------------------------------------------------ scrolling
+  uint8_t len = 0;
+  while (marquee[len])
+    len++;
+
+  bench_begin();
+  for (uint8_t step = 0; step < 20; step++)
+  {
+    for (uint8_t col = 0; col < LCD_COLS; col++)
+      lcd_fbPutc (LCD_ROWS - 1, col, marquee[(step + col) % len]);
+    lcd_flush();
+  }
+  bench_end ("scrolling");
+
+  // --------------------------------------------------------- CGRAM upload
+  bench_begin();
+  lcd_glyphAcquire (bar[GLYPH_SLOTS]);
+  bench_end ("cgram_upload");
+
+  // ------------------------------------------------------ glyph animation
+  bench_begin();
+  for (uint8_t frame = 0; frame < 32; frame++)
+  {
+    uint8_t slot = lcd_glyphAcquire (bar[frame % GLYPH_SLOTS]);
+    if (slot != GLYPH_NO_SLOT)
+      lcd_fbPutc (0, LCD_COLS - 1, slot);
+    lcd_flush();
+  }
+  bench_end ("glyph_animation");
+
+  // --------------------------------------------- interleaved application
+  // 30us of application work (e.g. formatting a number) between bytes, which
+  // the controller's execution time can overlap.
+  lcd_setAddrDDRAM (&lcd, LINE_2_BEG);
+  bench_begin();
+  for (uint8_t i = 0; i < LCD_COLS; i++)
+  {
+    bench_app (30);
+    lcd_writeData (&lcd, '0' + i % 10);
+  }
+  bench_end ("interleaved");
+
+#if !defined (LCD_WRITE_ONLY) || defined (LCD_DEADLINE)
+  // ------------------------------------------------------ superloop redraw
+  // the four lines submitted to LCD_POLL, each from the callback of the one
+  // before, with 10us of application work per pass of the loop.
+  for (uint8_t row = 0; row < LCD_ROWS; row++)
+    bench_pad (pvt_pollLines[row], pvt_pollText[row], LCD_COLS);
+  lcd_pollInit (&lcd);
+  bench_begin();
+  pvt_pollRow = 0;
+  bench_pollLine();
+  while (lcd_poll())
+    bench_app (10);
+  bench_end ("superloop");
+#endif
+
+#ifdef BENCH_SCHED
+  // ------------------------------------------------------ two controllers
+  // a line written to each of two controllers on the same bus, first one
+  // controller after the other, then interleaved by LCD_SCHED.
+  uint8_t text[LCD_COLS];
+
+  bench_pad (text, "Two controllers, one", LCD_COLS);
+
+  lcd_config (&lcd2, &PORTA, &PORTC, PC0, PC1, PC3, LCD_ROWS, LCD_COLS);
+#ifdef LCD_BUS_RUNTIME
+  lcd_setBus (&lcd2, LCD_BUS_DEFAULT);
+#endif
+  lcd_init (&lcd2);
+  lcd_waitClearBusy (&lcd2);
+  bench_begin();
+  lcd_setAddrDDRAM (&lcd, LCD_XY_ADDR (LCD_ROWS - 2, 0));
+  for (uint8_t i = 0; i < LCD_COLS; i++)
+    lcd_writeData (&lcd, text[i]);
+  lcd_setAddrDDRAM (&lcd2, LCD_XY_ADDR (LCD_ROWS - 2, 0));
+  for (uint8_t i = 0; i < LCD_COLS; i++)
+    lcd_writeData (&lcd2, text[i]);
+  bench_end ("two_lcd_serial");
+
+  lcd_schedInit();
+  lcd_schedAttach (&lcd);
+  lcd_schedAttach (&lcd2);
+  lcd_waitClearBusy (&lcd2);
+  bench_begin();
+  lcd_schedInstr (&lcd, SET_DDRAM_ADDR | LCD_XY_ADDR (LCD_ROWS - 1, 0));
+  lcd_schedWrite (&lcd, text, LCD_COLS);
+  lcd_schedInstr (&lcd2, SET_DDRAM_ADDR | LCD_XY_ADDR (LCD_ROWS - 1, 0));
+  lcd_schedWrite (&lcd2, text, LCD_COLS);
+  lcd_schedFlush();
+  bench_end ("two_lcd_sched");
+#endif
+
+#ifdef LCD_MULTI_INSTANCE
+  // --------------------------------------------------------- 40x4 module
+  // the two controllers as one 40x4 surface: both cleared one after the
+  // other, each clear waited out before the next is sent as by a driver
+  // without broadcast, then by a broadcast clear until both have finished,
+  // then all four rows written.
+  uint8_t rows[LCD_DUAL_ROWS * 40];
+
+  for (uint8_t row = 0; row < LCD_DUAL_ROWS; row++)
+  {
+    snprintf (line, sizeof line, "Row %u of the 40x4 surface.", row + 1);
+    bench_pad (rows + row * 40, line, 40);
+  }
+
+  lcd_config (&top, &PORTA, &PORTC, PC0, PC1, PC2, 2, 40);
+  lcd_config (&bottom, &PORTA, &PORTC, PC0, PC1, PC3, 2, 40);
+#ifdef LCD_BUS_RUNTIME
+  lcd_setBus (&top, LCD_BUS_DEFAULT);
+  lcd_setBus (&bottom, LCD_BUS_DEFAULT);
+#endif
+  lcd_init (&top);
+  lcd_init (&bottom);
+  lcd_dualInit (&dual, &top, &bottom);
+  lcd_dualDisplayCtrl (&dual, DISPLAY_ON | CURSOR_OFF | BLINKING_OFF);
+  lcd_waitClearBusy (&top);
+  lcd_waitClearBusy (&bottom);
+  bench_begin();
+  lcd_clearDisplay (&top);
+  lcd_waitClearBusy (&top);
+  lcd_clearDisplay (&bottom);
+  lcd_waitClearBusy (&bottom);
+  bench_end ("dual_clear_serial");
+
+  bench_begin();
+  lcd_dualClear (&dual);
+  lcd_waitClearBusy (&top);
+  lcd_waitClearBusy (&bottom);
+  bench_end ("dual_clear_broadcast");
+
+  bench_begin();
+  lcd_dualWriteBufAt (&dual, 0, 0, rows, sizeof rows);
+  bench_end ("dual_redraw");
+#endif
+
+  // --------------------------------------------------------- warm restart
+  // as after a reset of the MCU with the LCD still powered and configured.
+  bench_begin();
+  lcd_warmInit (&lcd);
+  bench_end ("warm_init");
+
+  return 0;
+}
@@ -0,0 +1,296 @@
+/*
+ *                            CHECKS FOR AVR-LCD
+ *
+ * File        : LCD_CHECK.C
+ * Author      : Joshua Fain
+ * Host Target : Linux (gcc), with the HD44780 emulator
+ * LCD         : Gravitech 20x4 LCD using HD44780 LCD controller
+ * License     : MIT
+ * Copyright (c) 2020, 2021
+ *
+ * Contains main(). Runs a fixed set of checks against the AVR-LCD module on
+ * the host build (see MAKE_HOST.SH), using the HD44780 emulator to observe
+ * what was sent to the controller and what it shows. One line is printed
+ * per check, starting with "ok" or "FAIL", and the exit status is the number
+ * of checks that failed, e.g.
+ *   ../untracked/build/host/lcd_check
+ *
+ * Which branch some of the modules take depends on the build, e.g. the
+ * cursor planner of LCD_MOVE only rewrites characters with LCD_TWI, so the
+ * checks should be run for each build of interest.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+#include "hd44780.h"
+#include "lcd_addr.h"
+#include "lcd_base.h"
+#include "lcd_fb.h"
+#include "lcd_move.h"
+#include "lcd_sf.h"
+#include "lcd_glyph.h"
+#include "lcd_queue.h"
+#ifdef LCD_DEADLINE
+#include "lcd_timer.h"
+#endif
+
+
+// more distinct glyphs than there are CGRAM slots, each row holding its
+// index.
+#define CHECK_GLYPHS         (GLYPH_SLOTS + 2)
+
+const uint8_t glyphs[CHECK_GLYPHS][GLYPH_ROWS] PROGMEM =
+{
+  { 0, 0, 0, 0, 0, 0, 0, 0 }, { 1, 1, 1, 1, 1, 1, 1, 1 },
+  { 2, 2, 2, 2, 2, 2, 2, 2 }, { 3, 3, 3, 3, 3, 3, 3, 3 },
+  { 4, 4, 4, 4, 4, 4, 4, 4 }, { 5, 5, 5, 5, 5, 5, 5, 5 },
+  { 6, 6, 6, 6, 6, 6, 6, 6 }, { 7, 7, 7, 7, 7, 7, 7, 7 },
+  { 8, 8, 8, 8, 8, 8, 8, 8 }, { 9, 9, 9, 9, 9, 9, 9, 9 },
+};
+
+
+// the emulated LCD
+lcd_t lcd;
+
+// checks failed so far
+uint8_t pvt_failed;
+
+// emulator counts at the start of the current check
+hd_stats_t pvt_start;
+
+
+//
+// Waits for every byte queued by the driver to reach the controller.
+//
+void check_sync (void)
+{
+#ifdef LCD_TWI
+  lcd_twiFlush();
+#endif
+}
+
+//
+// Starts counting the bytes sent to the controller for a check.
+//
+void check_begin (void)
+{
+  check_sync();
+  pvt_start = *hd_stats();
+}
+
+//
+// Returns the instructions and data bytes the controller has received since
+// check_begin().
+//
+uint32_t check_instructions (void)
+{
+  check_sync();
+  return hd_stats()->instructions - pvt_start.instructions;
+}
+
+uint32_t check_dataWrites (void)
+{
+  check_sync();
+  return hd_stats()->dataWrites - pvt_start.dataWrites;
+}
+
+//
+// Prints the result of a check, and counts it if it failed.
+//
+void check (const char * name, uint8_t ok)
+{
+  printf ("%s %s\n", ok ? "ok  " : "FAIL", name);
+  if (!ok)
+    pvt_failed++;
+}
+
+//
+// Returns 1 if row of the display starts with str.
+//
+uint8_t check_row (uint8_t row, const char * str)
+{
+  check_sync();
+  for (uint8_t col = 0; str[col]; col++)
+    if (hd_displayChar (row, col) != (uint8_t)str[col])
+      return 0;
+  return 1;
+}
+
+//
+// Returns 1 if CGRAM slot holds glyphs[index].
+//
+uint8_t check_cgram (uint8_t slot, uint8_t index)
+{
+  for (uint8_t row = 0; row < GLYPH_ROWS; row++)
+    if (hd_cgram (slot * GLYPH_ROWS + row) != index)
+      return 0;
+  return 1;
+}
+
+int main (void)
+{
+#ifdef LCD_MULTI_INSTANCE
+  lcd_config (&lcd, &PORTA, &PORTC, PC0, PC1, PC2, LCD_ROWS, LCD_COLS);
+#endif
+#ifdef LCD_BUS_RUNTIME
+  lcd_setBus (&lcd, LCD_BUS_DEFAULT);
+#endif
+#ifdef LCD_TWI
+  // the TWI interrupt sends the bytes queued for the expander.
+  sei();
+#endif
+
+  lcd_init (&lcd);
+  lcd_displayCtrl (&lcd, DISPLAY_ON | CURSOR_OFF | BLINKING_OFF);
+  lcd_fbInit (&lcd);
+
+  // ------------------------------------------------------- cursor planner
+  // the address counter is left after "abcdefgh" on the first line.
+  lcd_fbPuts (0, 0, "abcdefgh");
+  lcd_flush();
+
+  check_begin();
+  lcd_moveToAddr (&lcd, LCD_XY_ADDR (0, 8));
+  check ("move: nothing sent when already at the target",
+         check_instructions() == 0 && check_dataWrites() == 0);
+
+  check_begin();
+  lcd_moveToAddr (&lcd, LCD_XY_ADDR (0, 0));
+  check ("move: SET_DDRAM_ADDR to move backwards",
+         check_instructions() == 1 && check_dataWrites() == 0);
+
+  check_begin();
+  lcd_moveToAddr (&lcd, LCD_XY_ADDR (0, 2));
+  check ("move: SET_DDRAM_ADDR to skip two cells",
+         check_instructions() == 1 && check_dataWrites() == 0);
+
+  check_begin();
+  lcd_moveToAddr (&lcd, LCD_XY_ADDR (0, 3));
+  check ("move: SET_DDRAM_ADDR to skip one cell without filling",
+         check_instructions() == 1 && check_dataWrites() == 0);
+
+  lcd_moveToAddr (&lcd, LCD_XY_ADDR (0, 2));
+  check_begin();
+  lcd_moveFillTo (&lcd, LCD_XY_ADDR (0, 3));
+#ifdef LCD_TWI
+  check ("move: one clean cell rewritten with LCD_TWI",
+         check_instructions() == 0 && check_dataWrites() == 1);
+#else
+  check ("move: SET_DDRAM_ADDR to skip one cell without LCD_TWI",
+         check_instructions() == 1 && check_dataWrites() == 0);
+#endif
+  check ("move: address counter at the target",
+         lcd_addrCounter (&lcd) == LCD_XY_ADDR (0, 3));
+
+  check_begin();
+  lcd_moveToAddr (&lcd, LCD_XY_ADDR (1, 5));
+  check ("move: SET_DDRAM_ADDR to another line",
+         check_instructions() == 1 && check_dataWrites() == 0);
+
+  // a flush of two cells one apart, on the last line.
+  lcd_fbPutc (LCD_ROWS - 1, 0, 'x');
+  lcd_fbPutc (LCD_ROWS - 1, 2, 'z');
+  check_begin();
+  lcd_flush();
+#ifdef LCD_TWI
+  check ("move: flush rewrites the clean cell between two dirty cells",
+         check_instructions() == 1 && check_dataWrites() == 3);
+#else
+  check ("move: flush skips the clean cell between two dirty cells",
+         check_instructions() == 2 && check_dataWrites() == 2);
+#endif
+  check ("move: display unchanged by rewriting",
+         check_row (0, "abcdefgh") && check_row (LCD_ROWS - 1, "x z"));
+
+  // text written outside the framebuffer is not overwritten by a move.
+  lcd_writeAt (&lcd, LCD_ROWS - 1, 8, "X");
+  lcd_setAddrDDRAM (&lcd, LCD_XY_ADDR (LCD_ROWS - 1, 8));
+  lcd_writeAt (&lcd, LCD_ROWS - 1, 9, "Y");
+  check ("move: lcd_writeAt() leaves the cell it skips as it is",
+         check_row (LCD_ROWS - 1, "x z     XY"));
+  lcd_fbInvalidate();
+  lcd_flush();
+
+  // ---------------------------------------------------------- glyph cache
+  // a glyph is drawn and flushed, then its cell redrawn without flushing,
+  // so the display still shows it while the cache is filled and one more
+  // glyph acquired. Its slot is the least recently acquired.
+  lcd_glyphInit (&lcd);
+  uint8_t shown = lcd_glyphAcquire (glyphs[0]);
+  lcd_fbPutc (1, 0, shown);
+  lcd_flush();
+  lcd_fbPutc (1, 0, 'a');
+
+  for (uint8_t i = 1; i < GLYPH_SLOTS; i++)
+    lcd_glyphAcquire (glyphs[i]);
+  uint8_t slot = lcd_glyphAcquire (glyphs[GLYPH_SLOTS]);
+  check_sync();
+  check ("glyph: slot still on the display not evicted",
+         slot != GLYPH_NO_SLOT && slot != shown && check_cgram (shown, 0)
+         && hd_displayChar (1, 0) == shown);
+
+  lcd_flush();
+  slot = lcd_glyphAcquire (glyphs[GLYPH_SLOTS + 1]);
+  check_sync();
+  check ("glyph: slot evicted once its cell has been flushed",
+         slot == shown && check_cgram (shown, GLYPH_SLOTS + 1)
+         && hd_displayChar (1, 0) == 'a');
+
+  // a glyph uploaded while the entry mode is DECREMENT must not spill into
+  // the slot below its own, and the mode is left as it was.
+  lcd_glyphInit (&lcd);
+  lcd_glyphAcquire (glyphs[0]);
+  lcd_entryModeSet (&lcd, DECREMENT);
+  slot = lcd_glyphAcquire (glyphs[1]);
+  check_sync();
+  check ("glyph: uploaded top row first with the entry mode DECREMENT",
+         slot == 1 && check_cgram (0, 0) && check_cgram (1, 1)
+         && lcd_entryMode (&lcd) == DECREMENT);
+  lcd_entryModeSet (&lcd, INCREMENT);
+
+  // ---------------------------------------------------------------- queue
+  // a line is written and then partly overwritten, which is more bytes than
+  // the TWI ring buffer holds at once, so the queue's interrupt must leave
+  // some of them queued until it has room.
+  const char * queued = "0123456789abcdef";
+  const char * over   = "ABCDEFGHIJ";
+  uint16_t     ticks  = 0;
+
+  // the queue only counts the execution time of the bytes it sends itself.
+  check_sync();
+  lcd_waitClearBusy (&lcd);
+  sei();
+  lcd_queueInit (&lcd);
+  lcd_queueInstruction (SET_DDRAM_ADDR | LCD_XY_ADDR (LCD_ROWS - 1, 0));
+  for (uint8_t col = 0; queued[col]; col++)
+    lcd_queueData (queued[col]);
+  lcd_queueInstruction (SET_DDRAM_ADDR | LCD_XY_ADDR (LCD_ROWS - 1, 0));
+  for (uint8_t col = 0; over[col]; col++)
+    lcd_queueData (over[col]);
+  for ( ; lcd_queueLength() && ticks < 10000; ticks++)
+    _delay_us (LCD_QUEUE_TICK_US);
+
+  // the execution time of the last byte is counted down by the interrupt.
+  _delay_ms (2);
+  lcd_queueWaitIdle();
+  check ("queue: every queued byte sent and shown",
+         lcd_queueLength() == 0 && check_row (LCD_ROWS - 1, "ABCDEFGHIJabcdef"));
+
+#ifdef LCD_DEADLINE
+  // ------------------------------------------------------------- deadline
+  // the deadline of RETURN_HOME is seen to have passed, and must not be
+  // pending again once LCD_TIMER has wrapped.
+  lcd_returnHome (&lcd);
+  _delay_ms (2);
+  uint8_t busy = lcd_isBusy (&lcd);
+  _delay_us (TICKS_TO_US (0x10000) - 1500);
+  check ("deadline: not pending again after LCD_TIMER wraps",
+         !busy && !lcd_isBusy (&lcd));
+#endif
+
+  return pvt_failed;
+}
@@ -26,7 +26,9 @@
  * address. Similarly, for when moving backwards/decrementing. The opposite
  * should occur. 
  * 
- * The display lines map to the DDRAM addresses as follows:
+ * The display lines map to the DDRAM addresses as follows, for the default
+ * 20x4 geometry. Other LCD_GEOMETRY profiles are handled through the lookup
+ * tables in LCD_ADDR.H.
  *
  * Line 1: DDRAM Address - 0x00 - 0x13
  * Line 2: DDRAM Address - 0x40 - 0x53
@@ -37,12 +39,15 @@
 
 #include <stdint.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include <util/delay.h>
 #include "prints.h"
 #include "usart0.h"
 #include "lcd_addr.h"
 #include "lcd_base.h"
 #include "lcd_sf.h"
+#include "lcd_trace.h"
+#include "lcd_stats.h"
 
 
 // 127 = backspace/delete for my apple keyboard
@@ -52,6 +57,8 @@
 #define HOME                 0x08      // ctrl + h
 #define CLEAR                0x03      // ctrl + c
 #define R_DISP_SHIFT         0x08      // ctrl + d
+#define TRACE_DUMP           0x14      // ctrl + t
+#define PRINT_STATS          0x10      // ctrl + p
 
 // for left and right arrows
 #define ARROW_CTRL_2         0x1B
@@ -59,19 +66,41 @@
 #define L_ARROW              0x44
 #define R_ARROW              0x43
 
+lcd_t lcd;
+
 int main(void)
 {
   // usart required for character entry
   usart_init();
 
+#ifdef LCD_MULTI_INSTANCE
+  lcd_config (&lcd, &PORTA, &PORTC, PC0, PC1, PC2, LCD_ROWS, LCD_COLS);
+#endif
+#ifdef LCD_BUS_RUNTIME
+  lcd_setBus (&lcd, LCD_BUS_DEFAULT);
+#endif
+#ifdef LCD_TWI
+  // the TWI interrupt sends the bytes queued for the expander.
+  sei();
+#endif
+
+#ifdef LCD_TRACE
+  // record the bus from initialization on.
+  lcd_traceInit();
+#endif
+#ifdef LCD_STATS
+  // count the driver activity from initialization on.
+  lcd_statsReset();
+#endif
+
   // Ensure LCD is initialized.
-  lcd_init();
+  lcd_init (&lcd);
 
   // Turn display and cursor on and set cursor to blink 
-  lcd_displayCtrl (DISPLAY_ON | CURSOR_ON | BLINKING_ON);
+  lcd_displayCtrl (&lcd, DISPLAY_ON | CURSOR_ON | BLINKING_ON);
 
   char c;                              // for input characters
-  uint8_t addr;                        // ddram address
+  uint8_t pos;                         // display position of the AC
 
   do
   {
@@ -86,54 +115,56 @@ int main(void)
     if (c == BACK_SPACE)
     {        
       // set display to decrement address counter (AC)
-      lcd_entryModeSet (DECREMENT);
+      lcd_entryModeSet (&lcd, DECREMENT);
 
-      // get current value of AC
-      addr = lcd_readAddr();
+      // get current display position of AC
+      pos = LCD_ADDR_POS (lcd_readAddr (&lcd));
 
-      // If AC adjust is needed, set it accordingly, else LEFT_SHIFT.
-
-      if (LINE_2_BEG == addr)
-        lcd_setAddrDDRAM (LINE_1_END);
-      else if (LINE_3_BEG == addr)
-        lcd_setAddrDDRAM (LINE_2_END);
-      else if (LINE_4_BEG == addr)
-        lcd_setAddrDDRAM (LINE_3_END);
+      // If at the start of a line, go to the end of the line before, else
+      // LEFT_SHIFT.
+      if (pos != POS_NONE && POS_COL (pos) == 0 && POS_ROW (pos) > 0)
+        lcd_gotoXY (&lcd, POS_ROW (pos) - 1, LCD_COLS - 1);
       else
-        lcd_leftShiftCursor();
+        lcd_leftShiftCursor (&lcd);
 
       // Write space to display to clear value, and reset to INCREMENT mode.
-      lcd_writeData (' ');
-      lcd_rightShiftCursor();
-      lcd_entryModeSet(INCREMENT);
+      lcd_writeData (&lcd, ' ');
+      lcd_rightShiftCursor (&lcd);
+      lcd_entryModeSet(&lcd, INCREMENT);
     }
 
     // if 'ENTER' is pressed, point AC to the first address of the next line.
     else if (c == '\r')
     {
-      addr = lcd_readAddr();
-
-      if (addr >= LINE_1_BEG && addr <= LINE_1_END)
-        lcd_setAddrDDRAM (LINE_2_BEG);
-      else if (addr >= LINE_3_BEG && addr <= LINE_3_END)
-        lcd_setAddrDDRAM (LINE_4_BEG);
-      else if (addr >= LINE_2_BEG && addr <= LINE_2_END)
-        lcd_setAddrDDRAM (LINE_3_BEG);
-      else if (addr >= LINE_4_BEG && addr <= LINE_4_END)
-        lcd_setAddrDDRAM (LINE_1_BEG);
+      pos = LCD_ADDR_POS (lcd_readAddr (&lcd));
+
+      if (pos != POS_NONE)
+        lcd_gotoXY (&lcd, (POS_ROW (pos) + 1) % LCD_ROWS, 0);
     }
 
     // if ctrl + 'h', return home. 
     else if (c == HOME)
-      lcd_returnHome();
+      lcd_returnHome (&lcd);
     
     // if ctrl + 'c', clear screen.
     else if (c == CLEAR) 
-      lcd_clearDisplay();
+      lcd_clearDisplay (&lcd);
 
     // if ctrl + 'd', shift display.
     else if (c == R_DISP_SHIFT) 
-      lcd_rightShiftDisplay ();
+      lcd_rightShiftDisplay (&lcd);
+
+#ifdef LCD_TRACE
+    // if ctrl + 't', dump the bus trace to the USART.
+    else if (c == TRACE_DUMP)
+      lcd_traceDump();
+#endif
+
+#ifdef LCD_STATS
+    // if ctrl + 'p', print the driver statistics.
+    else if (c == PRINT_STATS)
+      lcd_printStats();
+#endif
 
     //
     // If right or left arrow is pressed then move cursor in that direction.
@@ -145,32 +176,25 @@ int main(void)
       c = usart_receive();
       if (c == ARROW_CTRL_1)
       {
-        addr = lcd_readAddr();
+        pos = LCD_ADDR_POS (lcd_readAddr (&lcd));
         c = usart_receive();
 
         // Left arrow
         if (c == L_ARROW)
         {
-          if (LINE_2_BEG == addr)
-            lcd_setAddrDDRAM (LINE_1_END);
-          else if (LINE_3_BEG == addr)
-            lcd_setAddrDDRAM(LINE_2_END);
-          else if (LINE_4_BEG == addr)
-            lcd_setAddrDDRAM(LINE_3_END);
+          if (pos != POS_NONE && POS_COL (pos) == 0 && POS_ROW (pos) > 0)
+            lcd_gotoXY (&lcd, POS_ROW (pos) - 1, LCD_COLS - 1);
           else
-            lcd_leftShiftCursor();
+            lcd_leftShiftCursor (&lcd);
         }
         // right arrow
         else if (c == R_ARROW)
         {
-          if (addr == LINE_1_END)
-            lcd_setAddrDDRAM(LINE_2_BEG);
-          else if (addr == LINE_2_END)
-            lcd_setAddrDDRAM(LINE_3_BEG);
-          else if (addr == LINE_3_END)
-            lcd_setAddrDDRAM(LINE_4_BEG);
+          if (pos != POS_NONE && POS_COL (pos) == LCD_COLS - 1
+              && POS_ROW (pos) < LCD_ROWS - 1)
+            lcd_gotoXY (&lcd, POS_ROW (pos) + 1, 0);
           else
-            lcd_rightShiftCursor();
+            lcd_rightShiftCursor (&lcd);
         }
       }
     } 
@@ -178,17 +202,12 @@ int main(void)
     // print character to LCD display
     else 
     {
-      lcd_writeData(c);
-
-      // AC adjustments if at the start of a display line.
-      addr = lcd_readAddr();
+      pos = LCD_ADDR_POS (lcd_readAddr (&lcd));
+      lcd_writeData(&lcd, c);
 
-      if (addr == LINE_3_BEG)
-        lcd_setAddrDDRAM (LINE_2_BEG);
-      else if (addr == LINE_2_BEG)
-        lcd_setAddrDDRAM (LINE_4_BEG);
-      else if (addr == LINE_4_BEG)
-        lcd_setAddrDDRAM (LINE_3_BEG);
+      // AC adjustment if the end of a display line was written.
+      if (pos != POS_NONE && POS_COL (pos) == LCD_COLS - 1)
+        lcd_gotoXY (&lcd, (POS_ROW (pos) + 1) % LCD_ROWS, 0);
     }
   } 
   while (1);